@@ -1,1455 +1,5195 @@
-#include "application.h"
-#include "utils.h"
-
-#include <SDL3/SDL.h>
-#define VOLK_IMPLEMENTATION
-#include <Volk/volk.h>
-#define VMA_IMPLEMENTATION
-#include <vma/vk_mem_alloc.h>
-
-#include <iostream>
-#include <tiny_gltf.h>
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/gtc/matrix_transform.hpp>
-
-
-void Application::showError(const std::string &errorMessage) const
-{
-	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", errorMessage.c_str(), window);
-}
-
-bool Application::initialize()
-{
-	if (SDL_InitSubSystem(SDL_INIT_VIDEO))
-	{
-		window = SDL_CreateWindow("Vulkan Learning", width, height, SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
-		if (!window)
-		{
-			showError("Error creating window");
-			return false;
-		}
-
-		if (!initializeVulkan())
-		{
-			return false;
-		}
-	}
-	else
-	{
-		showError("Unable to initialize SDL3");
-		return false;
-	}
-
-	loadModel();
-
-	return true;
-}
-
-void Application::shutdown()
-{
-	// wait in case resources are in use
-	vkDeviceWaitIdle(device);
-
-	// clean up images
-	for (const Renderer::Image &image : images)
-	{
-		vmaDestroyImage(vmaAllocator, image.handle, image.allocation);
-		vkDestroyImageView(device, image.view, nullptr);
-	}
-	images.clear();
-
-	// single-use command buffer pool
-	vkDestroyCommandPool(device, commandPool, nullptr);
-
-	// destroy allocated buffers
-	vmaDestroyBuffer(vmaAllocator, vertexBuffer.buffer, vertexBuffer.allocation);
-	vmaDestroyBuffer(vmaAllocator, indexBuffer.buffer, indexBuffer.allocation);
-
-	// frame / sync object cleanup
-	if (timelineSemaphore)
-	{
-		vkDestroySemaphore(device, timelineSemaphore, nullptr);
-	}
-	for (auto &res : frameResources)
-	{
-		vkDestroySemaphore(device, res.imageAcquiredSemaphore, nullptr);
-		vkDestroyCommandPool(device, res.commandPool, nullptr); // destroys buffers implicitly
-	}
-
-	// pipeline cleanup
-	if (pipeline.layout)
-	{
-		vkDestroyPipelineLayout(device, pipeline.layout, nullptr);
-	}
-	if (pipeline.handle)
-	{
-		vkDestroyPipeline(device, pipeline.handle, nullptr);
-	}
-
-	// cleanup shaders
-	if (vertShader)
-	{
-		vkDestroyShaderModule(device, vertShader, nullptr);
-	}
-	if (fragShader)
-	{
-		vkDestroyShaderModule(device, fragShader, nullptr);
-	}
-
-	// cleanup swapchain
-	destroySwapchain();
-
-	// VMA
-	if (vmaAllocator)
-	{
-		vmaDestroyAllocator(vmaAllocator);
-	}
-
-	// cleanup Vulkan
-	if (surface)
-	{
-		vkDestroySurfaceKHR(vulkanInstance, surface, nullptr);
-	}
-	if (device)
-	{
-		vkDestroyDevice(device, nullptr);
-	}
-	if (vulkanInstance)
-	{
-		vkDestroyInstance(vulkanInstance, nullptr);
-	}
-	volkFinalize();
-
-	// cleanup SDL
-	if (window)
-	{
-		SDL_DestroyWindow(window);
-	}
-	SDL_Quit();
-}
-
-void Application::run()
-{
-	running = true;
-	prevTime = SDL_GetTicks();
-	while (running)
-	{
-		nowTime = SDL_GetTicks();
-		float deltaTime = (nowTime - prevTime) / 1000.0f;
-		prevTime = nowTime;
-		globalTime += deltaTime;
-
-		SDL_Event event{ 0 };
-		while (SDL_PollEvent(&event))
-		{
-			if (event.type == SDL_EVENT_QUIT)
-			{
-				running = false;
-				break;
-			}
-			else if (event.type == SDL_EVENT_WINDOW_RESIZED)
-			{
-				width = event.window.data1;
-				height = event.window.data2;
-				break;
-			}
-		}
-		render(deltaTime);
-	}
-}
-
-bool Application::initializeVulkan()
-{
-	if (!createVulkanInstance())
-	{
-		showError("Couldn't create a vulkan instance");
-		return false;
-	}
-
-	if (!createSurface())
-	{
-		showError("Couldn't create window surface");
-		return false;
-	}
-
-	if (physicalDevice = findPhysicalDevice(); !physicalDevice)
-	{
-		showError("Unable to find an appropriate physical device");
-		return false;
-	}
-
-	if (!findGraphicsQueue())
-	{
-		showError("Unable to find a compatible graphics queue");
-		return false;
-	}
-
-	if (!createDevice(physicalDevice))
-	{
-		showError("Couldn't create the logical GPU device");
-		return false;
-	}
-
-	if (!initializeVMA())
-	{
-		showError("Unable to create Vulkan Memory Allocator");
-		return false;
-	}
-
-	if (!createSwapchain(width, height))
-	{
-		showError("Unable to create swapchain");
-		return false;
-	}
-
-	if (!createShaders())
-	{
-		showError("Error creating shader modules");
-		return false;
-	}
-
-	if (pipeline = createGraphicsPipeline(); !pipeline.handle)
-	{
-		showError("Unable to initialize the graphics pipeline");
-		return false;
-	}
-
-	if (!createSyncResources())
-	{
-		showError("Couldn't create the sync related resources");
-		return false;
-	}
-
-	if (!createCommandBuffers())
-	{
-		showError("Couldn't create command buffer objects");
-		return false;
-	}
-
-	return true;
-}
-
-bool Application::createVulkanInstance()
-{
-	// Initialize Volk and load Vk function pointers
-	if (volkInitialize() != VK_SUCCESS)
-	{
-		showError("Error initializing Volk");
-		return false;
-	}
-
-	// Create the vulkan application instance
-	VkApplicationInfo appInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-		.pApplicationName = "My First Triangle",
-		.apiVersion = VulkanVersion,
-	};
-
-	// find the required extensions for the platform and add debug for ourselves
-	uint32_t instExtCount = 0;
-	const char *const *extensions = SDL_Vulkan_GetInstanceExtensions(&instExtCount);
-	std::vector<const char *> requestedExtensions
-	{
-		VK_EXT_DEBUG_UTILS_EXTENSION_NAME
-	};
-	for (int i = 0; i < instExtCount; ++i)
-	{
-		requestedExtensions.push_back(extensions[i]);
-	}
-
-
-	// we'll also need to enable the validation layer for error checking and reporting
-	std::vector<const char *> requestedLayers
-	{
-		"VK_LAYER_KHRONOS_validation"
-	};
-
-	VkDebugUtilsMessengerCreateInfoEXT debugInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
-		.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
-		.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
-			VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
-		.pfnUserCallback = debugCallback
-	};
-
-	VkInstanceCreateInfo instCreateInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-		.pNext = &debugInfo,
-		.pApplicationInfo = &appInfo,
-		.enabledLayerCount = static_cast<uint32_t>(requestedLayers.size()),
-		.ppEnabledLayerNames = requestedLayers.data(),
-		.enabledExtensionCount = static_cast<uint32_t>(requestedExtensions.size()),
-		.ppEnabledExtensionNames = requestedExtensions.data()
-	};
-
-	if (vkCreateInstance(&instCreateInfo, nullptr, &vulkanInstance) != VK_SUCCESS)
-	{
-		return false;
-	}
-
-	volkLoadInstance(vulkanInstance);
-	return true;
-}
-
-bool Application::createSurface()
-{
-	if (!SDL_Vulkan_CreateSurface(window, vulkanInstance, nullptr, &surface))
-	{
-		return false;
-	}
-	return true;
-}
-
-VkPhysicalDevice Application::findPhysicalDevice()
-{
-	// enumerate all physical devices
-	uint32_t physDeviceCount = 0;
-	vkEnumeratePhysicalDevices(vulkanInstance, &physDeviceCount, nullptr);
-	std::vector<VkPhysicalDevice> physicalDevices(physDeviceCount);
-	vkEnumeratePhysicalDevices(vulkanInstance, &physDeviceCount, physicalDevices.data());
-
-	VkPhysicalDevice physicalDevice = nullptr;
-	if (physDeviceCount)
-	{
-		// if you have issues, you can always just hardcode a GPU index while learning
-		physicalDevice = physicalDevices[0]; // default to first GPU
-		// look through list and see if a dGPU exists
-		for (auto &pDev : physicalDevices)
-		{
-			VkPhysicalDeviceProperties props{};
-			vkGetPhysicalDeviceProperties(pDev, &props);
-			if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-			{
-				physicalDevice = pDev;
-				break;
-			}
-		}
-	}
-	return physicalDevice;
-}
-
-bool Application::findGraphicsQueue()
-{
-	// eventually we'll have more complex queue lookup for presentation, etc
-	// grab all of the queue families
-	uint32_t queueFamCount = 0;
-	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, nullptr);
-	std::vector<VkQueueFamilyProperties2> queueFamProps(queueFamCount, { .sType = VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2 });
-	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, queueFamProps.data());
-
-	for (int currentFamIdx = 0; currentFamIdx < queueFamProps.size(); currentFamIdx++)
-	{
-		// ensure it has presentation support
-		VkBool32 hasPresentSupport = VK_FALSE;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, currentFamIdx, surface, &hasPresentSupport);
-
-		const auto &props = queueFamProps[currentFamIdx];
-		// ensure this is a GRAPHICS queue with presentation support
-		if (props.queueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT && hasPresentSupport)
-		{
-			gfxQueueFamIdx = currentFamIdx;
-			return true;
-		}
-	}
-	return false;
-}
-
-
-bool Application::createDevice(VkPhysicalDevice physicalDevice)
-{
-	// query supported features
-	VkPhysicalDeviceVulkan14Features supportedFeatures14{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES, .pNext = nullptr };
-	VkPhysicalDeviceVulkan13Features supportedFeatures13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES, .pNext = &supportedFeatures14 };
-	VkPhysicalDeviceVulkan12Features supportedFeatures12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .pNext = &supportedFeatures13 };
-	VkPhysicalDeviceFeatures2 supportedFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supportedFeatures12 };
-	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
-
-	// check if what we need is supported
-	if (!supportedFeatures13.dynamicRendering || !supportedFeatures13.synchronization2 ||
-		!supportedFeatures12.timelineSemaphore)
-	{
-		showError("Physical device doesn't meet the feature requirements");
-		return false;
-	}
-
-	// produce a separate features struct chain for device creation
-	VkPhysicalDeviceVulkan14Features features14
-	{
-		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES,
-		.pNext = nullptr
-	};
-	VkPhysicalDeviceVulkan13Features features13
-	{
-		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
-		.pNext = &features14,
-		.synchronization2 = VK_TRUE,
-		.dynamicRendering = VK_TRUE,
-	};
-	VkPhysicalDeviceVulkan12Features features12
-	{
-		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
-		.pNext = &features13,
-		.scalarBlockLayout = VK_TRUE,
-		.timelineSemaphore = VK_TRUE,
-		.bufferDeviceAddress = VK_TRUE
-	};
-	VkPhysicalDeviceFeatures2 features{
-		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-		.pNext = &features12,
-		.features {.shaderInt64 = VK_TRUE }
-	};
-
-	// request the queues we'll be using
-	std::vector<float> queuePriorities{ 1.0f };
-	VkDeviceQueueCreateInfo gfxQueueInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = gfxQueueFamIdx,
-		.queueCount = 1,
-		.pQueuePriorities = queuePriorities.data()
-	};
-
-	// device specific extensions
-	const std::vector<const char *> deviceExtensions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
-
-	VkDeviceCreateInfo devCreateInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		.pNext = &features,
-		.queueCreateInfoCount = 1,
-		.pQueueCreateInfos = &gfxQueueInfo,
-		.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
-		.ppEnabledExtensionNames = deviceExtensions.data(),
-		.pEnabledFeatures = nullptr // features struct chain is set in pNext
-	};
-
-	if (vkCreateDevice(physicalDevice, &devCreateInfo, nullptr, &device) != VK_SUCCESS)
-	{
-		return false;
-	}
-
-	// grab the VkQueue object finally
-	vkGetDeviceQueue(device, gfxQueueFamIdx, 0, &gfxQueue);
-	if (!gfxQueue)
-	{
-		showError("Couldn't get the graphics queue");
-		return false;
-	}
-	return true;
-}
-
-bool Application::initializeVMA()
-{
-	VmaVulkanFunctions vmaFuncInfo{};
-	VmaAllocatorCreateInfo vmaAllocInfo
-	{
-		.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
-		.physicalDevice = physicalDevice,
-		.device = device,
-		.pVulkanFunctions = &vmaFuncInfo,
-		.instance = vulkanInstance,
-		.vulkanApiVersion = VulkanVersion
-	};
-
-	// vma can import directly from volk
-	vmaImportVulkanFunctionsFromVolk(&vmaAllocInfo, &vmaFuncInfo);
-
-	if (vmaCreateAllocator(&vmaAllocInfo, &vmaAllocator) != VK_SUCCESS)
-	{
-		return false;
-	}
-	return true;
-}
-
-bool Application::createSwapchain(uint32_t width, uint32_t height)
-{
-	swapchainWidth = width;
-	swapchainHeight = height;
-
-	VkSurfaceCapabilitiesKHR surfaceCaps{};
-	if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCaps) != VK_SUCCESS)
-	{
-		showError("Couldn't get the surface capabilities");
-		return false;
-	}
-
-	VkSwapchainCreateInfoKHR swapchainCreateInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-		.surface = surface,
-		.minImageCount = surfaceCaps.minImageCount,
-		.imageFormat = swapchainFormat,
-		.imageColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR,
-		.imageExtent{.width = swapchainWidth, .height = swapchainHeight },
-		.imageArrayLayers = 1,
-		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
-		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-		.presentMode = VK_PRESENT_MODE_FIFO_KHR
-	};
-
-	if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &swapchain) != VK_SUCCESS)
-	{
-		showError("Error creating swapchain");
-		return false;
-	}
-
-	// grab the swapchain images
-	uint32_t imageCount = 0;
-	vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
-	swapchainImages.resize(imageCount);
-	vkGetSwapchainImagesKHR(device, swapchain, &imageCount, swapchainImages.data());
-	swapchainImageViews.resize(imageCount);
-
-	// create the swapchain image views
-	for (size_t i = 0; i < swapchainImages.size(); ++i)
-	{
-		VkImageViewCreateInfo imgViewInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-			.image = swapchainImages[i],
-			.viewType = VK_IMAGE_VIEW_TYPE_2D,
-			.format = swapchainFormat,
-			.subresourceRange
-			{
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				.levelCount = 1,
-				.layerCount = 1
-			}
-		};
-
-		if (vkCreateImageView(device, &imgViewInfo, nullptr, &swapchainImageViews[i]) != VK_SUCCESS)
-		{
-			showError("Error creating swapchain image view");
-			return false;
-		}
-	}
-
-	// semaphores used to signal render completion
-	renderCompleteSemaphores.resize(swapchainImages.size());
-	for (VkSemaphore &semaphore : renderCompleteSemaphores)
-	{
-		VkSemaphoreCreateInfo semaphoreInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
-		{
-			showError("Error creating the render-complete semaphore");
-			return false;
-		}
-	}
-
-	// create depth image
-	VkImageCreateInfo depthCreateInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-		.imageType = VK_IMAGE_TYPE_2D,
-		.format = depthFormat,
-		.extent{.width = swapchainWidth, .height = swapchainHeight, .depth = 1 },
-		.mipLevels = 1,
-		.arrayLayers = 1,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.tiling = VK_IMAGE_TILING_OPTIMAL,
-		.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
-	};
-
-	VmaAllocationCreateInfo allocInfo
-	{
-		.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
-		.usage = VMA_MEMORY_USAGE_AUTO
-	};
-	if (vmaCreateImage(vmaAllocator, &depthCreateInfo, &allocInfo, &depthImage, &depthImageAllocation, nullptr) != VK_SUCCESS)
-	{
-		showError("Error allocating depth image");
-		return false;
-	}
-
-	VkImageViewCreateInfo depthImgViewInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-		.image = depthImage,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
-		.format = depthFormat,
-		.subresourceRange{.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT, .levelCount = 1, .layerCount = 1}
-	};
-	if (vkCreateImageView(device, &depthImgViewInfo, nullptr, &depthImageView) != VK_SUCCESS)
-	{
-		showError("Error creating depth image view");
-		return false;
-	}
-
-	return true;
-}
-
-void Application::destroySwapchain()
-{
-	for (VkImageView swapchainImgView : swapchainImageViews)
-	{
-		vkDestroyImageView(device, swapchainImgView, nullptr);
-	}
-	swapchainImageViews.clear();
-
-	// destroy render-complete ssemaphores
-	for (VkSemaphore &semaphore : renderCompleteSemaphores)
-	{
-		vkDestroySemaphore(device, semaphore, nullptr);
-	}
-	renderCompleteSemaphores.clear();
-
-	if (swapchain)
-	{
-		vkDestroySwapchainKHR(device, swapchain, nullptr);
-		swapchain = nullptr;
-	}
-
-	// destroy the depth buffer along with the swapchain
-	if (depthImageView)
-	{
-		vkDestroyImageView(device, depthImageView, nullptr);
-		vmaDestroyImage(vmaAllocator, depthImage, depthImageAllocation);
-		depthImageView = nullptr;
-	}
-}
-
-VkShaderModule Application::createShaderModule(const std::string &fileName, shaderc_shader_kind kind) const
-{
-	// read shader file from disk
-	const std::string shaderPath = "src/shaders/" + fileName;
-	const std::string src = readTextFile(shaderPath);
-	if (src.empty())
-	{
-		showError("Specified shader file doesn't exist: " + shaderPath);
-		return nullptr;
-	}
-
-	// compile the shader to SPIR-V
-	std::cout << "Compiling shader: " << shaderPath << std::endl;
-	shaderc::Compiler compiler;
-	shaderc::CompileOptions opts;
-	opts.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_4);
-	opts.SetTargetSpirv(shaderc_spirv_version_1_6);
-	opts.SetOptimizationLevel(shaderc_optimization_level_performance);
-	shaderc::CompilationResult result = compiler.CompileGlslToSpv(src, kind, fileName.c_str(), opts);
-
-	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
-	{
-		std::cerr << "Shader Compilation Error: " << result.GetErrorMessage() << std::endl;
-		return nullptr;
-	}
-	std::vector<uint32_t> spv = { result.cbegin(), result.cend() };
-
-	// pass spir-v to vulkan and create shader-module
-	VkShaderModuleCreateInfo moduleCreateInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.codeSize = spv.size() * sizeof(uint32_t),
-		.pCode = spv.data()
-	};
-	VkShaderModule shaderModule = nullptr;
-	if (vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
-	{
-		showError("Error creating shader module");
-		return nullptr;
-	}
-	return shaderModule;
-}
-
-bool Application::createShaders()
-{
-	// create the shader modules that we'll need for the graphics pipeline
-	if (vertShader = createShaderModule("shader.vert", shaderc_vertex_shader); !vertShader)
-	{
-		return false;
-	}
-	if (fragShader = createShaderModule("shader.frag", shaderc_fragment_shader); !fragShader)
-	{
-		return false;
-	}
-	return true;
-}
-
-Pipeline Application::createGraphicsPipeline() const
-{
-	// configure the shader stages struct
-	const char *entryPoint = "main";
-	std::vector<VkPipelineShaderStageCreateInfo> shaderStages
-	{
-		{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-			.stage = VK_SHADER_STAGE_VERTEX_BIT,
-			.module = vertShader,
-			.pName = entryPoint
-		},
-		{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-			.module = fragShader,
-			.pName = entryPoint
-		}
-	};
-
-	// vertex pulling, don't define vertex input details
-	VkPipelineVertexInputStateCreateInfo vertInputInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
-	};
-
-	// input assembly, we'll be drawing triangle lists
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
-	};
-
-	// depth/stencil configuration
-	VkPipelineDepthStencilStateCreateInfo depthStencilInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-		.depthTestEnable = VK_TRUE,
-		.depthWriteEnable = VK_TRUE,
-		.depthCompareOp = VK_COMPARE_OP_LESS,
-		.stencilTestEnable = VK_FALSE
-	};
-
-	// dynamic rendering allows to set this up...dynamically
-	// we still need this struct though
-	VkPipelineViewportStateCreateInfo viewportInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-		.viewportCount = 1,
-		.pViewports = nullptr,
-		.scissorCount = 1,
-		.pScissors = nullptr
-	};
-
-	// rasterizer settings
-	VkPipelineRasterizationStateCreateInfo rasterInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-		.polygonMode = VK_POLYGON_MODE_FILL,
-		.cullMode = VK_CULL_MODE_NONE,
-		//.cullMode = VK_CULL_MODE_BACK_BIT,
-		.frontFace = VK_FRONT_FACE_CLOCKWISE,
-		.lineWidth = 1.0f
-	};
-
-	// No multisampling
-	VkPipelineMultisampleStateCreateInfo multiSampleInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
-	};
-
-	// Alpha-blending (disabled for now), still need
-	// attachment info and write mask
-	VkPipelineColorBlendAttachmentState attachState
-	{
-		.blendEnable = VK_FALSE,
-		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-			VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-	};
-	VkPipelineColorBlendStateCreateInfo blendInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-		.attachmentCount = 1,
-		.pAttachments = &attachState
-	};
-
-	// enable dynamic state
-	std::vector<VkDynamicState> dynamicState
-	{
-		VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR
-	};
-	VkPipelineDynamicStateCreateInfo dynamicStateInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-		.dynamicStateCount = static_cast<uint32_t>(dynamicState.size()),
-		.pDynamicStates = dynamicState.data()
-	};
-
-	// structure required for dynamic rendering
-	VkPipelineRenderingCreateInfo renderInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
-		.colorAttachmentCount = 1,
-		.pColorAttachmentFormats = &swapchainFormat,
-		.depthAttachmentFormat = depthFormat,
-	};
-
-	// Create the graphics pipeline
-	Pipeline pipeline;
-
-	// need to define a pipeline layout
-	VkPushConstantRange pushConstRange
-	{
-		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-		.offset = 0,
-		.size = sizeof(Renderer::DrawConstants)
-	};
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = 0,
-		.pushConstantRangeCount = 1,
-		.pPushConstantRanges = &pushConstRange
-	};
-	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipeline.layout) != VK_SUCCESS)
-	{
-		showError("Unable to create the pipeline layout");
-		return Pipeline{};
-	}
-
-	VkGraphicsPipelineCreateInfo pipelineInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		.pNext = &renderInfo,
-		.stageCount = static_cast<uint32_t>(shaderStages.size()),
-		.pStages = shaderStages.data(),
-		.pVertexInputState = &vertInputInfo,
-		.pInputAssemblyState = &inputAssemblyInfo,
-		.pViewportState = &viewportInfo,
-		.pRasterizationState = &rasterInfo,
-		.pMultisampleState = &multiSampleInfo,
-		.pDepthStencilState = &depthStencilInfo,
-		.pColorBlendState = &blendInfo,
-		.pDynamicState = &dynamicStateInfo,
-		.layout = pipeline.layout,
-		.renderPass = VK_NULL_HANDLE,
-	};
-	if (vkCreateGraphicsPipelines(device, nullptr, 1, &pipelineInfo, nullptr, &pipeline.handle) != VK_SUCCESS)
-	{
-		showError("Error creating the pipeline");
-		return Pipeline{};
-	}
-	return pipeline;
-}
-
-bool Application::createSyncResources()
-{
-	VkSemaphoreTypeCreateInfo semaphoreTypeInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
-		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
-		.initialValue = timelineValue
-	};
-	VkSemaphoreCreateInfo semaphoreInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-		.pNext = &semaphoreTypeInfo
-	};
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS)
-	{
-		showError("Unable to create the timeline semaphore");
-		return false;
-	}
-
-	// per-frame image-acquire semaphores
-	for (FrameResources &res : frameResources)
-	{
-		// create the binary semaphores
-		VkSemaphoreCreateInfo semaphoreInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
-		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &res.imageAcquiredSemaphore) != VK_SUCCESS)
-		{
-			showError("Error creating the per-frame image-acquire semaphore");
-			return false;
-		}
-	}
-
-	return true;
-}
-
-bool Application::createCommandBuffers()
-{
-	// create a command pool for single use
-	VkCommandPoolCreateInfo poolInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-		.queueFamilyIndex = gfxQueueFamIdx
-	};
-	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
-	{
-		showError("Unable to create command buffer pool");
-		return false;
-	}
-
-	for (FrameResources &res : frameResources)
-	{
-		// we'll give each frame its own pool, faster cmd buffer resets this way
-		VkCommandPoolCreateInfo poolInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-			.queueFamilyIndex = gfxQueueFamIdx
-		};
-		if (vkCreateCommandPool(device, &poolInfo, nullptr, &res.commandPool) != VK_SUCCESS)
-		{
-			showError("Unable to create command buffer pool");
-			return false;
-		}
-
-		// create the command buffer for this frame
-		VkCommandBufferAllocateInfo cmdAllocInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = res.commandPool,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = 1,
-		};
-
-		if (vkAllocateCommandBuffers(device, &cmdAllocInfo, &res.commandBuffer) != VK_SUCCESS)
-		{
-			showError("Unable to allocate command buffer");
-			return false;
-		}
-	}
-	return true;
-}
-
-void Application::render(float deltaTime)
-{
-	// first check if our swapchain is still valid
-	if (requireSwapchainRecreate)
-	{
-		vkDeviceWaitIdle(device);
-		destroySwapchain();
-		createSwapchain(width, height);
-		requireSwapchainRecreate = false;
-	}
-
-	const uint32_t frameResIndex = frameCounter++ % MaxFramesInFlight;
-	// wait for frame using this frame's resources to complete
-	uint64_t frameId = ++timelineValue; // this is our frame "ID", and what we're using to signal the end of this frame later
-	uint64_t waitForId = frameId - MaxFramesInFlight; // frame N and frame N - MaxInFlight share resources (3 - 2 = 1 -- frame 3 and 1 share resources)
-
-	VkSemaphoreWaitInfo waitInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
-		.semaphoreCount = 1,
-		.pSemaphores = &timelineSemaphore,
-		.pValues = &waitForId
-	};
-	vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
-
-	// now its safe to start recording commands
-	FrameResources &res = frameResources[frameResIndex];
-	vkResetCommandPool(device, res.commandPool, 0); // resets all buffers
-
-	// get the resources for this frame
-	VkSemaphore imageAcquireSemaphore = frameResources[frameResIndex].imageAcquiredSemaphore;
-
-	// acquire the swapchain image, no need to wait for timeline semaphore just to then wait for the swapchain image
-	uint32_t imageIndex = 0;
-	VkResult acquireResult = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAcquireSemaphore, VK_NULL_HANDLE, &imageIndex);
-	// handle resize and out-of-date images, may need swapchain recreate
-
-	if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
-	{
-		requireSwapchainRecreate = true;
-		return;
-	}
-	else if (acquireResult == VK_SUBOPTIMAL_KHR)
-	{
-		// can render this frame, recreate next time around
-		requireSwapchainRecreate = true;
-	}
-
-	// begin recording commands
-	VkCommandBufferBeginInfo cmdBeginInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
-	};
-	vkBeginCommandBuffer(res.commandBuffer, &cmdBeginInfo);
-
-	// transition the color and depth images
-	std::vector<VkImageMemoryBarrier2> layoutBarriers
-	{
-		{
-			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-			.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-			.srcAccessMask = 0,
-			.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-			.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			.image = swapchainImages[imageIndex],
-			.subresourceRange
-			{
-				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-				.baseMipLevel = 0,
-				.levelCount = 1,
-				.baseArrayLayer = 0,
-				.layerCount = 1,
-			}
-		},
-		{
-			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-			.srcStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, // both specified to control memory access at both stages (write)
-			.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, // both specified to control memory access at both stages (write)
-			.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-			.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-			.image = depthImage,
-			.subresourceRange
-			{
-				.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-				.baseMipLevel = 0,
-				.levelCount = 1,
-				.baseArrayLayer = 0,
-				.layerCount = 1,
-			}
-		}
-	};
-	VkDependencyInfo depInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-		.imageMemoryBarrierCount = static_cast<uint32_t>(layoutBarriers.size()),
-		.pImageMemoryBarriers = layoutBarriers.data()
-	};
-	vkCmdPipelineBarrier2(res.commandBuffer, &depInfo);
-
-	// setup the attachments (color and depth) and begin rendering (dynamic)
-	VkRenderingAttachmentInfo colorAttachInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-		.imageView = swapchainImageViews[imageIndex],
-		.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, // clear the image
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE, // keep data for presentation
-		.clearValue{.color{0.0f, 0.0f, 0.0f, 1}}
-	};
-	VkRenderingAttachmentInfo depthAttachInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-		.imageView = depthImageView,
-		.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, // clear the depth data
-		.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE, // don't care after rendering
-		.clearValue{.depthStencil{1.0f, 0}}
-	};
-	VkRenderingInfo renderingInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-		.renderArea
-		{
-			.offset{.x = 0, .y = 0},
-			.extent{.width = swapchainWidth, .height = swapchainHeight}
-		},
-		.layerCount = 1,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &colorAttachInfo,
-		.pDepthAttachment = &depthAttachInfo
-	};
-
-	// begin dynamic rendering
-	vkCmdBeginRendering(res.commandBuffer, &renderingInfo);
-	{
-		// set the viewpot and scissor state
-		VkViewport viewport
-		{
-			.x = 0, .y = 0,
-			.width = static_cast<float>(swapchainWidth),
-			.height = static_cast<float>(swapchainHeight),
-			.minDepth = 0,
-			.maxDepth = 1.0f,
-		};
-		vkCmdSetViewport(res.commandBuffer, 0, 1, &viewport);
-
-		VkRect2D scissor
-		{
-			.offset{.x = 0, .y = 0 },
-			.extent{.width = swapchainWidth, .height = swapchainHeight}
-		};
-		vkCmdSetScissor(res.commandBuffer, 0, 1, &scissor);
-
-		vkCmdBindPipeline(res.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle);
-
-		constexpr float fov = glm::radians(45.0);
-		float aspect = static_cast<float>(width) / static_cast<float>(height);
-		float nearP = 0.1f;
-		float farP = 32.0f;
-
-		glm::mat4 proj = glm::perspective(glm::radians(45.0f), (float)width / (float)height, nearP, farP);
-		proj[1][1] *= -1;
-		glm::mat4 rotation = glm::rotate(glm::mat4(1), static_cast<float>(globalTime), glm::vec3(0, 1, 0));
-		glm::mat4 translate = glm::translate(glm::mat4(1), glm::vec3(0, -0.4, -1));
-		glm::mat4 scale = glm::scale(glm::mat4(1), glm::vec3(1.0f, 1.0f, 1.0f));
-		glm::mat4 transform = translate * rotation * scale;
-
-		// BDA Send Device Pointer
-		VkBufferDeviceAddressInfo vertBdaInfo{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = vertexBuffer.buffer };
-		Renderer::DrawConstants pushConsts
-		{
-			.vertexBufferAddress = vkGetBufferDeviceAddress(device, &vertBdaInfo),
-			.globalTime = static_cast<float>(globalTime),
-			.mvp = proj * transform
-		};
-		vkCmdPushConstants(res.commandBuffer, pipeline.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Renderer::DrawConstants), &pushConsts);
-
-		vkCmdBindIndexBuffer(res.commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-		for (Renderer::Mesh &mesh : meshes)
-		{
-			for (Renderer::SubMesh &sub : mesh.subMeshes)
-			{
-				vkCmdDrawIndexed(res.commandBuffer, sub.indexCount, 1, sub.indexStart, sub.vertexStart, 0);
-			}
-		}
-	}
-	// end dynamic rendering
-	vkCmdEndRendering(res.commandBuffer);
-
-	// transition the image from color attachment to presentation so we can show it
-	VkImageMemoryBarrier2 presentLayoutBarrier
-	{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-		.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_2_NONE, // nothing is waiting, but the cache is flushed and layout is transition
-		.dstAccessMask = 0,
-		.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		.image = swapchainImages[imageIndex],
-		.subresourceRange
-		{
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1,
-		}
-	};
-	VkDependencyInfo presentDepInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-		.imageMemoryBarrierCount = 1,
-		.pImageMemoryBarriers = &presentLayoutBarrier
-	};
-	vkCmdPipelineBarrier2(res.commandBuffer, &presentDepInfo);
-
-	vkEndCommandBuffer(res.commandBuffer);
-
-	// ensure swapchain image is actually vailable to start color output
-	VkSemaphoreSubmitInfo imageAcquireWaitInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-		.semaphore = imageAcquireSemaphore,
-		.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | // wait before drawing to image
-			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT // prevent depth buffer clearing before image is ready
-	};
-	// signal that the image can be presented
-	std::vector<VkSemaphoreSubmitInfo> semaphoreSignals
-	{
-		{ // render work completion signal
-			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-			.semaphore = renderCompleteSemaphores[imageIndex],
-			.stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT
-		},
-		{ // entire frame is completed (timeline)
-			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-			.semaphore = timelineSemaphore,
-			.value = frameId, // we're signalling our current frame ID is complete
-			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
-		}
-	};
-	VkCommandBufferSubmitInfo cmdSubmitInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
-		.commandBuffer = res.commandBuffer,
-	};
-	VkSubmitInfo2 submitInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-		.waitSemaphoreInfoCount = 1,
-		.pWaitSemaphoreInfos = &imageAcquireWaitInfo, // ensure the image is ready
-		.commandBufferInfoCount = 1,
-		.pCommandBufferInfos = &cmdSubmitInfo,
-		.signalSemaphoreInfoCount = static_cast<uint32_t>(semaphoreSignals.size()),
-		.pSignalSemaphoreInfos = semaphoreSignals.data()
-	};
-	vkQueueSubmit2(gfxQueue, 1, &submitInfo, VK_NULL_HANDLE);
-
-	// present the image
-	VkPresentInfoKHR presentInfo{
-		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &renderCompleteSemaphores[imageIndex], // render work completed semaphore
-		.swapchainCount = 1,
-		.pSwapchains = &swapchain,
-		.pImageIndices = &imageIndex,
-		.pResults = nullptr
-	};
-
-	vkQueuePresentKHR(gfxQueue, &presentInfo);
-}
-
-void loadNode(tinygltf::Node &node, tinygltf::Model &model)
-{
-	using namespace tinygltf;
-
-	for (int childNodeIndex : node.children)
-	{
-		loadNode(model.nodes[childNodeIndex], model);
-	}
-}
-
-void Application::loadModel()
-{
-	using namespace tinygltf;
-	Model model;
-	TinyGLTF loader;
-
-	std::string err;
-	std::string warn;
-	//loader.LoadASCIIFromFile(&model, &err, &warn, "C:/Users/nikol/Desktop/untitled.gltf");
-	loader.LoadASCIIFromFile(&model, &err, &warn, "D:/glTF-Sample-Models/2.0/FlightHelmet/glTF/FlightHelmet.gltf");
-	//loader.LoadASCIIFromFile(&model, &err, &warn, "S:/projects/boiler-3d/data/sorceress/scene.gltf");
-
-	// load images
-	VkCommandBuffer commandBuffer = startTransientCommandBuffer();
-	if (commandBuffer)
-	{
-		for (const Image &image : model.images)
-		{
-			Renderer::Image newImage = createImage(image.image, image.width, image.height, image.component);
-			if (newImage.handle == nullptr)
-			{
-				break;
-			}
-			images.push_back(newImage);
-		}
-	}
-	submitTransientCommandBuffer(commandBuffer);
-
-	// load all meshes first
-	for (const Mesh &mesh : model.meshes)
-	{
-		Renderer::Mesh newMesh;
-		for (const Primitive &primitive : mesh.primitives)
-		{
-			Renderer::SubMesh subMesh;
-			subMesh.vertexStart = vertices.size();
-			subMesh.indexStart = indices.size();
-
-			// load primitive vertices into sub-mesh
-			if (const auto &itr = primitive.attributes.find("POSITION"); itr != primitive.attributes.end())
-			{
-				const auto &[name, index] = *itr;
-				const Accessor &access = model.accessors[index];
-				const BufferView &bv = model.bufferViews[access.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bv.buffer];
-
-				if (access.type == TINYGLTF_TYPE_VEC3)
-				{
-					for (int i = 0; i < access.count; ++i)
-					{
-						size_t offset = bv.byteOffset + access.byteOffset + i * ((bv.byteStride > 0) ? bv.byteStride : sizeof(glm::vec3));
-						const glm::vec3 *pos = reinterpret_cast<const glm::vec3 *>(buffer.data.data() + offset);
-						vertices.push_back(Renderer::Vertex{ .position = *pos });
-						subMesh.vertexCount++;
-					}
-				}
-			}
-			// load primitive vertices into sub-mesh
-			if (const auto &itr = primitive.attributes.find("TEXCOORD_0"); itr != primitive.attributes.end())
-			{
-				const auto &[name, index] = *itr;
-				const Accessor &access = model.accessors[index];
-				const BufferView &bv = model.bufferViews[access.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bv.buffer];
-
-				if (access.type == TINYGLTF_TYPE_VEC2)
-				{
-					for (int i = 0; i < access.count; ++i)
-					{
-						size_t offset = bv.byteOffset + access.byteOffset + i * ((bv.byteStride > 0) ? bv.byteStride : sizeof(glm::vec2));
-						const glm::vec2 *uv = reinterpret_cast<const glm::vec2 *>(buffer.data.data() + offset);
-						vertices[subMesh.vertexStart + i].uv = *uv;
-					}
-				}
-			}
-			// indices
-			if (primitive.indices != -1)
-			{
-				const Accessor &access = model.accessors[primitive.indices];
-				const BufferView &bv = model.bufferViews[access.bufferView];
-				const tinygltf::Buffer &buffer = model.buffers[bv.buffer];
-				subMesh.indexCount = access.count;
-
-				if (access.type == TINYGLTF_TYPE_SCALAR && access.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
-				{
-					for (int i = 0; i < access.count; ++i)
-					{
-						const uint32_t *idx = reinterpret_cast<const uint32_t *>(buffer.data.data() + bv.byteOffset + access.byteOffset) + i;
-						indices.push_back(*idx);
-					}
-				}
-				else if (access.type == TINYGLTF_TYPE_SCALAR && access.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
-				{
-					for (int i = 0; i < access.count; ++i)
-					{
-						const uint16_t *idx = reinterpret_cast<const uint16_t *>(buffer.data.data() + bv.byteOffset + access.byteOffset) + i;
-						indices.push_back(*idx);
-					}
-				}
-			}
-			newMesh.subMeshes.push_back(subMesh);
-		}
-		meshes.push_back(newMesh);
-	}
-
-	auto createBuffer = [](VmaAllocator &vmaAllocator, VkBufferUsageFlags usage, size_t byteSize, void *initData)
-	{
-		VkBufferCreateInfo buffInfo
-		{
-			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-			.size = byteSize,
-			.usage = usage,
-			.sharingMode = VK_SHARING_MODE_EXCLUSIVE
-		};
-
-		VmaAllocationCreateInfo allocInfo
-		{
-			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT,
-			.usage = VMA_MEMORY_USAGE_CPU_TO_GPU
-		};
-
-		Renderer::Buffer newBuff;
-		if (vmaCreateBuffer(vmaAllocator, &buffInfo, &allocInfo, &newBuff.buffer, &newBuff.allocation, nullptr) != VK_SUCCESS)
-		{
-			//showError("Error allocating buffer");
-		}
-
-		void *buffPtr = nullptr;
-		if (vmaMapMemory(vmaAllocator, newBuff.allocation, &buffPtr) != VK_SUCCESS)
-		{
-			//showError("Unable to map buffer memory");
-		}
-		std::memcpy(static_cast<char *>(buffPtr), initData, buffInfo.size);
-		const glm::vec3 *vec3Ptr = reinterpret_cast<const glm::vec3 *>(buffPtr);
-		vmaUnmapMemory(vmaAllocator, newBuff.allocation);
-
-		return newBuff;
-	};
-
-	vertexBuffer = createBuffer(vmaAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		sizeof(Renderer::Vertex) * vertices.size(), vertices.data());
-	indexBuffer = createBuffer(vmaAllocator, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-		sizeof(uint32_t) * indices.size(), indices.data());
-}
-
-VkCommandBuffer Application::startTransientCommandBuffer()
-{
-	// allocate the transient command buffer
-	VkCommandBufferAllocateInfo cmdAllocInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = commandPool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-		.commandBufferCount = 1,
-	};
-
-	VkCommandBuffer commandBuffer = nullptr;
-	if (vkAllocateCommandBuffers(device, &cmdAllocInfo, &commandBuffer) != VK_SUCCESS)
-	{
-		showError("Unable to allocate command buffer");
-		return nullptr;
-	}
-
-	// begin the command buffer
-	VkCommandBufferBeginInfo beginInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
-	};
-	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
-	{
-		showError("Unable to begin command buffer");
-		return nullptr;
-	}
-
-	return commandBuffer;
-}
-
-void Application::submitTransientCommandBuffer(VkCommandBuffer commandBuffer)
-{
-	vkEndCommandBuffer(commandBuffer);
-
-	// TODO: Submit on a transfer queue
-	VkSubmitInfo submitInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.commandBufferCount = 1,
-		.pCommandBuffers = &commandBuffer
-	};
-
-	vkQueueSubmit(gfxQueue, 1, &submitInfo, nullptr);
-	vkQueueWaitIdle(gfxQueue);
-	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-}
-
-Renderer::Image Application::createImage(std::vector<unsigned char> imageData, uint32_t width, uint32_t height, int components)
-{
-	VkFormat imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
-
-	VkImageCreateInfo imageInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-		.imageType = VK_IMAGE_TYPE_2D,
-		.format = imageFormat,
-		.extent {.width = width, .height = height, .depth = 1},
-		.mipLevels = 1,
-		.arrayLayers = 1,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.tiling = VK_IMAGE_TILING_OPTIMAL,
-		.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
-	};
-	VmaAllocationCreateInfo allocInfo{ .usage = VMA_MEMORY_USAGE_CPU_TO_GPU };
-
-	Renderer::Image image;
-	if (vmaCreateImage(vmaAllocator, &imageInfo, &allocInfo, &image.handle, &image.allocation, nullptr) != VK_SUCCESS)
-	{
-		showError("Error creating image");
-		return Renderer::Image{};
-	}
-
-	VkImageViewCreateInfo imgViewInfo
-	{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-		.image = image.handle,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
-		.format = imageFormat,
-		.subresourceRange
-		{
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.levelCount = 1,
-			.layerCount = 1
-		}
-	};
-
-	if (vkCreateImageView(device, &imgViewInfo, nullptr, &image.view) != VK_SUCCESS)
-	{
-		showError("Error creating image view");
-		return Renderer::Image{};
-	}
-	return image;
-}
-
-VKAPI_ATTR VkBool32 VKAPI_CALL Application::debugCallback(
-	VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-	VkDebugUtilsMessageTypeFlagsEXT messageType,
-	const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
-	void *pUserData)
-{
-	if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
-	{
-		std::cerr << "Validation Layer: " << pCallbackData->pMessage << std::endl;
-	}
-
-	return VK_FALSE;
-}
+#include "application.h"
+#include "utils.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "shader_cache.h"
+#include "pipeline_cache.h"
+#include "cpu_trace.h"
+
+#include <SDL3/SDL.h>
+#define VOLK_IMPLEMENTATION
+#include <Volk/volk.h>
+#define VMA_IMPLEMENTATION
+#include <vma/vk_mem_alloc.h>
+
+#include <iostream>
+#include <bit>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <utility>
+#include <tiny_gltf.h>
+#include <json.hpp>
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+void Application::showError(const std::string &errorMessage) const
+{
+	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Error", errorMessage.c_str(), window);
+}
+
+bool Application::initialize(const AppConfig &config)
+{
+	this->config = config;
+	phaseStart = std::chrono::steady_clock::now();
+	framesInFlight = std::clamp(config.framesInFlight, 1u, MaxFramesInFlight);
+	timelineValue = framesInFlight - 1;
+	offscreenEnabled = config.benchmarkFrames > 0 && config.offscreen;
+	if (SDL_InitSubSystem(SDL_INIT_VIDEO))
+	{
+		// offscreen benchmarks still need a surface to pick a device that could present
+		const SDL_WindowFlags windowFlags = SDL_WINDOW_VULKAN | (offscreenEnabled ? SDL_WINDOW_HIDDEN : SDL_WINDOW_RESIZABLE);
+		window = SDL_CreateWindow("Vulkan Learning", width, height, windowFlags);
+		if (!window)
+		{
+			showError("Error creating window");
+			return false;
+		}
+		endStartupPhase("window");
+
+		if (!initializeVulkan())
+		{
+			return false;
+		}
+	}
+	else
+	{
+		showError("Unable to initialize SDL3");
+		return false;
+	}
+
+	loadModel();
+	// a load boundary, nothing is in flight yet so the buffers can be compacted before the first frame
+	defragmentMemory();
+	gpuMemory.printStats("after load");
+	endStartupPhase("model");
+
+#ifndef VULKANAPP_SPIRV_DIR
+	if (config.hotReload)
+	{
+		shaderWatcher = std::jthread([this](std::stop_token stopToken) { watchShaders(stopToken); });
+	}
+#else
+	if (config.hotReload)
+	{
+		std::cerr << "Shader hot reload needs the runtime compiler, ignored with precompiled shaders" << std::endl;
+	}
+#endif
+#ifndef VULKANAPP_TRACE
+	if (!config.cpuTraceFile.empty())
+	{
+		std::cerr << "CPU tracing is compiled out of this build, no trace will be written" << std::endl;
+	}
+#endif
+
+	return true;
+}
+
+void Application::shutdown()
+{
+	// no reload or texture load may be in flight while everything is torn down
+	shaderWatcher = std::jthread();
+	textureStreamer.shutdown();
+
+	// wait in case resources are in use
+	vkDeviceWaitIdle(device);
+	processDeletions(true);
+
+	// clean up images
+	for (const Renderer::Image &image : images)
+	{
+		gpuMemory.destroyImage(image.handle, image.allocation);
+		vkDestroyImageView(device, image.view, nullptr);
+	}
+	images.clear();
+
+	// upload command buffers and semaphore
+	uploadEngine.shutdown();
+	gpuProfiler.shutdown();
+
+	// destroy allocated buffers
+	gpuMemory.destroyBuffer(vertexBuffer.buffer, vertexBuffer.allocation);
+	gpuMemory.destroyBuffer(indexBuffer.buffer, indexBuffer.allocation);
+	gpuMemory.destroyBuffer(indexBuffer16.buffer, indexBuffer16.allocation);
+	gpuMemory.destroyBuffer(meshletBuffer.buffer, meshletBuffer.allocation);
+	gpuMemory.destroyBuffer(meshletDataBuffer.buffer, meshletDataBuffer.allocation);
+	gpuMemory.destroyBuffer(taskGroupBuffer.buffer, taskGroupBuffer.allocation);
+	gpuMemory.destroyBuffer(transformBuffer.buffer, transformBuffer.allocation);
+	gpuMemory.destroyBuffer(drawDataBuffer.buffer, drawDataBuffer.allocation);
+	gpuMemory.destroyBuffer(drawCommandBuffer.buffer, drawCommandBuffer.allocation);
+	gpuMemory.destroyBuffer(drawCountBuffer.buffer, drawCountBuffer.allocation);
+	gpuMemory.destroyBuffer(drawVisibilityBuffer.buffer, drawVisibilityBuffer.allocation);
+	gpuMemory.destroyBuffer(drawLodBuffer.buffer, drawLodBuffer.allocation);
+	gpuMemory.destroyBuffer(materialBuffer.buffer, materialBuffer.allocation);
+
+	// bindless set, freed with its pool
+	vkDestroyDescriptorPool(device, bindlessPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, bindlessSetLayout, nullptr);
+	vkDestroySampler(device, textureSampler, nullptr);
+	vkDestroyDescriptorSetLayout(device, depthPyramidSetLayout, nullptr);
+	vkDestroySampler(device, depthReduceSampler, nullptr);
+
+	// frame / sync object cleanup
+	if (timelineSemaphore)
+	{
+		vkDestroySemaphore(device, timelineSemaphore, nullptr);
+	}
+	if (computeSemaphore)
+	{
+		vkDestroySemaphore(device, computeSemaphore, nullptr);
+	}
+	for (auto &res : frameResources)
+	{
+		vkDestroySemaphore(device, res.imageAcquiredSemaphore, nullptr);
+		vkDestroyCommandPool(device, res.commandPool, nullptr); // destroys buffers implicitly
+		vkDestroyCommandPool(device, res.computePool, nullptr);
+		res.arena.shutdown();
+		for (VkCommandPool pool : res.recordPools)
+		{
+			vkDestroyCommandPool(device, pool, nullptr);
+		}
+	}
+
+	// pipelines and shaders, including a reload that never got swapped in
+	destroyPrograms(programs);
+	if (reloadedPrograms)
+	{
+		destroyPrograms(*reloadedPrograms);
+	}
+	if (pipelineCache)
+	{
+		savePipelineCache();
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	}
+
+	// cleanup swapchain and the render targets that followed it
+	renderGraph.shutdown();
+	destroySwapchain();
+
+	// VMA
+	gpuMemory.shutdown();
+
+	// cleanup Vulkan
+	if (surface)
+	{
+		vkDestroySurfaceKHR(vulkanInstance, surface, nullptr);
+	}
+	if (device)
+	{
+		vkDestroyDevice(device, nullptr);
+	}
+	if (vulkanInstance)
+	{
+		vkDestroyInstance(vulkanInstance, nullptr);
+	}
+	volkFinalize();
+
+	// cleanup SDL
+	if (window)
+	{
+		SDL_DestroyWindow(window);
+	}
+	SDL_Quit();
+}
+
+void Application::run()
+{
+	CPU_THREAD_NAME("main");
+	running = true;
+	prevTime = SDL_GetTicksNS();
+	const uint64_t startTime = prevTime;
+	const uint64_t startFrame = frameCounter;
+
+	// a benchmark steps time by a fixed amount, so the turntable camera takes the same path every run
+	const bool benchmark = config.benchmarkFrames > 0;
+	std::vector<double> benchmarkFrameMs;
+	std::vector<double> benchmarkBusyMs;
+	benchmarkFrameMs.reserve(config.benchmarkFrames);
+	benchmarkBusyMs.reserve(config.benchmarkFrames);
+	while (running)
+	{
+		CPU_ZONE("frame");
+		const uint64_t frameStart = SDL_GetTicksNS();
+		frameWaitNs = 0;
+
+		// in low latency mode input and simulation are sampled only once the previous frame is on screen
+		waitForPresent();
+		inputSampleTime = SDL_GetTicksNS();
+		frameWaitNs += inputSampleTime - frameStart;
+
+		nowTime = inputSampleTime;
+		float deltaTime = benchmark ? BenchmarkTimestep : static_cast<float>(static_cast<double>(nowTime - prevTime) / 1e9);
+		prevTime = nowTime;
+		globalTime += deltaTime;
+
+		CPU_ZONE_BEGIN(poll);
+		SDL_Event event{ 0 };
+		while (SDL_PollEvent(&event))
+		{
+			if (event.type == SDL_EVENT_QUIT)
+			{
+				running = false;
+				break;
+			}
+			else if (event.type == SDL_EVENT_WINDOW_RESIZED)
+			{
+				width = event.window.data1;
+				height = event.window.data2;
+				break;
+			}
+		}
+		CPU_ZONE_END(poll, "poll events");
+		render(deltaTime);
+
+		if (benchmark)
+		{
+			const uint64_t frame = frameCounter - startFrame;
+			if (frame > BenchmarkWarmupFrames)
+			{
+				const uint64_t frameNs = SDL_GetTicksNS() - frameStart;
+				benchmarkFrameMs.push_back(static_cast<double>(frameNs) / 1e6);
+				benchmarkBusyMs.push_back(static_cast<double>(frameNs - std::min(frameNs, frameWaitNs)) / 1e6);
+			}
+			if (frame >= BenchmarkWarmupFrames + config.benchmarkFrames)
+			{
+				running = false;
+			}
+		}
+	}
+
+	// rough average for comparing settings on the same scene
+	const uint64_t frames = frameCounter - startFrame;
+	if (frames > 0)
+	{
+		const double elapsedMs = static_cast<double>(SDL_GetTicksNS() - startTime) / 1e6;
+		std::cout << "Rendered " << frames << " frames, average frame time " << elapsedMs / frames << " ms" << std::endl;
+	}
+	if (latencySamples > 0)
+	{
+		std::cout << "Average input to present latency " << latencyTotalMs / latencySamples << " ms (" << latencySamples << " frames)" << std::endl;
+	}
+	if (cullFrames > 0)
+	{
+		const double perFrame = 1.0 / static_cast<double>(cullFrames);
+		std::cout << "Average per frame: " << totalDrawn * perFrame << " of " << drawCount << " draws drawn, "
+			<< totalFrustumCulled * perFrame << " outside the frustum, " << totalOccluded * perFrame << " occluded" << std::endl;
+	}
+	VkDeviceSize arenaPeak = 0;
+	for (FrameResources &res : std::span(frameResources).first(framesInFlight))
+	{
+		res.arena.reset();
+		arenaPeak = std::max(arenaPeak, res.arena.peakUsage());
+	}
+	std::cout << "Frame arena peak " << arenaPeak / 1024.0 << " of " << FrameArenaSize / 1024 << " KB per frame"
+		<< (frameResources[0].arena.isDeviceLocal() ? " (device local)" : " (host memory)") << std::endl;
+	gpuMemory.printStats("at exit");
+	textureStreamer.printStats();
+	gpuProfiler.printReport();
+	if (!config.gpuProfileDump.empty())
+	{
+		gpuProfiler.writeDump(config.gpuProfileDump);
+	}
+#ifdef VULKANAPP_TRACE
+	if (!config.cpuTraceFile.empty())
+	{
+		CpuTrace::writeTrace(config.cpuTraceFile);
+	}
+#endif
+	if (benchmark)
+	{
+		writeBenchmarkReport(benchmarkFrameMs, benchmarkBusyMs);
+	}
+}
+
+void Application::endStartupPhase(const char *name)
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	startupPhases.emplace_back(name, std::chrono::duration<double, std::milli>(now - phaseStart).count());
+	phaseStart = now;
+}
+
+void Application::writeBenchmarkReport(const std::vector<double> &frameMs, const std::vector<double> &busyMs) const
+{
+	using nlohmann::json;
+	auto percentiles = [](const Percentiles &p)
+	{
+		return json{ { "avg", p.average }, { "p50", p.p50 }, { "p95", p.p95 }, { "p99", p.p99 }, { "max", p.max } };
+	};
+
+	VkPhysicalDeviceProperties props{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	const char *renderPath = meshShadingEnabled ? "mesh shaders" : gpuDrivenEnabled ? "GPU-driven indirect" : "CPU draws";
+	json report
+	{
+		{ "scene", config.scenePath },
+		{ "device", props.deviceName },
+		{ "driverVersion", props.driverVersion },
+		{ "frames", frameMs.size() },
+		{ "warmupFrames", BenchmarkWarmupFrames },
+		{ "timestepMs", BenchmarkTimestep * 1000.0f },
+		{ "settings", {
+			{ "renderPath", renderPath },
+			{ "occlusionCulling", occlusionCullingEnabled },
+			{ "asyncCompute", asyncComputeEnabled },
+			{ "instancing", instancingEnabled },
+			{ "cpuCulling", cpuCullingEnabled ? DrawCuller::pathName(drawCuller.activePath()) : "off" },
+			{ "shaderObjects", shaderObjectsEnabled },
+			{ "vertexFormat", config.vertexFormat == VertexFormat::Compact ? "compact" : "full" },
+			{ "meshLods", config.meshLods },
+			{ "lodBias", config.lodBias },
+			{ "textureStreaming", textureStreamer.isActive() },
+			{ "framesInFlight", framesInFlight },
+			{ "offscreen", offscreenEnabled },
+			{ "width", swapchainWidth },
+			{ "height", swapchainHeight },
+			{ "drawCount", drawCount },
+			{ "meshletCount", meshletCount } } },
+		{ "cpuFrameMs", percentiles(computePercentiles(frameMs)) },
+		{ "cpuBusyMs", percentiles(computePercentiles(busyMs)) } // frame time minus GPU and present waits
+	};
+
+	json startup = json::object();
+	double startupTotal = 0;
+	for (const auto &[name, ms] : startupPhases)
+	{
+		startup[name] = ms;
+		startupTotal += ms;
+	}
+	startup["total"] = startupTotal;
+	report["startupMs"] = startup;
+
+	json gpu = json::object();
+	for (const GpuProfiler::PassSummary &summary : gpuProfiler.summarize())
+	{
+		gpu[summary.name] = percentiles(summary.ms);
+	}
+	report["gpuMs"] = gpu;
+	if (const double computeMs = gpuProfiler.computeMsPerFrame(); computeMs > 0)
+	{
+		report["asyncCompute"] =
+		{
+			{ "msPerFrame", computeMs },
+			{ "overlap", gpuProfiler.computeOverlap() } // fraction of it spent beside graphics work
+		};
+	}
+	if (cullFrames > 0)
+	{
+		// averages over every frame read back, warmup included
+		const double perFrame = 1.0 / static_cast<double>(cullFrames);
+		report["culling"] =
+		{
+			{ "drawn", totalDrawn * perFrame },
+			{ "frustumCulled", totalFrustumCulled * perFrame },
+			{ "occluded", totalOccluded * perFrame }
+		};
+	}
+	if (const std::vector<double> statistics = gpuProfiler.statisticAverages(); !statistics.empty())
+	{
+		report["pipelineStatistics"] =
+		{
+			{ "vertexInvocations", statistics[GpuProfiler::VertexInvocations] },
+			{ "clippingPrimitives", statistics[GpuProfiler::ClippingPrimitives] },
+			{ "fragmentInvocations", statistics[GpuProfiler::FragmentInvocations] }
+		};
+	}
+
+	// VMA's view of each heap, usage includes memory allocated outside of VMA
+	json heaps = json::array();
+	for (const GpuMemory::HeapStats &heap : gpuMemory.heapStats())
+	{
+		heaps.push_back(
+		{
+			{ "deviceLocal", heap.deviceLocal },
+			{ "size", heap.size },
+			{ "allocationBytes", heap.allocationBytes },
+			{ "blockBytes", heap.blockBytes },
+			{ "usage", heap.usage },
+			{ "budget", heap.budget }
+		});
+	}
+	json categories = json::object();
+	for (uint32_t category = 0; category < GpuMemory::CategoryCount; ++category)
+	{
+		const GpuMemory::Category tag = static_cast<GpuMemory::Category>(category);
+		categories[GpuMemory::categoryName(tag)] = { { "bytes", gpuMemory.usage(tag) }, { "peakBytes", gpuMemory.peakUsage(tag) } };
+	}
+	report["memory"] = { { "heaps", heaps }, { "categories", categories }, { "budgetLimit", static_cast<uint64_t>(config.memoryBudget) << 20 } };
+
+	std::ofstream out(config.benchmarkReport, std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cerr << "Unable to write benchmark report: " << config.benchmarkReport << std::endl;
+		return;
+	}
+	out << report.dump(2) << std::endl;
+	std::cout << "Wrote benchmark report to " << config.benchmarkReport << std::endl;
+}
+
+void Application::waitForPresent()
+{
+	if (pendingPresentId == 0)
+	{
+		return;
+	}
+
+	// bounded, a minimized or occluded window may never present
+	CPU_ZONE("wait present");
+	constexpr uint64_t PresentTimeoutNs = 100'000'000;
+	const VkResult result = vkWaitForPresentKHR(device, swapchain, pendingPresentId, PresentTimeoutNs);
+	if (result == VK_SUCCESS)
+	{
+		// present wait returns once the image started scanning out, the closest to photons the API gets
+		latencyTotalMs += static_cast<double>(SDL_GetTicksNS() - pendingInputTime) / 1e6;
+		++latencySamples;
+	}
+	else if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		requireSwapchainRecreate = true;
+	}
+	pendingPresentId = 0;
+}
+
+bool Application::initializeVulkan()
+{
+	if (!createVulkanInstance())
+	{
+		showError("Couldn't create a vulkan instance");
+		return false;
+	}
+
+	if (!createSurface())
+	{
+		showError("Couldn't create window surface");
+		return false;
+	}
+
+	if (physicalDevice = findPhysicalDevice(); !physicalDevice)
+	{
+		showError("Unable to find an appropriate physical device");
+		return false;
+	}
+
+	if (!findGraphicsQueue())
+	{
+		showError("Unable to find a compatible graphics queue");
+		return false;
+	}
+	findTransferQueue();
+	findComputeQueue();
+
+	if (!createDevice(physicalDevice))
+	{
+		showError("Couldn't create the logical GPU device");
+		return false;
+	}
+
+	if (!initializeVMA())
+	{
+		showError("Unable to create Vulkan Memory Allocator");
+		return false;
+	}
+
+	// every pipeline layout references the bindless set, so it has to exist before any of them
+	if (!createBindlessResources())
+	{
+		showError("Couldn't create the bindless texture set");
+		return false;
+	}
+	if (occlusionCullingEnabled && !createOcclusionCullingResources())
+	{
+		showError("Couldn't create the depth pyramid sampler and set layout");
+		return false;
+	}
+
+	if (offscreenEnabled ? !createOffscreenTargets() : !createSwapchain(width, height))
+	{
+		showError("Unable to create swapchain");
+		return false;
+	}
+	endStartupPhase("device");
+
+	if (!createShaders(programs))
+	{
+		showError("Error creating shader modules");
+		return false;
+	}
+	endStartupPhase("shaders");
+
+	createPipelineCache();
+	if (!createPipelines(programs))
+	{
+		return false;
+	}
+	endStartupPhase("pipelines");
+
+	if (!createSyncResources())
+	{
+		showError("Couldn't create the sync related resources");
+		return false;
+	}
+
+	if (!createCommandBuffers())
+	{
+		showError("Couldn't create command buffer objects");
+		return false;
+	}
+
+	for (FrameResources &res : std::span(frameResources).first(framesInFlight))
+	{
+		// async compute copies transforms out of the same arena the graphics queue uses
+		if (!res.arena.initialize(device, gpuMemory, FrameArenaSize, sharedQueueFamilies))
+		{
+			showError("Couldn't allocate the per frame arenas");
+			return false;
+		}
+	}
+
+	// render targets it replaces stay alive until the frames still using them are done
+	renderGraph.initialize(device, gpuMemory, [this](std::function<void()> destroy) { deferDeletion(std::move(destroy)); });
+
+	if (!uploadEngine.initialize(physicalDevice, device, gpuMemory, transferQueue, transferQueueFamIdx, gfxQueueFamIdx))
+	{
+		showError("Couldn't initialize the upload engine");
+		return false;
+	}
+
+	// benchmarks always profile, with a history covering every measured frame
+	const bool benchmark = config.benchmarkFrames > 0;
+	const bool profileGpu = benchmark || config.gpuProfiler || config.pipelineStatistics || !config.gpuProfileDump.empty();
+	const uint32_t profileHistory = benchmark ? config.benchmarkFrames : GpuProfiler::DefaultHistoryLength;
+	if (profileGpu && !gpuProfiler.initialize(physicalDevice, device, gfxTimestampValidBits, framesInFlight, config.pipelineStatistics,
+		!config.gpuProfileDump.empty(), profileHistory))
+	{
+		showError("Couldn't initialize the GPU profiler");
+		return false;
+	}
+	if (asyncComputeEnabled && !gpuProfiler.enableComputeQueue(computeTimestampValidBits))
+	{
+		showError("Couldn't create the GPU profiler's compute queue queries");
+		return false;
+	}
+	endStartupPhase("frame resources");
+
+	return true;
+}
+
+bool Application::createVulkanInstance()
+{
+	// Initialize Volk and load Vk function pointers
+	if (volkInitialize() != VK_SUCCESS)
+	{
+		showError("Error initializing Volk");
+		return false;
+	}
+
+	// Create the vulkan application instance
+	VkApplicationInfo appInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		.pApplicationName = "My First Triangle",
+		.apiVersion = VulkanVersion,
+	};
+
+	// find the required extensions for the platform and add debug for ourselves
+	uint32_t instExtCount = 0;
+	const char *const *extensions = SDL_Vulkan_GetInstanceExtensions(&instExtCount);
+	std::vector<const char *> requestedExtensions
+	{
+		VK_EXT_DEBUG_UTILS_EXTENSION_NAME
+	};
+	for (int i = 0; i < instExtCount; ++i)
+	{
+		requestedExtensions.push_back(extensions[i]);
+	}
+
+	// swapchain maintenance is only usable with the surface side enabled on the instance
+	uint32_t availableCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(availableCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, availableExtensions.data());
+	auto hasExtension = [&availableExtensions](const char *name)
+	{
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[name](const VkExtensionProperties &ext) { return std::strcmp(ext.extensionName, name) == 0; });
+	};
+	surfaceMaintenanceEnabled = hasExtension(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME) && hasExtension(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+	if (surfaceMaintenanceEnabled)
+	{
+		requestedExtensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+		requestedExtensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+	}
+
+
+	// we'll also need to enable the validation layer for error checking and reporting
+	std::vector<const char *> requestedLayers
+	{
+		"VK_LAYER_KHRONOS_validation"
+	};
+
+	VkDebugUtilsMessengerCreateInfoEXT debugInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+		.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+		.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+		.pfnUserCallback = debugCallback
+	};
+
+	VkInstanceCreateInfo instCreateInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pNext = &debugInfo,
+		.pApplicationInfo = &appInfo,
+		.enabledLayerCount = static_cast<uint32_t>(requestedLayers.size()),
+		.ppEnabledLayerNames = requestedLayers.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(requestedExtensions.size()),
+		.ppEnabledExtensionNames = requestedExtensions.data()
+	};
+
+	if (vkCreateInstance(&instCreateInfo, nullptr, &vulkanInstance) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	volkLoadInstance(vulkanInstance);
+	return true;
+}
+
+bool Application::createSurface()
+{
+	if (!SDL_Vulkan_CreateSurface(window, vulkanInstance, nullptr, &surface))
+	{
+		return false;
+	}
+	return true;
+}
+
+VkPhysicalDevice Application::findPhysicalDevice()
+{
+	// enumerate all physical devices
+	uint32_t physDeviceCount = 0;
+	vkEnumeratePhysicalDevices(vulkanInstance, &physDeviceCount, nullptr);
+	std::vector<VkPhysicalDevice> physicalDevices(physDeviceCount);
+	vkEnumeratePhysicalDevices(vulkanInstance, &physDeviceCount, physicalDevices.data());
+
+	VkPhysicalDevice physicalDevice = nullptr;
+	if (physDeviceCount)
+	{
+		// if you have issues, you can always just hardcode a GPU index while learning
+		physicalDevice = physicalDevices[0]; // default to first GPU
+		// look through list and see if a dGPU exists
+		for (auto &pDev : physicalDevices)
+		{
+			VkPhysicalDeviceProperties props{};
+			vkGetPhysicalDeviceProperties(pDev, &props);
+			if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+			{
+				physicalDevice = pDev;
+				break;
+			}
+		}
+	}
+	return physicalDevice;
+}
+
+bool Application::findGraphicsQueue()
+{
+	// eventually we'll have more complex queue lookup for presentation, etc
+	// grab all of the queue families
+	uint32_t queueFamCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, nullptr);
+	std::vector<VkQueueFamilyProperties2> queueFamProps(queueFamCount, { .sType = VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2 });
+	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, queueFamProps.data());
+
+	for (int currentFamIdx = 0; currentFamIdx < queueFamProps.size(); currentFamIdx++)
+	{
+		// ensure it has presentation support
+		VkBool32 hasPresentSupport = VK_FALSE;
+		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, currentFamIdx, surface, &hasPresentSupport);
+
+		const auto &props = queueFamProps[currentFamIdx];
+		// ensure this is a GRAPHICS queue with presentation support
+		if (props.queueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT && hasPresentSupport)
+		{
+			gfxQueueFamIdx = currentFamIdx;
+			gfxTimestampValidBits = props.queueFamilyProperties.timestampValidBits;
+			return true;
+		}
+	}
+	return false;
+}
+
+void Application::findTransferQueue()
+{
+	uint32_t queueFamCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, nullptr);
+	std::vector<VkQueueFamilyProperties2> queueFamProps(queueFamCount, { .sType = VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2 });
+	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, queueFamProps.data());
+
+	// prefer a transfer-only family (DMA engine), then any non-graphics family with transfer support
+	uint32_t computeFamIdx = UINT32_MAX;
+	for (uint32_t currentFamIdx = 0; currentFamIdx < queueFamProps.size(); currentFamIdx++)
+	{
+		const VkQueueFamilyProperties &props = queueFamProps[currentFamIdx].queueFamilyProperties;
+		const VkExtent3D &granularity = props.minImageTransferGranularity;
+
+		// texture copies are arbitrarily sized, so the family must allow texel granularity
+		const bool texelGranularity = granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+		if (!(props.queueFlags & VK_QUEUE_TRANSFER_BIT) || props.queueFlags & VK_QUEUE_GRAPHICS_BIT || !texelGranularity)
+		{
+			continue;
+		}
+
+		if (!(props.queueFlags & VK_QUEUE_COMPUTE_BIT))
+		{
+			transferQueueFamIdx = currentFamIdx;
+			return;
+		}
+		else if (computeFamIdx == UINT32_MAX)
+		{
+			computeFamIdx = currentFamIdx;
+		}
+	}
+
+	// falls back to the graphics family when nothing else is available
+	transferQueueFamIdx = computeFamIdx != UINT32_MAX ? computeFamIdx : gfxQueueFamIdx;
+}
+
+void Application::findComputeQueue()
+{
+	uint32_t queueFamCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, nullptr);
+	std::vector<VkQueueFamilyProperties2> queueFamProps(queueFamCount, { .sType = VK_STRUCTURE_TYPE_QUEUE_FAMILY_PROPERTIES_2 });
+	vkGetPhysicalDeviceQueueFamilyProperties2(physicalDevice, &queueFamCount, queueFamProps.data());
+
+	// only a family without graphics runs beside the graphics queue, a second graphics queue
+	// is usually time sliced on the same hardware queue
+	for (uint32_t currentFamIdx = 0; currentFamIdx < queueFamProps.size(); currentFamIdx++)
+	{
+		const VkQueueFamilyProperties &props = queueFamProps[currentFamIdx].queueFamilyProperties;
+		if (!(props.queueFlags & VK_QUEUE_COMPUTE_BIT) || props.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			continue;
+		}
+
+		// uploads may have taken this family, a second queue keeps the two from serializing
+		const bool sharesTransfer = currentFamIdx == transferQueueFamIdx;
+		if (computeQueueFamIdx == UINT32_MAX || (!sharesTransfer && computeQueueFamIdx == transferQueueFamIdx))
+		{
+			computeQueueFamIdx = currentFamIdx;
+			computeQueueIndex = sharesTransfer && props.queueCount > 1 ? 1 : 0;
+			computeTimestampValidBits = props.timestampValidBits;
+		}
+	}
+}
+
+bool Application::createDevice(VkPhysicalDevice physicalDevice)
+{
+	// optional extensions, only chained into the feature queries when the device exposes them
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+	auto hasExtension = [&availableExtensions](const char *name)
+	{
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+			[name](const VkExtensionProperties &ext) { return std::strcmp(ext.extensionName, name) == 0; });
+	};
+	const bool meshShaderExtension = config.meshShading && hasExtension(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+	const bool shaderObjectExtension = config.shaderObjects && hasExtension(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+	const bool presentWaitExtension = config.lowLatency && hasExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && hasExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	memoryBudgetEnabled = hasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	const bool swapchainMaintenanceExtension = surfaceMaintenanceEnabled && hasExtension(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+
+	// query supported features
+	VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT supportedSwapchainMaintenanceFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT, .pNext = nullptr };
+	VkPhysicalDeviceShaderObjectFeaturesEXT supportedShaderObjectFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT, .pNext = nullptr };
+	VkPhysicalDeviceMeshShaderFeaturesEXT supportedMeshFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT, .pNext = nullptr };
+	VkPhysicalDevicePresentIdFeaturesKHR supportedPresentIdFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR, .pNext = nullptr };
+	VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWaitFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR, .pNext = &supportedPresentIdFeatures };
+	void *supportedExtensionFeatures = nullptr;
+	if (swapchainMaintenanceExtension)
+	{
+		supportedSwapchainMaintenanceFeatures.pNext = supportedExtensionFeatures;
+		supportedExtensionFeatures = &supportedSwapchainMaintenanceFeatures;
+	}
+	if (presentWaitExtension)
+	{
+		supportedPresentIdFeatures.pNext = supportedExtensionFeatures;
+		supportedExtensionFeatures = &supportedPresentWaitFeatures;
+	}
+	if (shaderObjectExtension)
+	{
+		supportedShaderObjectFeatures.pNext = supportedExtensionFeatures;
+		supportedExtensionFeatures = &supportedShaderObjectFeatures;
+	}
+	if (meshShaderExtension)
+	{
+		supportedMeshFeatures.pNext = supportedExtensionFeatures;
+		supportedExtensionFeatures = &supportedMeshFeatures;
+	}
+	VkPhysicalDeviceVulkan14Features supportedFeatures14{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES, .pNext = supportedExtensionFeatures };
+	VkPhysicalDeviceVulkan13Features supportedFeatures13{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES, .pNext = &supportedFeatures14 };
+	VkPhysicalDeviceVulkan12Features supportedFeatures12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES, .pNext = &supportedFeatures13 };
+	VkPhysicalDeviceFeatures2 supportedFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supportedFeatures12 };
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+
+	// check if what we need is supported, extended dynamic state 1 and 2 are core since 1.3
+	if (!supportedFeatures13.dynamicRendering || !supportedFeatures13.synchronization2 ||
+		!supportedFeatures12.timelineSemaphore)
+	{
+		showError("Physical device doesn't meet the feature requirements");
+		return false;
+	}
+	// the bindless texture array is indexed per material, and filled while it is bound
+	if (!supportedFeatures12.runtimeDescriptorArray || !supportedFeatures12.descriptorBindingPartiallyBound ||
+		!supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind || !supportedFeatures12.shaderSampledImageArrayNonUniformIndexing)
+	{
+		showError("Physical device doesn't support the descriptor indexing features bindless textures need");
+		return false;
+	}
+
+	VkPhysicalDeviceVulkan12Properties properties12{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+	VkPhysicalDeviceProperties2 properties{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &properties12 };
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+	bindlessTextureCapacity = std::min({ MaxBindlessTextures, properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+		properties12.maxPerStageDescriptorUpdateAfterBindSampledImages });
+	maxSamplerAnisotropy = supportedFeatures.features.samplerAnisotropy ? std::min(16.0f, properties.properties.limits.maxSamplerAnisotropy) : 0.0f;
+	const bool depthReduction = supportedFeatures12.samplerFilterMinmax && properties12.filterMinmaxSingleComponentFormats;
+
+	// mesh shading is optional, then GPU-driven indirect draws, and per sub-mesh CPU draws are the fallback
+	meshShadingEnabled = meshShaderExtension && supportedMeshFeatures.taskShader && supportedMeshFeatures.meshShader &&
+		properties.properties.limits.maxPushConstantsSize >= sizeof(Renderer::MeshletConstants);
+	gpuDrivenEnabled = !meshShadingEnabled && config.gpuDriven && supportedFeatures12.drawIndirectCount &&
+		supportedFeatures.features.multiDrawIndirect && supportedFeatures.features.drawIndirectFirstInstance;
+	// the pyramid is built with max reduction samplers and bound as push descriptors
+	occlusionCullingEnabled = gpuDrivenEnabled && config.occlusionCulling && depthReduction && supportedFeatures14.pushDescriptor;
+	shaderObjectsEnabled = shaderObjectExtension && supportedShaderObjectFeatures.shaderObject;
+	// streamed images are swapped into slots no pending frame samples while the set stays bound
+	textureStreamingEnabled = config.textureStreaming && supportedFeatures12.descriptorBindingUpdateUnusedWhilePending;
+	presentWaitEnabled = presentWaitExtension && supportedPresentIdFeatures.presentId && supportedPresentWaitFeatures.presentWait;
+	presentFencesEnabled = swapchainMaintenanceExtension && supportedSwapchainMaintenanceFeatures.swapchainMaintenance1;
+	asyncComputeEnabled = gpuDrivenEnabled && config.asyncCompute && computeQueueFamIdx != UINT32_MAX;
+	cullSlotCount = asyncComputeEnabled ? framesInFlight : 1;
+	instancingEnabled = !meshShadingEnabled && !gpuDrivenEnabled && config.instancing;
+	cpuCullingEnabled = !meshShadingEnabled && !gpuDrivenEnabled && config.cpuCulling;
+	const bool pipelineStatistics = config.pipelineStatistics && supportedFeatures.features.pipelineStatisticsQuery;
+	inheritedQueriesEnabled = pipelineStatistics && supportedFeatures.features.inheritedQueries;
+	if (config.lowLatency && !presentWaitEnabled)
+	{
+		std::cerr << "Low latency mode needs VK_KHR_present_id and VK_KHR_present_wait, ignored" << std::endl;
+	}
+
+	// produce a separate features struct chain for device creation
+	VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenanceFeatures
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT,
+		.pNext = nullptr,
+		.swapchainMaintenance1 = VK_TRUE
+	};
+	VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT,
+		.pNext = nullptr,
+		.shaderObject = VK_TRUE
+	};
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshFeatures
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+		.pNext = nullptr,
+		.taskShader = VK_TRUE,
+		.meshShader = VK_TRUE
+	};
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.pNext = nullptr,
+		.presentId = VK_TRUE
+	};
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.pNext = &presentIdFeatures,
+		.presentWait = VK_TRUE
+	};
+	void *extensionFeatures = nullptr;
+	if (presentFencesEnabled)
+	{
+		swapchainMaintenanceFeatures.pNext = extensionFeatures;
+		extensionFeatures = &swapchainMaintenanceFeatures;
+	}
+	if (presentWaitEnabled)
+	{
+		presentIdFeatures.pNext = extensionFeatures;
+		extensionFeatures = &presentWaitFeatures;
+	}
+	if (shaderObjectsEnabled)
+	{
+		shaderObjectFeatures.pNext = extensionFeatures;
+		extensionFeatures = &shaderObjectFeatures;
+	}
+	if (meshShadingEnabled)
+	{
+		meshFeatures.pNext = extensionFeatures;
+		extensionFeatures = &meshFeatures;
+	}
+	VkPhysicalDeviceVulkan14Features features14
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES,
+		.pNext = extensionFeatures,
+		.pushDescriptor = occlusionCullingEnabled ? VK_TRUE : VK_FALSE
+	};
+	VkPhysicalDeviceVulkan13Features features13
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+		.pNext = &features14,
+		.synchronization2 = VK_TRUE,
+		.dynamicRendering = VK_TRUE,
+	};
+	VkPhysicalDeviceVulkan12Features features12
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+		.pNext = &features13,
+		.drawIndirectCount = gpuDrivenEnabled ? VK_TRUE : VK_FALSE,
+		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+		.descriptorBindingUpdateUnusedWhilePending = textureStreamingEnabled ? VK_TRUE : VK_FALSE,
+		.descriptorBindingPartiallyBound = VK_TRUE,
+		.runtimeDescriptorArray = VK_TRUE,
+		.samplerFilterMinmax = occlusionCullingEnabled ? VK_TRUE : VK_FALSE,
+		.scalarBlockLayout = VK_TRUE,
+		.timelineSemaphore = VK_TRUE,
+		.bufferDeviceAddress = VK_TRUE
+	};
+	VkPhysicalDeviceFeatures2 features{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+		.pNext = &features12,
+		.features
+		{
+			.multiDrawIndirect = gpuDrivenEnabled ? VK_TRUE : VK_FALSE,
+			.drawIndirectFirstInstance = gpuDrivenEnabled ? VK_TRUE : VK_FALSE,
+			.samplerAnisotropy = maxSamplerAnisotropy > 0 ? VK_TRUE : VK_FALSE,
+			.pipelineStatisticsQuery = pipelineStatistics ? VK_TRUE : VK_FALSE,
+			.shaderInt64 = VK_TRUE,
+			.inheritedQueries = inheritedQueriesEnabled ? VK_TRUE : VK_FALSE
+		}
+	};
+
+	// request the queues we'll be using, the compute queue is either its own family or a second transfer family queue
+	std::vector<float> queuePriorities{ 1.0f, 1.0f };
+	std::vector<VkDeviceQueueCreateInfo> queueInfos
+	{
+		{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = gfxQueueFamIdx,
+			.queueCount = 1,
+			.pQueuePriorities = queuePriorities.data()
+		}
+	};
+	if (transferQueueFamIdx != gfxQueueFamIdx)
+	{
+		queueInfos.push_back(VkDeviceQueueCreateInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = transferQueueFamIdx,
+			.queueCount = asyncComputeEnabled && computeQueueFamIdx == transferQueueFamIdx ? computeQueueIndex + 1 : 1,
+			.pQueuePriorities = queuePriorities.data()
+		});
+	}
+	if (asyncComputeEnabled && computeQueueFamIdx != transferQueueFamIdx)
+	{
+		queueInfos.push_back(VkDeviceQueueCreateInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = computeQueueFamIdx,
+			.queueCount = 1,
+			.pQueuePriorities = queuePriorities.data()
+		});
+	}
+
+	// device specific extensions
+	std::vector<const char *> deviceExtensions{ VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	if (meshShadingEnabled)
+	{
+		deviceExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+		VkPhysicalDeviceMeshShaderPropertiesEXT meshProps{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT };
+		VkPhysicalDeviceProperties2 props{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &meshProps };
+		vkGetPhysicalDeviceProperties2(physicalDevice, &props);
+		maxTaskWorkGroupCount = meshProps.maxTaskWorkGroupCount[0];
+	}
+	if (shaderObjectsEnabled)
+	{
+		deviceExtensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+	}
+	if (presentWaitEnabled)
+	{
+		deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	}
+	if (memoryBudgetEnabled)
+	{
+		deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	if (presentFencesEnabled)
+	{
+		deviceExtensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+	}
+
+	VkDeviceCreateInfo devCreateInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = &features,
+		.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size()),
+		.pQueueCreateInfos = queueInfos.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
+		.ppEnabledExtensionNames = deviceExtensions.data(),
+		.pEnabledFeatures = nullptr // features struct chain is set in pNext
+	};
+
+	if (vkCreateDevice(physicalDevice, &devCreateInfo, nullptr, &device) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// grab the VkQueue object finally
+	vkGetDeviceQueue(device, gfxQueueFamIdx, 0, &gfxQueue);
+	if (!gfxQueue)
+	{
+		showError("Couldn't get the graphics queue");
+		return false;
+	}
+
+	// uploads share the graphics queue if no dedicated family was found
+	vkGetDeviceQueue(device, transferQueueFamIdx, 0, &transferQueue);
+	if (!transferQueue)
+	{
+		showError("Couldn't get the transfer queue");
+		return false;
+	}
+
+	// buffers the compute queue writes and the graphics queue reads are shared concurrently instead of
+	// having their ownership transferred twice a frame
+	if (asyncComputeEnabled)
+	{
+		vkGetDeviceQueue(device, computeQueueFamIdx, computeQueueIndex, &computeQueue);
+		if (!computeQueue)
+		{
+			showError("Couldn't get the compute queue");
+			return false;
+		}
+		sharedQueueFamilies = { gfxQueueFamIdx, computeQueueFamIdx };
+		if (transferQueueFamIdx != gfxQueueFamIdx && transferQueueFamIdx != computeQueueFamIdx)
+		{
+			sharedQueueFamilies.push_back(transferQueueFamIdx);
+		}
+	}
+	// textures get their mip chains blitted on the graphics queue
+	VkFormatProperties formatProps{};
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, textureFormat, &formatProps);
+	constexpr VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	mipBlitSupported = (formatProps.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+	std::cout << "Upload queue family: " << transferQueueFamIdx << (transferQueueFamIdx != gfxQueueFamIdx ? " (dedicated)" : " (shared with graphics)") << std::endl;
+	if (asyncComputeEnabled)
+	{
+		std::cout << "Async compute queue family: " << computeQueueFamIdx << (computeQueueFamIdx == transferQueueFamIdx ?
+			(computeQueueIndex > 0 ? " (second queue of the upload family)" : " (shares the upload queue)") : "") << std::endl;
+	}
+	else if (gpuDrivenEnabled && config.asyncCompute)
+	{
+		std::cerr << "No compute family without graphics, culling stays on the graphics queue" << std::endl;
+	}
+	const char *renderPath = meshShadingEnabled ? "mesh shaders" : gpuDrivenEnabled ? "GPU-driven indirect" : "CPU draws";
+	std::cout << "Render path: " << renderPath << (shaderObjectsEnabled ? " with shader objects" : " with pipelines")
+		<< (occlusionCullingEnabled ? ", occlusion culling" : "") << std::endl;
+	std::cout << "Frames in flight: " << framesInFlight << (presentWaitEnabled ? ", low latency pacing" : "") << std::endl;
+	return true;
+}
+
+bool Application::initializeVMA()
+{
+	return gpuMemory.initialize(vulkanInstance, physicalDevice, device, VulkanVersion, memoryBudgetEnabled,
+		static_cast<VkDeviceSize>(config.memoryBudget) << 20);
+}
+
+bool Application::createSwapchain(uint32_t width, uint32_t height)
+{
+	swapchainWidth = width;
+	swapchainHeight = height;
+
+	VkSurfaceCapabilitiesKHR surfaceCaps{};
+	if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &surfaceCaps) != VK_SUCCESS)
+	{
+		showError("Couldn't get the surface capabilities");
+		return false;
+	}
+
+	// the requested present mode when the surface offers it, FIFO is the one mode every surface has
+	uint32_t presentModeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
+	std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
+	constexpr std::array<VkPresentModeKHR, 4> presentModeMap{ VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+	VkPresentModeKHR presentMode = presentModeMap[static_cast<uint32_t>(config.presentMode)];
+	if (std::find(presentModes.begin(), presentModes.end(), presentMode) == presentModes.end())
+	{
+		std::cerr << "Requested present mode isn't supported by the surface, using FIFO" << std::endl;
+		presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	// mailbox needs a spare image to replace, otherwise the minimum keeps the present queue short
+	uint32_t imageCount = surfaceCaps.minImageCount + (presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 1 : 0);
+	if (surfaceCaps.maxImageCount != 0)
+	{
+		imageCount = std::min(imageCount, surfaceCaps.maxImageCount);
+	}
+
+	VkSwapchainCreateInfoKHR swapchainCreateInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.surface = surface,
+		.minImageCount = imageCount,
+		.imageFormat = swapchainFormat,
+		.imageColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR,
+		.imageExtent{.width = swapchainWidth, .height = swapchainHeight },
+		.imageArrayLayers = 1,
+		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
+		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+		.presentMode = presentMode,
+		.oldSwapchain = swapchain // lets the driver hand resources over while the old images are still queued
+	};
+
+	VkSwapchainKHR newSwapchain = nullptr;
+	if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, &newSwapchain) != VK_SUCCESS)
+	{
+		showError("Error creating swapchain");
+		return false;
+	}
+
+	// the retired swapchain lives until the present engine is done with its last present, which also waited
+	// for the frames drawing into its images. The frame timeline can't tell, presents aren't on it
+	if (swapchain)
+	{
+		if (!presentFencesEnabled)
+		{
+			vkQueueWaitIdle(gfxQueue);
+		}
+		retiredSwapchains.push_back(RetiredSwapchain
+		{
+			.swapchain = swapchain,
+			.views = std::move(swapchainImageViews),
+			.renderCompleteSemaphores = std::move(renderCompleteSemaphores)
+		});
+		swapchainImageViews.clear();
+		renderCompleteSemaphores.clear();
+		pendingPresentId = 0; // present IDs belong to the swapchain they were presented to
+		retireSwapchains(false);
+	}
+	swapchain = newSwapchain;
+
+	// grab the swapchain images
+	vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
+	swapchainImages.resize(imageCount);
+	vkGetSwapchainImagesKHR(device, swapchain, &imageCount, swapchainImages.data());
+	swapchainImageViews.resize(imageCount);
+
+	// create the swapchain image views
+	for (size_t i = 0; i < swapchainImages.size(); ++i)
+	{
+		VkImageViewCreateInfo imgViewInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = swapchainImages[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = swapchainFormat,
+			.subresourceRange
+			{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.levelCount = 1,
+				.layerCount = 1
+			}
+		};
+
+		if (vkCreateImageView(device, &imgViewInfo, nullptr, &swapchainImageViews[i]) != VK_SUCCESS)
+		{
+			showError("Error creating swapchain image view");
+			return false;
+		}
+	}
+
+	// semaphores used to signal render completion
+	renderCompleteSemaphores.resize(swapchainImages.size());
+	for (VkSemaphore &semaphore : renderCompleteSemaphores)
+	{
+		VkSemaphoreCreateInfo semaphoreInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		{
+			showError("Error creating the render-complete semaphore");
+			return false;
+		}
+	}
+
+	sizeRenderTargets();
+	return true;
+}
+
+bool Application::createOffscreenTargets()
+{
+	swapchainWidth = width;
+	swapchainHeight = height;
+
+	swapchainImages.resize(framesInFlight);
+	swapchainImageViews.resize(framesInFlight);
+	offscreenAllocations.resize(framesInFlight);
+	for (uint32_t i = 0; i < framesInFlight; ++i)
+	{
+		// transfer source so a frame can be read back for inspection
+		VkImageCreateInfo imageInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = swapchainFormat,
+			.extent{.width = swapchainWidth, .height = swapchainHeight, .depth = 1 },
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+		};
+		VmaAllocationCreateInfo allocInfo{ .usage = VMA_MEMORY_USAGE_AUTO };
+		if (!gpuMemory.createImage(GpuMemory::RenderTargets, imageInfo, allocInfo, swapchainImages[i], offscreenAllocations[i]))
+		{
+			showError("Error allocating offscreen image");
+			return false;
+		}
+
+		VkImageViewCreateInfo viewInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = swapchainImages[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = swapchainFormat,
+			.subresourceRange{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1}
+		};
+		if (vkCreateImageView(device, &viewInfo, nullptr, &swapchainImageViews[i]) != VK_SUCCESS)
+		{
+			showError("Error creating offscreen image view");
+			return false;
+		}
+	}
+	sizeRenderTargets();
+	return true;
+}
+
+void Application::sizeRenderTargets()
+{
+	// rendering only covers the swapchain extent, grown to cover both so dragging a window edge back and forth
+	// doesn't reallocate every frame
+	depthExtent.width = std::max(depthExtent.width, swapchainWidth);
+	depthExtent.height = std::max(depthExtent.height, swapchainHeight);
+
+	// rounded down, so every level halves exactly and a texel always covers a 2x2 block of the one above
+	depthPyramidExtent = { std::bit_floor(std::max(swapchainWidth, 1u)), std::bit_floor(std::max(swapchainHeight, 1u)) };
+	depthPyramidLevels = std::min(MaxDepthPyramidLevels, static_cast<uint32_t>(std::bit_width(std::max(depthPyramidExtent.width, depthPyramidExtent.height))));
+}
+
+void Application::retireSwapchains(bool wait)
+{
+	for (size_t i = 0; i < pendingPresents.size();)
+	{
+		const VkFence fence = pendingPresents[i].fence;
+		const bool done = wait ? vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS : vkGetFenceStatus(device, fence) == VK_SUCCESS;
+		if (!done)
+		{
+			++i;
+			continue;
+		}
+		vkResetFences(device, 1, &fence);
+		freePresentFences.push_back(fence);
+		pendingPresents[i] = pendingPresents.back();
+		pendingPresents.pop_back();
+	}
+
+	std::erase_if(retiredSwapchains, [this](const RetiredSwapchain &retired)
+	{
+		if (std::any_of(pendingPresents.begin(), pendingPresents.end(), [&retired](const PendingPresent &present) { return present.swapchain == retired.swapchain; }))
+		{
+			return false;
+		}
+		for (VkImageView view : retired.views)
+		{
+			vkDestroyImageView(device, view, nullptr);
+		}
+		for (VkSemaphore semaphore : retired.renderCompleteSemaphores)
+		{
+			vkDestroySemaphore(device, semaphore, nullptr);
+		}
+		vkDestroySwapchainKHR(device, retired.swapchain, nullptr);
+		return true;
+	});
+}
+
+VkFence Application::acquirePresentFence()
+{
+	if (!freePresentFences.empty())
+	{
+		const VkFence fence = freePresentFences.back();
+		freePresentFences.pop_back();
+		return fence;
+	}
+	VkFenceCreateInfo fenceInfo{ .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	VkFence fence = nullptr;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		std::cerr << "Error creating a present fence" << std::endl;
+		return nullptr;
+	}
+	return fence;
+}
+
+void Application::destroySwapchain()
+{
+	pendingPresentId = 0;
+
+	// the device being idle says nothing about the present engine, its fences do
+	retireSwapchains(true);
+	for (VkFence fence : freePresentFences)
+	{
+		vkDestroyFence(device, fence, nullptr);
+	}
+	freePresentFences.clear();
+
+	for (VkImageView swapchainImgView : swapchainImageViews)
+	{
+		vkDestroyImageView(device, swapchainImgView, nullptr);
+	}
+	swapchainImageViews.clear();
+
+	// offscreen targets are our own images, swapchain images belong to the swapchain
+	for (size_t i = 0; i < offscreenAllocations.size(); ++i)
+	{
+		gpuMemory.destroyImage(swapchainImages[i], offscreenAllocations[i]);
+	}
+	offscreenAllocations.clear();
+
+	// destroy render-complete ssemaphores
+	for (VkSemaphore &semaphore : renderCompleteSemaphores)
+	{
+		vkDestroySemaphore(device, semaphore, nullptr);
+	}
+	renderCompleteSemaphores.clear();
+
+	if (swapchain)
+	{
+		vkDestroySwapchainKHR(device, swapchain, nullptr);
+		swapchain = nullptr;
+	}
+
+	// the render graph reallocates its targets once they're sized for the next swapchain
+	depthExtent = {};
+	depthPyramidExtent = {};
+}
+
+bool Application::createBindlessResources()
+{
+	// one trilinear sampler for every material, baked into the layout as an immutable sampler
+	VkSamplerCreateInfo samplerInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.anisotropyEnable = maxSamplerAnisotropy > 0 ? VK_TRUE : VK_FALSE,
+		.maxAnisotropy = maxSamplerAnisotropy,
+		.maxLod = VK_LOD_CLAMP_NONE
+	};
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// slots are only written once their image exists, partially bound leaves the rest undefined
+	const std::array<VkDescriptorSetLayoutBinding, 2> bindings
+	{
+		VkDescriptorSetLayoutBinding
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.pImmutableSamplers = &textureSampler
+		},
+		VkDescriptorSetLayoutBinding
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			.descriptorCount = bindlessTextureCapacity,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
+		}
+	};
+	const VkDescriptorBindingFlags streamingFlags = textureStreamingEnabled ? VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT : 0;
+	const std::array<VkDescriptorBindingFlags, 2> bindingFlags{ 0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | streamingFlags };
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.bindingCount = static_cast<uint32_t>(bindingFlags.size()),
+		.pBindingFlags = bindingFlags.data()
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &bindingFlagsInfo,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	};
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &bindlessSetLayout) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	const std::array<VkDescriptorPoolSize, 2> poolSizes
+	{
+		VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_SAMPLER, .descriptorCount = 1 },
+		VkDescriptorPoolSize{ .type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .descriptorCount = bindlessTextureCapacity }
+	};
+	VkDescriptorPoolCreateInfo poolInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &bindlessPool) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = bindlessPool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &bindlessSetLayout
+	};
+	if (vkAllocateDescriptorSets(device, &allocInfo, &bindlessSet) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	std::cout << "Bindless textures: " << bindlessTextureCapacity << " slots" << std::endl;
+	return true;
+}
+
+bool Application::createOcclusionCullingResources()
+{
+	// a linear fetch with max reduction returns the farthest of the 2x2 texels under it, nearest between levels
+	VkSamplerReductionModeCreateInfo reductionInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO,
+		.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX
+	};
+	VkSamplerCreateInfo samplerInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.pNext = &reductionInfo,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.maxLod = VK_LOD_CLAMP_NONE
+	};
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &depthReduceSampler) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	// pushed per dispatch, the reduction rebinds source and destination for every level
+	const std::array<VkDescriptorSetLayoutBinding, 2> bindings
+	{
+		VkDescriptorSetLayoutBinding
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+			.pImmutableSamplers = &depthReduceSampler
+		},
+		VkDescriptorSetLayoutBinding
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+		}
+	};
+	VkDescriptorSetLayoutCreateInfo layoutInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT,
+		.bindingCount = static_cast<uint32_t>(bindings.size()),
+		.pBindings = bindings.data()
+	};
+	return vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &depthPyramidSetLayout) == VK_SUCCESS;
+}
+
+#ifndef VULKANAPP_SPIRV_DIR
+// resolves #include "file" against the shader directory, recording each file for the SPIR-V cache
+class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+	struct Include
+	{
+		std::string name;
+		std::string content;
+		shaderc_include_result result{};
+	};
+
+	std::vector<ShaderCache::Dependency> &dependencies;
+
+public:
+	explicit ShaderIncluder(std::vector<ShaderCache::Dependency> &dependencies) : dependencies(dependencies) {}
+
+	shaderc_include_result *GetInclude(const char *requestedSource, shaderc_include_type type, const char *requestingSource, size_t includeDepth) override
+	{
+		Include *include = new Include;
+		include->name = std::string("src/shaders/") + requestedSource;
+		include->content = readTextFile(include->name);
+		if (include->content.empty())
+		{
+			// an empty source name reports the content as the error message
+			include->name.clear();
+			include->content = std::string("Unable to open include file: ") + requestedSource;
+		}
+		else
+		{
+			dependencies.push_back({ include->name, fnv1a(include->content.data(), include->content.size()) });
+		}
+		include->result = shaderc_include_result
+		{
+			.source_name = include->name.data(),
+			.source_name_length = include->name.size(),
+			.content = include->content.data(),
+			.content_length = include->content.size(),
+			.user_data = include
+		};
+		return &include->result;
+	}
+
+	void ReleaseInclude(shaderc_include_result *data) override
+	{
+		delete static_cast<Include *>(data->user_data);
+	}
+};
+#endif
+
+bool Application::loadShaderCode(const std::string &fileName, shaderc_shader_kind kind, const std::vector<std::string> &defines, std::vector<uint32_t> &spv) const
+{
+	const std::string variant = ShaderCache::variantName(fileName, defines);
+#ifdef VULKANAPP_SPIRV_DIR
+	// SPIR-V compiled by the build, shaderc isn't linked into this configuration at all
+	const std::string spirvPath = std::string(VULKANAPP_SPIRV_DIR "/") + variant + ".spv";
+	if (!ShaderCache::readSpirv(spirvPath, spv))
+	{
+		showError("Precompiled shader doesn't exist: " + spirvPath);
+		return false;
+	}
+#else
+	// read shader file from disk
+	const std::string shaderPath = "src/shaders/" + fileName;
+	const std::string src = readTextFile(shaderPath);
+	if (src.empty())
+	{
+		showError("Specified shader file doesn't exist: " + shaderPath);
+		return false;
+	}
+
+	// everything that changes the output goes into the key, included files are checked by the cache entry
+	constexpr shaderc_env_version targetEnv = shaderc_env_version_vulkan_1_4;
+	constexpr shaderc_spirv_version targetSpirv = shaderc_spirv_version_1_6;
+	constexpr shaderc_optimization_level optimizationLevel = shaderc_optimization_level_performance;
+	uint64_t compileKey = fnv1a(src.data(), src.size());
+	for (const uint32_t setting : { static_cast<uint32_t>(kind), static_cast<uint32_t>(targetEnv), static_cast<uint32_t>(targetSpirv),
+		static_cast<uint32_t>(optimizationLevel), ShaderCache::Version })
+	{
+		compileKey = fnv1a(&setting, sizeof(setting), compileKey);
+	}
+	for (const std::string &define : defines)
+	{
+		compileKey = fnv1a(define.data(), define.size() + 1, compileKey); // the terminator separates the names
+	}
+
+	const std::string cacheFile = ShaderCache::cachePath(variant, compileKey);
+	if (ShaderCache::load(cacheFile, compileKey, spv))
+	{
+		std::cout << "Loaded cached shader: " << variant << std::endl;
+	}
+	else
+	{
+		// compile the shader to SPIR-V
+		std::cout << "Compiling shader: " << shaderPath << std::endl;
+		std::vector<ShaderCache::Dependency> dependencies;
+		shaderc::Compiler compiler;
+		shaderc::CompileOptions opts;
+		opts.SetTargetEnvironment(shaderc_target_env_vulkan, targetEnv);
+		opts.SetTargetSpirv(targetSpirv);
+		opts.SetOptimizationLevel(optimizationLevel);
+		opts.SetIncluder(std::make_unique<ShaderIncluder>(dependencies));
+		for (const std::string &define : defines)
+		{
+			opts.AddMacroDefinition(define);
+		}
+		shaderc::CompilationResult result = compiler.CompileGlslToSpv(src, kind, fileName.c_str(), opts);
+
+		if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+		{
+			std::cerr << "Shader Compilation Error: " << result.GetErrorMessage() << std::endl;
+			return false;
+		}
+		spv = { result.cbegin(), result.cend() };
+		ShaderCache::store(cacheFile, compileKey, dependencies, spv);
+	}
+#endif
+	return true;
+}
+
+VkShaderModule Application::createShaderModule(const std::string &fileName, shaderc_shader_kind kind, const std::vector<std::string> &defines) const
+{
+	std::vector<uint32_t> spv;
+	if (!loadShaderCode(fileName, kind, defines, spv))
+	{
+		return nullptr;
+	}
+
+	// pass spir-v to vulkan and create shader-module
+	VkShaderModuleCreateInfo moduleCreateInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = spv.size() * sizeof(uint32_t),
+		.pCode = spv.data()
+	};
+	VkShaderModule shaderModule = nullptr;
+	if (vkCreateShaderModule(device, &moduleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		showError("Error creating shader module");
+		return nullptr;
+	}
+	return shaderModule;
+}
+
+VkShaderEXT Application::createShaderObject(const std::string &fileName, shaderc_shader_kind kind, const std::vector<std::string> &defines,
+	VkShaderStageFlagBits stage, VkShaderStageFlags nextStage, const VkPushConstantRange &pushConstants) const
+{
+	std::vector<uint32_t> spv;
+	if (!loadShaderCode(fileName, kind, defines, spv))
+	{
+		return nullptr;
+	}
+
+	// left unlinked, so vertex and fragment stages can be swapped independently without a link step
+	VkShaderCreateInfoEXT shaderInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+		.stage = stage,
+		.nextStage = nextStage,
+		.codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+		.codeSize = spv.size() * sizeof(uint32_t),
+		.pCode = spv.data(),
+		.pName = "main",
+		.setLayoutCount = 1,
+		.pSetLayouts = &bindlessSetLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstants
+	};
+	VkShaderEXT shader = nullptr;
+	if (vkCreateShadersEXT(device, 1, &shaderInfo, nullptr, &shader) != VK_SUCCESS)
+	{
+		std::cerr << "Error creating shader object: " << fileName << std::endl;
+		return nullptr;
+	}
+	return shader;
+}
+
+bool Application::createShaders(ShaderPrograms &programs) const
+{
+	// create the shader modules that we'll need for the graphics pipeline
+	std::vector<std::string> vertDefines;
+	if (config.vertexFormat == VertexFormat::Compact)
+	{
+		vertDefines.push_back("COMPACT_VERTEX");
+	}
+	std::vector<std::string> cullDefines;
+	if (occlusionCullingEnabled)
+	{
+		cullDefines.push_back("OCCLUSION_CULLING");
+	}
+
+	if (shaderObjectsEnabled)
+	{
+		// every stage bound together has to declare the same push constant ranges, so the
+		// fragment shader takes those of whichever geometry path is active
+		if (meshShadingEnabled)
+		{
+			const VkPushConstantRange pushConstants{ .stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, .size = sizeof(Renderer::MeshletConstants) };
+			programs.taskObject = createShaderObject("meshlet.task", shaderc_task_shader, {}, VK_SHADER_STAGE_TASK_BIT_EXT, VK_SHADER_STAGE_MESH_BIT_EXT, pushConstants);
+			programs.meshObject = createShaderObject("meshlet.mesh", shaderc_mesh_shader, vertDefines, VK_SHADER_STAGE_MESH_BIT_EXT, VK_SHADER_STAGE_FRAGMENT_BIT, pushConstants);
+			programs.fragObject = createShaderObject("shader.frag", shaderc_fragment_shader, {}, VK_SHADER_STAGE_FRAGMENT_BIT, 0, pushConstants);
+			if (!programs.taskObject || !programs.meshObject || !programs.fragObject)
+			{
+				return false;
+			}
+		}
+		else
+		{
+			const VkPushConstantRange pushConstants{ .stageFlags = VK_SHADER_STAGE_VERTEX_BIT, .size = sizeof(Renderer::DrawConstants) };
+			programs.vertObject = createShaderObject("shader.vert", shaderc_vertex_shader, vertDefines, VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, pushConstants);
+			programs.fragObject = createShaderObject("shader.frag", shaderc_fragment_shader, {}, VK_SHADER_STAGE_FRAGMENT_BIT, 0, pushConstants);
+			if (!programs.vertObject || !programs.fragObject)
+			{
+				return false;
+			}
+		}
+		if (gpuDrivenEnabled)
+		{
+			if (programs.cullShader = createShaderModule("cull.comp", shaderc_compute_shader, cullDefines); !programs.cullShader)
+			{
+				return false;
+			}
+		}
+		if (occlusionCullingEnabled)
+		{
+			if (programs.depthReduceShader = createShaderModule("depth_reduce.comp", shaderc_compute_shader); !programs.depthReduceShader)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (programs.vertShader = createShaderModule("shader.vert", shaderc_vertex_shader, vertDefines); !programs.vertShader)
+	{
+		return false;
+	}
+	if (programs.fragShader = createShaderModule("shader.frag", shaderc_fragment_shader); !programs.fragShader)
+	{
+		return false;
+	}
+
+	// the mesh shader path reuses the fragment shader
+	if (meshShadingEnabled)
+	{
+		if (programs.taskShader = createShaderModule("meshlet.task", shaderc_task_shader); !programs.taskShader)
+		{
+			return false;
+		}
+		if (programs.meshShader = createShaderModule("meshlet.mesh", shaderc_mesh_shader, vertDefines); !programs.meshShader)
+		{
+			return false;
+		}
+	}
+	if (gpuDrivenEnabled)
+	{
+		if (programs.cullShader = createShaderModule("cull.comp", shaderc_compute_shader, cullDefines); !programs.cullShader)
+		{
+			return false;
+		}
+	}
+	if (occlusionCullingEnabled)
+	{
+		if (programs.depthReduceShader = createShaderModule("depth_reduce.comp", shaderc_compute_shader); !programs.depthReduceShader)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void Application::createPipelineCache()
+{
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	const std::vector<char> initialData = PipelineCache::load(PipelineCache::FilePath, properties);
+
+	VkPipelineCacheCreateInfo cacheInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = initialData.size(),
+		.pInitialData = initialData.data()
+	};
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+	{
+		// a rejected blob shouldn't cost us the cache for this run
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+		{
+			std::cerr << "Unable to create a pipeline cache, pipelines will be compiled from scratch" << std::endl;
+			pipelineCache = nullptr;
+		}
+	}
+	std::cout << "Pipeline cache: " << initialData.size() / 1024.0 << " KB loaded from " << PipelineCache::FilePath << std::endl;
+}
+
+void Application::savePipelineCache() const
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+	data.resize(dataSize);
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	PipelineCache::store(PipelineCache::FilePath, properties, data);
+}
+
+void Application::recordPipelineFeedback(const VkPipelineCreationFeedback &feedback) const
+{
+	// drivers are free not to report anything
+	if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) == 0)
+	{
+		return;
+	}
+	if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+	{
+		pipelineCacheHits++;
+	}
+	else
+	{
+		pipelineCacheMisses++;
+	}
+}
+
+bool Application::createPipelines(ShaderPrograms &programs)
+{
+	struct PipelineJob
+	{
+		Pipeline *target = nullptr;
+		const char *name = nullptr;
+		std::function<Pipeline()> create;
+	};
+	std::vector<PipelineJob> jobs;
+	if (shaderObjectsEnabled)
+	{
+		// shader objects need nothing but the layouts to push constants through
+		const VkShaderStageFlags pushStages = meshShadingEnabled ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
+		Pipeline &target = meshShadingEnabled ? programs.meshletPipeline : programs.pipeline;
+		target.layout = createPipelineLayout(pushStages, meshShadingEnabled ? sizeof(Renderer::MeshletConstants) : sizeof(Renderer::DrawConstants));
+		if (!target.layout)
+		{
+			showError("Unable to create the shader object pipeline layout");
+			return false;
+		}
+	}
+	else
+	{
+		jobs.push_back({ &programs.pipeline, "graphics", [&]() { return createGraphicsPipeline(programs.vertShader, programs.fragShader); } });
+	}
+	if (meshShadingEnabled && !shaderObjectsEnabled)
+	{
+		jobs.push_back({ &programs.meshletPipeline, "mesh shader", [&]() { return createMeshletPipeline(programs.taskShader, programs.meshShader, programs.fragShader); } });
+	}
+	if (gpuDrivenEnabled)
+	{
+		jobs.push_back({ &programs.cullPipeline, "culling", [&]() { return createComputePipeline(programs.cullShader, sizeof(Renderer::CullConstants), depthPyramidSetLayout); } });
+	}
+	if (occlusionCullingEnabled)
+	{
+		jobs.push_back({ &programs.depthReducePipeline, "depth reduce", [&]() { return createComputePipeline(programs.depthReduceShader, sizeof(Renderer::DepthReduceConstants), depthPyramidSetLayout); } });
+	}
+
+	// the pipelines are independent and the cache is internally synchronized, so the driver compiles them concurrently
+	const auto start = std::chrono::steady_clock::now();
+	threadPool.parallelFor(jobs.size(), [&jobs](size_t i)
+	{
+		*jobs[i].target = jobs[i].create();
+	});
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	for (const PipelineJob &job : jobs)
+	{
+		if (!job.target->handle)
+		{
+			showError(std::string("Unable to initialize the ") + job.name + " pipeline");
+			return false;
+		}
+	}
+	std::cout << "Created " << jobs.size() << " pipelines in " << ms << " ms, pipeline cache hits " << pipelineCacheHits
+		<< ", misses " << pipelineCacheMisses << std::endl;
+	return true;
+}
+
+void Application::destroyPrograms(const ShaderPrograms &programs) const
+{
+	for (const Pipeline &pipeline : { programs.pipeline, programs.meshletPipeline, programs.cullPipeline, programs.depthReducePipeline })
+	{
+		if (pipeline.layout)
+		{
+			vkDestroyPipelineLayout(device, pipeline.layout, nullptr);
+		}
+		if (pipeline.handle)
+		{
+			vkDestroyPipeline(device, pipeline.handle, nullptr);
+		}
+	}
+	for (VkShaderModule shader : { programs.vertShader, programs.fragShader, programs.taskShader, programs.meshShader, programs.cullShader, programs.depthReduceShader })
+	{
+		if (shader)
+		{
+			vkDestroyShaderModule(device, shader, nullptr);
+		}
+	}
+	for (VkShaderEXT shader : { programs.vertObject, programs.fragObject, programs.taskObject, programs.meshObject })
+	{
+		if (shader)
+		{
+			vkDestroyShaderEXT(device, shader, nullptr);
+		}
+	}
+}
+
+void Application::watchShaders(std::stop_token stopToken)
+{
+	// polling is plenty for a handful of files, and sees edits from any editor or save strategy
+	auto snapshot = []()
+	{
+		std::map<std::string, std::filesystem::file_time_type> times;
+		std::error_code ec;
+		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator("src/shaders", ec))
+		{
+			times[entry.path().string()] = entry.last_write_time(ec);
+		}
+		return times;
+	};
+
+	std::map<std::string, std::filesystem::file_time_type> known = snapshot();
+	std::mutex sleepMutex;
+	std::condition_variable_any sleeper;
+	while (!stopToken.stop_requested())
+	{
+		{
+			std::unique_lock lock(sleepMutex);
+			sleeper.wait_for(lock, stopToken, std::chrono::milliseconds(250), []() { return false; });
+		}
+		std::map<std::string, std::filesystem::file_time_type> current = snapshot();
+		if (stopToken.stop_requested() || current == known)
+		{
+			continue;
+		}
+		known = std::move(current);
+
+		// unchanged shaders come straight out of the SPIR-V cache, so rebuilding every program stays cheap
+		std::cout << "Shader change detected, rebuilding pipelines" << std::endl;
+		ShaderPrograms rebuilt;
+		if (!createShaders(rebuilt) || !createPipelines(rebuilt))
+		{
+			std::cerr << "Shader reload failed, keeping the current pipelines" << std::endl;
+			destroyPrograms(rebuilt);
+			continue;
+		}
+
+		std::scoped_lock lock(reloadMutex);
+		if (reloadedPrograms)
+		{
+			destroyPrograms(*reloadedPrograms); // superseded before it was ever used
+		}
+		reloadedPrograms = rebuilt;
+	}
+}
+
+void Application::applyShaderReload()
+{
+	std::optional<ShaderPrograms> rebuilt;
+	{
+		std::scoped_lock lock(reloadMutex);
+		rebuilt.swap(reloadedPrograms);
+	}
+	if (!rebuilt)
+	{
+		return;
+	}
+
+	// earlier frames may still be executing with the old programs
+	std::swap(programs, *rebuilt);
+	deferDeletion([this, retired = *rebuilt]() { destroyPrograms(retired); });
+	std::cout << "Shader reload applied" << std::endl;
+}
+
+void Application::deferDeletion(std::function<void()> destroy)
+{
+	// the frame being recorded may still reference the object, so it lives until that frame's value is signalled
+	deletionQueue.push_back(DeferredDeletion{ .timelineValue = timelineValue, .destroy = std::move(destroy) });
+}
+
+void Application::processDeletions(bool flushAll)
+{
+	uint64_t completed = UINT64_MAX;
+	if (!flushAll)
+	{
+		vkGetSemaphoreCounterValue(device, timelineSemaphore, &completed);
+	}
+	while (!deletionQueue.empty() && deletionQueue.front().timelineValue <= completed)
+	{
+		deletionQueue.front().destroy();
+		deletionQueue.pop_front();
+	}
+}
+
+void Application::defragmentMemory()
+{
+	// buffers are only reached through these members, so a move swaps the handle and queries the new address
+	const std::array movable{ &vertexBuffer, &indexBuffer, &indexBuffer16, &meshletBuffer, &meshletDataBuffer, &taskGroupBuffer,
+		&transformBuffer, &drawDataBuffer, &drawCommandBuffer, &drawCountBuffer, &drawVisibilityBuffer, &drawLodBuffer, &materialBuffer };
+	auto owner = [&movable](VkBuffer buffer) -> Renderer::Buffer *
+	{
+		const auto found = std::find_if(movable.begin(), movable.end(), [buffer](const Renderer::Buffer *candidate) { return candidate->buffer == buffer; });
+		return found != movable.end() ? *found : nullptr;
+	};
+
+	// everything the load uploaded has to land before it can be copied, ownership is taken ahead of the first copy
+	uploadEngine.submit();
+	uploadEngine.wait(uploadEngine.lastSubmittedValue());
+	vkDeviceWaitIdle(device);
+	gpuMemory.defragment(gfxQueue, gfxQueueFamIdx,
+		[&owner](VkBuffer buffer) { return owner(buffer) != nullptr; },
+		[this, &owner](VkBuffer oldBuffer, VkBuffer newBuffer)
+		{
+			Renderer::Buffer &moved = *owner(oldBuffer);
+			moved.buffer = newBuffer;
+			if (moved.address != 0)
+			{
+				VkBufferDeviceAddressInfo bdaInfo{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = newBuffer };
+				moved.address = vkGetBufferDeviceAddress(device, &bdaInfo);
+			}
+		},
+		[this](VkCommandBuffer commandBuffer) { uploadEngine.recordAcquires(commandBuffer); });
+	uploadEngine.retire();
+}
+
+Pipeline Application::createGraphicsPipeline(VkShaderModule vertShader, VkShaderModule fragShader) const
+{
+	// configure the shader stages struct
+	const char *entryPoint = "main";
+	const std::vector<VkPipelineShaderStageCreateInfo> shaderStages
+	{
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_VERTEX_BIT,
+			.module = vertShader,
+			.pName = entryPoint
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = fragShader,
+			.pName = entryPoint
+		}
+	};
+	return createPipeline(shaderStages, VK_SHADER_STAGE_VERTEX_BIT, sizeof(Renderer::DrawConstants));
+}
+
+Pipeline Application::createMeshletPipeline(VkShaderModule taskShader, VkShaderModule meshShader, VkShaderModule fragShader) const
+{
+	const char *entryPoint = "main";
+	const std::vector<VkPipelineShaderStageCreateInfo> shaderStages
+	{
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_TASK_BIT_EXT,
+			.module = taskShader,
+			.pName = entryPoint
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_MESH_BIT_EXT,
+			.module = meshShader,
+			.pName = entryPoint
+		},
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = fragShader,
+			.pName = entryPoint
+		}
+	};
+	return createPipeline(shaderStages, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, sizeof(Renderer::MeshletConstants));
+}
+
+VkPipelineLayout Application::createPipelineLayout(VkShaderStageFlags pushConstantStages, uint32_t pushConstantSize, VkDescriptorSetLayout pushDescriptorLayout) const
+{
+	// buffers are reached through device addresses in the push constants, set 0 is the bindless texture
+	// array shared by every layout so they all stay compatible, compute passes may push images as set 1
+	const std::array<VkDescriptorSetLayout, 2> setLayouts{ bindlessSetLayout, pushDescriptorLayout };
+	VkPushConstantRange pushConstRange
+	{
+		.stageFlags = pushConstantStages,
+		.offset = 0,
+		.size = pushConstantSize
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = pushDescriptorLayout ? 2u : 1u,
+		.pSetLayouts = setLayouts.data(),
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstRange
+	};
+	VkPipelineLayout layout = nullptr;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		return nullptr;
+	}
+	return layout;
+}
+
+Pipeline Application::createComputePipeline(VkShaderModule shader, uint32_t pushConstantSize, VkDescriptorSetLayout pushDescriptorLayout) const
+{
+	Pipeline pipeline;
+	if (pipeline.layout = createPipelineLayout(VK_SHADER_STAGE_COMPUTE_BIT, pushConstantSize, pushDescriptorLayout); !pipeline.layout)
+	{
+		showError("Unable to create the compute pipeline layout");
+		return Pipeline{};
+	}
+
+	VkPipelineCreationFeedback creationFeedback{};
+	VkPipelineCreationFeedbackCreateInfo feedbackInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+		.pPipelineCreationFeedback = &creationFeedback
+	};
+	VkComputePipelineCreateInfo pipelineInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = &feedbackInfo,
+		.stage
+		{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = shader,
+			.pName = "main"
+		},
+		.layout = pipeline.layout
+	};
+	if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline.handle) != VK_SUCCESS)
+	{
+		showError("Error creating the compute pipeline");
+		return Pipeline{};
+	}
+	recordPipelineFeedback(creationFeedback);
+	return pipeline;
+}
+
+Pipeline Application::createPipeline(std::span<const VkPipelineShaderStageCreateInfo> shaderStages, VkShaderStageFlags pushConstantStages, uint32_t pushConstantSize) const
+{
+	// vertex pulling, don't define vertex input details (ignored entirely by mesh shader pipelines)
+	VkPipelineVertexInputStateCreateInfo vertInputInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO
+	};
+
+	// input assembly, we'll be drawing triangle lists
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST
+	};
+
+	// depth/stencil configuration
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.depthTestEnable = VK_TRUE,
+		.depthWriteEnable = VK_TRUE,
+		.depthCompareOp = VK_COMPARE_OP_LESS,
+		.stencilTestEnable = VK_FALSE
+	};
+
+	// viewport and scissor counts are dynamic too, we still need this struct though
+	VkPipelineViewportStateCreateInfo viewportInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 0,
+		.pViewports = nullptr,
+		.scissorCount = 0,
+		.pScissors = nullptr
+	};
+
+	// rasterizer settings
+	VkPipelineRasterizationStateCreateInfo rasterInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.polygonMode = VK_POLYGON_MODE_FILL,
+		.cullMode = VK_CULL_MODE_NONE,
+		//.cullMode = VK_CULL_MODE_BACK_BIT,
+		.frontFace = VK_FRONT_FACE_CLOCKWISE,
+		.lineWidth = 1.0f
+	};
+
+	// No multisampling
+	VkPipelineMultisampleStateCreateInfo multiSampleInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
+	};
+
+	// Alpha-blending (disabled for now), still need
+	// attachment info and write mask
+	VkPipelineColorBlendAttachmentState attachState
+	{
+		.blendEnable = VK_FALSE,
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+	};
+	VkPipelineColorBlendStateCreateInfo blendInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.attachmentCount = 1,
+		.pAttachments = &attachState
+	};
+
+	// enable dynamic state, the extended dynamic state set by bindGraphicsState overrides the
+	// rasterizer and depth values above, so materials don't need pipelines of their own
+	std::vector<VkDynamicState> dynamicState
+	{
+		VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT, VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT,
+		VK_DYNAMIC_STATE_CULL_MODE, VK_DYNAMIC_STATE_FRONT_FACE,
+		VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP
+	};
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = static_cast<uint32_t>(dynamicState.size()),
+		.pDynamicStates = dynamicState.data()
+	};
+
+	// reports whether the pipeline cache satisfied the creation
+	VkPipelineCreationFeedback creationFeedback{};
+	VkPipelineCreationFeedbackCreateInfo feedbackInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO,
+		.pPipelineCreationFeedback = &creationFeedback
+	};
+
+	// structure required for dynamic rendering
+	VkPipelineRenderingCreateInfo renderInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+		.pNext = &feedbackInfo,
+		.colorAttachmentCount = 1,
+		.pColorAttachmentFormats = &swapchainFormat,
+		.depthAttachmentFormat = depthFormat,
+	};
+
+	// Create the graphics pipeline
+	Pipeline pipeline;
+
+	// need to define a pipeline layout
+	if (pipeline.layout = createPipelineLayout(pushConstantStages, pushConstantSize); !pipeline.layout)
+	{
+		showError("Unable to create the pipeline layout");
+		return Pipeline{};
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.pNext = &renderInfo,
+		.stageCount = static_cast<uint32_t>(shaderStages.size()),
+		.pStages = shaderStages.data(),
+		.pVertexInputState = &vertInputInfo,
+		.pInputAssemblyState = &inputAssemblyInfo,
+		.pViewportState = &viewportInfo,
+		.pRasterizationState = &rasterInfo,
+		.pMultisampleState = &multiSampleInfo,
+		.pDepthStencilState = &depthStencilInfo,
+		.pColorBlendState = &blendInfo,
+		.pDynamicState = &dynamicStateInfo,
+		.layout = pipeline.layout,
+		.renderPass = VK_NULL_HANDLE,
+	};
+	if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline.handle) != VK_SUCCESS)
+	{
+		showError("Error creating the pipeline");
+		return Pipeline{};
+	}
+	recordPipelineFeedback(creationFeedback);
+	return pipeline;
+}
+
+bool Application::createSyncResources()
+{
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = timelineValue
+	};
+	VkSemaphoreCreateInfo semaphoreInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &semaphoreTypeInfo
+	};
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS)
+	{
+		showError("Unable to create the timeline semaphore");
+		return false;
+	}
+	// signalled with the frame ID once that frame's compute work is done
+	if (asyncComputeEnabled && vkCreateSemaphore(device, &semaphoreInfo, nullptr, &computeSemaphore) != VK_SUCCESS)
+	{
+		showError("Unable to create the async compute timeline semaphore");
+		return false;
+	}
+
+	// per-frame image-acquire semaphores
+	for (FrameResources &res : std::span(frameResources).first(framesInFlight))
+	{
+		// create the binary semaphores
+		VkSemaphoreCreateInfo semaphoreInfo{ .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &res.imageAcquiredSemaphore) != VK_SUCCESS)
+		{
+			showError("Error creating the per-frame image-acquire semaphore");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Application::createCommandBuffers()
+{
+	for (FrameResources &res : std::span(frameResources).first(framesInFlight))
+	{
+		// we'll give each frame its own pool, faster cmd buffer resets this way
+		VkCommandPoolCreateInfo poolInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.queueFamilyIndex = gfxQueueFamIdx
+		};
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &res.commandPool) != VK_SUCCESS)
+		{
+			showError("Unable to create command buffer pool");
+			return false;
+		}
+
+		// create the command buffer for this frame
+		VkCommandBufferAllocateInfo cmdAllocInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = res.commandPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+
+		if (vkAllocateCommandBuffers(device, &cmdAllocInfo, &res.commandBuffer) != VK_SUCCESS)
+		{
+			showError("Unable to allocate command buffer");
+			return false;
+		}
+
+		if (asyncComputeEnabled)
+		{
+			VkCommandPoolCreateInfo computePoolInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+				.queueFamilyIndex = computeQueueFamIdx
+			};
+			if (vkCreateCommandPool(device, &computePoolInfo, nullptr, &res.computePool) != VK_SUCCESS)
+			{
+				showError("Unable to create compute command buffer pool");
+				return false;
+			}
+			VkCommandBufferAllocateInfo computeAllocInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = res.computePool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = 1,
+			};
+			if (vkAllocateCommandBuffers(device, &computeAllocInfo, &res.computeCommandBuffer) != VK_SUCCESS)
+			{
+				showError("Unable to allocate compute command buffer");
+				return false;
+			}
+		}
+
+		// one secondary per thread that can take part in a parallelFor, each from its own pool
+		const uint32_t recordSlots = config.parallelRecording ? threadPool.size() + 1 : 0;
+		res.recordPools.resize(recordSlots);
+		res.recordCommandBuffers.resize(recordSlots);
+		for (uint32_t slot = 0; slot < recordSlots; ++slot)
+		{
+			if (vkCreateCommandPool(device, &poolInfo, nullptr, &res.recordPools[slot]) != VK_SUCCESS)
+			{
+				showError("Unable to create recording command buffer pool");
+				return false;
+			}
+			VkCommandBufferAllocateInfo secondaryAllocInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = res.recordPools[slot],
+				.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+				.commandBufferCount = 1,
+			};
+			if (vkAllocateCommandBuffers(device, &secondaryAllocInfo, &res.recordCommandBuffers[slot]) != VK_SUCCESS)
+			{
+				showError("Unable to allocate secondary command buffer");
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool Application::updateTransforms(VkCommandBuffer commandBuffer, FrameArena &arena, bool computeQueue)
+{
+	const auto [begin, end] = scene.update();
+	if (begin >= end || transformBuffer.buffer == nullptr)
+	{
+		return false;
+	}
+	if (cpuCullingEnabled)
+	{
+		drawCuller.updateWorlds(scene.worlds(), begin, end);
+	}
+
+	// earlier frames may still read the matrices being replaced, on the compute queue the graphics
+	// reads are covered by the semaphore wait and only culling is left in this queue
+	VkPipelineStageFlags2 readStages = computeQueue ? VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT :
+		VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	if (meshShadingEnabled)
+	{
+		readStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+	}
+	VkMemoryBarrier2 writeBarrier
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = readStages,
+		.srcAccessMask = VK_ACCESS_2_NONE,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT
+	};
+	VkDependencyInfo writeDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &writeBarrier };
+	vkCmdPipelineBarrier2(commandBuffer, &writeDep);
+
+	// only the rewritten node range goes up, copied out of the frame arena so it never bloats the command buffer
+	const std::span<const glm::mat4> worlds = scene.worlds().subspan(begin, end - begin);
+	const VkDeviceSize byteSize = worlds.size_bytes();
+	if (const FrameArena::Allocation staged = arena.write(worlds, 16); staged.data)
+	{
+		const VkBufferCopy region{ .srcOffset = staged.offset, .dstOffset = begin * sizeof(glm::mat4), .size = byteSize };
+		vkCmdCopyBuffer(commandBuffer, staged.buffer, transformBuffer.buffer, 1, &region);
+	}
+	else
+	{
+		// arena full, inline updates take at most 64 KB at a time
+		constexpr VkDeviceSize maxUpdateSize = 65536;
+		const std::byte *data = std::as_bytes(worlds).data();
+		for (VkDeviceSize offset = 0; offset < byteSize; offset += maxUpdateSize)
+		{
+			vkCmdUpdateBuffer(commandBuffer, transformBuffer.buffer, begin * sizeof(glm::mat4) + offset,
+				std::min(maxUpdateSize, byteSize - offset), data + offset);
+		}
+	}
+
+	VkMemoryBarrier2 readBarrier
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = readStages,
+		.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+	};
+	VkDependencyInfo readDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &readBarrier };
+	vkCmdPipelineBarrier2(commandBuffer, &readDep);
+	return true;
+}
+
+void Application::updateMaterials(VkCommandBuffer commandBuffer, FrameArena &arena)
+{
+	if (!materialsDirty || materialBuffer.buffer == nullptr)
+	{
+		return;
+	}
+	materialsDirty = false;
+
+	// earlier frames may still read the texture slots being replaced
+	const VkPipelineStageFlags2 readStages = meshShadingEnabled ? VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT : VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+	VkMemoryBarrier2 writeBarrier
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = readStages,
+		.srcAccessMask = VK_ACCESS_2_NONE,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT
+	};
+	VkDependencyInfo writeDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &writeBarrier };
+	vkCmdPipelineBarrier2(commandBuffer, &writeDep);
+
+	// the whole table is small, and it has to land this frame since the replaced images are deleted after it
+	const std::span<const Renderer::Material> table(materials);
+	const VkDeviceSize byteSize = table.size_bytes();
+	if (const FrameArena::Allocation staged = arena.write(table, 16); staged.data)
+	{
+		const VkBufferCopy region{ .srcOffset = staged.offset, .dstOffset = 0, .size = byteSize };
+		vkCmdCopyBuffer(commandBuffer, staged.buffer, materialBuffer.buffer, 1, &region);
+	}
+	else
+	{
+		constexpr VkDeviceSize maxUpdateSize = 65536;
+		const std::byte *data = std::as_bytes(table).data();
+		for (VkDeviceSize offset = 0; offset < byteSize; offset += maxUpdateSize)
+		{
+			vkCmdUpdateBuffer(commandBuffer, materialBuffer.buffer, offset, std::min(maxUpdateSize, byteSize - offset), data + offset);
+		}
+	}
+
+	VkMemoryBarrier2 readBarrier
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = readStages,
+		.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+	};
+	VkDependencyInfo readDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &readBarrier };
+	vkCmdPipelineBarrier2(commandBuffer, &readDep);
+}
+
+void Application::recordCulling(VkCommandBuffer commandBuffer, const glm::mat4 &viewProj, uint32_t flags)
+{
+	if (drawCount == 0)
+	{
+		return;
+	}
+
+	// the late phase appends to the counts of the early one
+	if ((flags & Renderer::CullLate) == 0)
+	{
+		// last frame's indirect and count reads must finish before the counts are reset and the commands rewritten,
+		// and its late phase must have written the visibility the early phase reads
+		VkMemoryBarrier2 resetBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		};
+		VkDependencyInfo resetDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &resetBarrier };
+		vkCmdPipelineBarrier2(commandBuffer, &resetDep);
+		vkCmdFillBuffer(commandBuffer, drawCountBuffer.buffer, cullSlot * sizeof(Renderer::DrawCounts), sizeof(Renderer::DrawCounts), 0);
+
+		VkMemoryBarrier2 clearBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		};
+		VkDependencyInfo clearDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &clearBarrier };
+		vkCmdPipelineBarrier2(commandBuffer, &clearDep);
+	}
+
+	Renderer::CullConstants cullConsts
+	{
+		.drawDataAddress = drawDataBuffer.address,
+		.transformAddress = transformBuffer.address,
+		.commandAddress = drawCommandBuffer.address + cullSlot * 2 * drawCount * sizeof(VkDrawIndexedIndirectCommand),
+		.countAddress = drawCountBuffer.address + cullSlot * sizeof(Renderer::DrawCounts),
+		.visibilityAddress = drawVisibilityBuffer.address ? drawVisibilityBuffer.address + visibilitySlot * drawCount * sizeof(uint32_t) : 0,
+		.lodAddress = drawLodBuffer.address,
+		.viewProj = viewProj,
+		.drawCount = drawCount,
+		.commandOffset32 = drawCount16,
+		.flags = flags,
+		.lodScale = lodScale
+	};
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, programs.cullPipeline.handle);
+	if (flags & Renderer::CullOcclusion)
+	{
+		// the pyramid stays in the general layout it was written in
+		VkDescriptorImageInfo pyramidInfo{ .imageView = renderGraph.view(depthPyramidTarget), .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+		VkWriteDescriptorSet pyramidWrite
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstBinding = 0,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.pImageInfo = &pyramidInfo
+		};
+		vkCmdPushDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, programs.cullPipeline.layout, 1, 1, &pyramidWrite);
+	}
+	vkCmdPushConstants(commandBuffer, programs.cullPipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Renderer::CullConstants), &cullConsts);
+	vkCmdDispatch(commandBuffer, (drawCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+	VkMemoryBarrier2 indirectBarrier
+	{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+		.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT
+	};
+	VkDependencyInfo indirectDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &indirectBarrier };
+	vkCmdPipelineBarrier2(commandBuffer, &indirectDep);
+}
+
+void Application::recordAsyncCompute(FrameResources &res, uint32_t frameResIndex, uint64_t frameId, const glm::mat4 &viewProj)
+{
+	vkResetCommandPool(device, res.computePool, 0);
+	VkCommandBufferBeginInfo cmdBeginInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	vkBeginCommandBuffer(res.computeCommandBuffer, &cmdBeginInfo);
+	gpuProfiler.beginFrame(res.computeCommandBuffer, frameResIndex, frameId, GpuProfiler::ComputeQueue);
+
+	gpuProfiler.beginScope(res.computeCommandBuffer, "transforms");
+	const bool transformsChanged = updateTransforms(res.computeCommandBuffer, res.arena, true);
+	gpuProfiler.endScope(res.computeCommandBuffer);
+
+	gpuProfiler.beginScope(res.computeCommandBuffer, "culling");
+	recordCulling(res.computeCommandBuffer, viewProj, occlusionCullingEnabled ? Renderer::CullEarly : 0u);
+	gpuProfiler.endScope(res.computeCommandBuffer);
+
+	gpuProfiler.endFrame(res.computeCommandBuffer);
+	vkEndCommandBuffer(res.computeCommandBuffer);
+	res.arena.flush(); // the graphics recording flushes again with whatever it adds
+
+	// the cull slot was last used framesInFlight frames ago, which the CPU already waited for. Rewritten
+	// transforms must wait until the previous frame stopped drawing with them, and the visibility until the
+	// late culling two frames back wrote it, otherwise the compute work runs beside the previous frame
+	uint64_t graphicsWaitValue = 0;
+	if (transformsChanged)
+	{
+		graphicsWaitValue = frameId - 1;
+	}
+	else if (occlusionCullingEnabled && frameId > 2)
+	{
+		graphicsWaitValue = frameId - 2;
+	}
+	std::vector<VkSemaphoreSubmitInfo> semaphoreWaits;
+	if (graphicsWaitValue)
+	{
+		semaphoreWaits.push_back(VkSemaphoreSubmitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = timelineSemaphore,
+			.value = graphicsWaitValue,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+		});
+	}
+	// concurrent buffers skip the ownership acquire, so the wait alone makes their uploads visible here
+	if (const uint64_t uploadWaitValue = uploadEngine.lastSubmittedValue())
+	{
+		semaphoreWaits.push_back(VkSemaphoreSubmitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = uploadEngine.semaphore(),
+			.value = uploadWaitValue,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+		});
+	}
+	VkSemaphoreSubmitInfo semaphoreSignal
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = computeSemaphore,
+		.value = frameId,
+		.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+	};
+	VkCommandBufferSubmitInfo cmdSubmitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		.commandBuffer = res.computeCommandBuffer,
+	};
+	VkSubmitInfo2 submitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		.waitSemaphoreInfoCount = static_cast<uint32_t>(semaphoreWaits.size()),
+		.pWaitSemaphoreInfos = semaphoreWaits.data(),
+		.commandBufferInfoCount = 1,
+		.pCommandBufferInfos = &cmdSubmitInfo,
+		.signalSemaphoreInfoCount = 1,
+		.pSignalSemaphoreInfos = &semaphoreSignal
+	};
+	{
+		CPU_ZONE("compute submit");
+		vkQueueSubmit2(computeQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+}
+
+void Application::buildDepthPyramid(VkCommandBuffer commandBuffer)
+{
+	// each level reads the one above it, the first reads only the rendered part of the depth image
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, programs.depthReducePipeline.handle);
+	for (uint32_t level = 0; level < depthPyramidLevels; ++level)
+	{
+		const VkDescriptorImageInfo sourceInfo
+		{
+			.imageView = level == 0 ? renderGraph.view(depthTarget) : renderGraph.levelView(depthPyramidTarget, level - 1),
+			.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+		};
+		const VkDescriptorImageInfo destinationInfo{ .imageView = renderGraph.levelView(depthPyramidTarget, level), .imageLayout = VK_IMAGE_LAYOUT_GENERAL };
+		const std::array<VkWriteDescriptorSet, 2> writes
+		{
+			VkWriteDescriptorSet
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstBinding = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &sourceInfo
+			},
+			VkWriteDescriptorSet
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.dstBinding = 1,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				.pImageInfo = &destinationInfo
+			}
+		};
+		vkCmdPushDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, programs.depthReducePipeline.layout, 1,
+			static_cast<uint32_t>(writes.size()), writes.data());
+
+		const uint32_t levelWidth = std::max(1u, depthPyramidExtent.width >> level);
+		const uint32_t levelHeight = std::max(1u, depthPyramidExtent.height >> level);
+		const Renderer::DepthReduceConstants reduceConsts
+		{
+			.size = glm::vec2(levelWidth, levelHeight),
+			.uvScale = level == 0 ? glm::vec2(static_cast<float>(swapchainWidth) / depthExtent.width, static_cast<float>(swapchainHeight) / depthExtent.height) : glm::vec2(1)
+		};
+		vkCmdPushConstants(commandBuffer, programs.depthReducePipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Renderer::DepthReduceConstants), &reduceConsts);
+		vkCmdDispatch(commandBuffer, (levelWidth + DepthReduceGroupSize - 1) / DepthReduceGroupSize, (levelHeight + DepthReduceGroupSize - 1) / DepthReduceGroupSize, 1);
+
+		// the next level samples what was just written, the graph orders the late culling pass after the last one
+		if (level + 1 == depthPyramidLevels)
+		{
+			break;
+		}
+		VkMemoryBarrier2 levelBarrier
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT
+		};
+		VkDependencyInfo levelDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &levelBarrier };
+		vkCmdPipelineBarrier2(commandBuffer, &levelDep);
+	}
+}
+
+void Application::readCullCounts(FrameResources &res)
+{
+	// the frame that copied these finished on the timeline, so its counts are final
+	if (!res.cullCounts.data)
+	{
+		return;
+	}
+	res.arena.invalidate(res.cullCounts, sizeof(Renderer::DrawCounts));
+	std::memcpy(&lastDrawCounts, res.cullCounts.data, sizeof(Renderer::DrawCounts));
+	res.cullCounts = {};
+
+	++cullFrames;
+	for (const auto &phase : lastDrawCounts.drawn)
+	{
+		totalDrawn += phase[0] + phase[1];
+	}
+	totalFrustumCulled += lastDrawCounts.frustumCulled;
+	totalOccluded += lastDrawCounts.occluded;
+}
+
+void Application::reportCulling()
+{
+	// a few times a second is readable, every frame would only make the title flicker
+	constexpr uint64_t TitleIntervalNs = 250'000'000;
+	if (cullFrames == 0 || nowTime - titleUpdateTime < TitleIntervalNs)
+	{
+		return;
+	}
+	titleUpdateTime = nowTime;
+
+	const uint32_t early = lastDrawCounts.drawn[0][0] + lastDrawCounts.drawn[0][1];
+	const uint32_t late = lastDrawCounts.drawn[1][0] + lastDrawCounts.drawn[1][1];
+	std::string title = "Vulkan Learning - " + std::to_string(early + late) + " of " + std::to_string(drawCount) + " drawn";
+	if (occlusionCullingEnabled)
+	{
+		title += " (" + std::to_string(early) + " early, " + std::to_string(late) + " late), " +
+			std::to_string(lastDrawCounts.occluded) + " occluded";
+	}
+	title += ", " + std::to_string(lastDrawCounts.frustumCulled) + " outside the frustum";
+	SDL_SetWindowTitle(window, title.c_str());
+}
+
+void Application::bindGraphicsState(VkCommandBuffer commandBuffer, const Renderer::RasterState &state) const
+{
+	if (shaderObjectsEnabled)
+	{
+		// every graphics stage the device has enabled must be bound, the unused geometry path gets null
+		constexpr std::array<VkShaderStageFlagBits, 4> stages{ VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_TASK_BIT_EXT, VK_SHADER_STAGE_MESH_BIT_EXT };
+		const std::array<VkShaderEXT, 4> shaders{ programs.vertObject, programs.fragObject, programs.taskObject, programs.meshObject };
+		vkCmdBindShadersEXT(commandBuffer, meshShadingEnabled ? 4 : 2, stages.data(), shaders.data());
+
+		// nothing is baked, so the state a pipeline would have held is all set here
+		const VkSampleMask sampleMask = ~0u;
+		const VkBool32 blendEnable = VK_FALSE;
+		const VkColorComponentFlags writeMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		vkCmdSetRasterizerDiscardEnable(commandBuffer, VK_FALSE);
+		vkCmdSetPolygonModeEXT(commandBuffer, VK_POLYGON_MODE_FILL);
+		vkCmdSetRasterizationSamplesEXT(commandBuffer, VK_SAMPLE_COUNT_1_BIT);
+		vkCmdSetSampleMaskEXT(commandBuffer, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+		vkCmdSetAlphaToCoverageEnableEXT(commandBuffer, VK_FALSE);
+		vkCmdSetDepthBiasEnable(commandBuffer, VK_FALSE);
+		vkCmdSetDepthBoundsTestEnable(commandBuffer, VK_FALSE);
+		vkCmdSetStencilTestEnable(commandBuffer, VK_FALSE);
+		vkCmdSetColorBlendEnableEXT(commandBuffer, 0, 1, &blendEnable);
+		vkCmdSetColorWriteMaskEXT(commandBuffer, 0, 1, &writeMask);
+		if (!meshShadingEnabled)
+		{
+			// vertex pulling, no vertex input bindings at all
+			vkCmdSetVertexInputEXT(commandBuffer, 0, nullptr, 0, nullptr);
+			vkCmdSetPrimitiveTopology(commandBuffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+			vkCmdSetPrimitiveRestartEnable(commandBuffer, VK_FALSE);
+		}
+	}
+	else
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshShadingEnabled ? programs.meshletPipeline.handle : programs.pipeline.handle);
+	}
+
+	// extended dynamic state shared by both paths
+	vkCmdSetCullMode(commandBuffer, state.cullMode);
+	vkCmdSetFrontFace(commandBuffer, state.frontFace);
+	vkCmdSetDepthTestEnable(commandBuffer, state.depthTest ? VK_TRUE : VK_FALSE);
+	vkCmdSetDepthWriteEnable(commandBuffer, state.depthWrite ? VK_TRUE : VK_FALSE);
+	vkCmdSetDepthCompareOp(commandBuffer, state.depthCompareOp);
+}
+
+void Application::batchInstances(FrameArena &arena, const glm::mat4 &viewProj)
+{
+	CPU_ZONE("batch instances");
+	instanceStreamAddress = 0;
+	instanceBatches.clear();
+	instanceBatchCount16 = 0;
+	// the draw list is what survived culling, or every draw
+	const uint32_t listCount = cpuCullingEnabled ? static_cast<uint32_t>(visibleDraws.size()) : drawCount;
+	auto drawAt = [&](uint32_t entry) { return cpuCullingEnabled ? visibleDraws[entry] : entry; };
+	if (listCount == 0)
+	{
+		return;
+	}
+	// without room for the stream the frame draws every sub-mesh on its own
+	const FrameArena::Allocation stream = arena.allocate(listCount * sizeof(uint32_t), alignof(uint32_t));
+	if (!stream.data)
+	{
+		return;
+	}
+
+	// a bucket per index width, sub-mesh and LOD, so every bucket is a single draw and the 16 bit ones come first
+	constexpr uint32_t levels = Renderer::SubMesh::MaxLods + 1;
+	const uint32_t bucketsPerWidth = subMeshCount * levels;
+	auto computeKeys = [&](uint32_t first, uint32_t end)
+	{
+		for (uint32_t entry = first; entry < end; ++entry)
+		{
+			const uint32_t drawIndex = drawAt(entry);
+			const Renderer::DrawData &draw = draws[drawIndex];
+			instanceKeys[entry] = draw.indexType * bucketsPerWidth + drawSubMeshes[drawIndex] * levels + selectLod(draw, viewProj);
+		}
+	};
+	const uint32_t jobCount = std::min(threadPool.size() + 1, listCount / MinDrawsPerBatchJob);
+	if (jobCount > 1)
+	{
+		const uint32_t drawsPerJob = (listCount + jobCount - 1) / jobCount;
+		threadPool.parallelFor(jobCount, [&](size_t job)
+		{
+			const uint32_t first = static_cast<uint32_t>(job) * drawsPerJob;
+			computeKeys(first, std::min(listCount, first + drawsPerJob));
+		});
+	}
+	else
+	{
+		computeKeys(0, listCount);
+	}
+
+	// counting sort straight into the stream, afterwards every bucket's entry holds where it ends
+	instanceBucketEnds.assign(2 * bucketsPerWidth, 0);
+	for (uint32_t entry = 0; entry < listCount; ++entry)
+	{
+		++instanceBucketEnds[instanceKeys[entry]];
+	}
+	uint32_t offset = 0;
+	for (uint32_t &bucket : instanceBucketEnds)
+	{
+		offset += std::exchange(bucket, offset);
+	}
+	uint32_t *drawIndices = static_cast<uint32_t *>(stream.data);
+	for (uint32_t entry = 0; entry < listCount; ++entry)
+	{
+		drawIndices[instanceBucketEnds[instanceKeys[entry]]++] = drawAt(entry);
+	}
+
+	// the first draw of a bucket stands in for all of them, they only differ in transform
+	uint32_t begin = 0;
+	for (uint32_t bucket = 0; bucket < instanceBucketEnds.size(); ++bucket)
+	{
+		const uint32_t end = instanceBucketEnds[bucket];
+		if (end == begin)
+		{
+			continue;
+		}
+		const Renderer::DrawData &draw = draws[drawIndices[begin]];
+		const uint32_t lod = bucket % levels;
+		const Renderer::DrawLod *level = lod > 0 ? &drawLods[draw.lodStart + lod - 1] : nullptr;
+		instanceBatches.push_back(Renderer::InstanceBatch
+		{
+			.indexCount = level ? level->indexCount : draw.indexCount,
+			.firstIndex = level ? level->firstIndex : draw.firstIndex,
+			.vertexOffset = draw.vertexOffset,
+			.firstInstance = begin,
+			.instanceCount = end - begin
+		});
+		instanceBatchCount16 += bucket < bucketsPerWidth ? 1 : 0;
+		begin = end;
+	}
+	instanceStreamAddress = stream.address;
+}
+
+uint32_t Application::recordedDrawCount() const
+{
+	if (instanceStreamAddress)
+	{
+		return static_cast<uint32_t>(instanceBatches.size());
+	}
+	return cpuCullingEnabled ? static_cast<uint32_t>(visibleDraws.size()) : drawCount;
+}
+
+void Application::recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw, const glm::mat4 &view, const glm::mat4 &viewProj, uint32_t cullPhase) const
+{
+	// a secondary inherits no state, so every recording sets up the full state itself
+	VkViewport viewport
+	{
+		.x = 0, .y = 0,
+		.width = static_cast<float>(swapchainWidth),
+		.height = static_cast<float>(swapchainHeight),
+		.minDepth = 0,
+		.maxDepth = 1.0f,
+	};
+	vkCmdSetViewportWithCount(commandBuffer, 1, &viewport);
+
+	VkRect2D scissor
+	{
+		.offset{.x = 0, .y = 0 },
+		.extent{.width = swapchainWidth, .height = swapchainHeight}
+	};
+	vkCmdSetScissorWithCount(commandBuffer, 1, &scissor);
+
+	bindGraphicsState(commandBuffer, Renderer::RasterState{});
+
+	// textures are bound once for the whole recording, draws pick theirs through the material table
+	const VkPipelineLayout layout = meshShadingEnabled ? programs.meshletPipeline.layout : programs.pipeline.layout;
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &bindlessSet, 0, nullptr);
+
+	// BDA Send Device Pointer
+	if (meshShadingEnabled)
+	{
+		// task shaders cull meshlets on the GPU, each workgroup takes one task group of a single instance
+		Renderer::MeshletConstants meshletConsts
+		{
+			.vertexBufferAddress = vertexBuffer.address,
+			.meshletAddress = meshletBuffer.address,
+			.meshletDataAddress = meshletDataBuffer.address,
+			.drawDataAddress = drawDataBuffer.address,
+			.transformAddress = transformBuffer.address,
+			.taskGroupAddress = taskGroupBuffer.address,
+			.materialAddress = materialBuffer.address,
+			.viewProj = viewProj,
+			.cameraPosition = glm::vec3(glm::inverse(view) * glm::vec4(0, 0, 0, 1))
+		};
+		const uint32_t groupCount = static_cast<uint32_t>(taskGroups.size());
+		for (uint32_t base = 0; base < groupCount; base += maxTaskWorkGroupCount)
+		{
+			meshletConsts.groupBase = base;
+			vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
+				0, sizeof(Renderer::MeshletConstants), &meshletConsts);
+			vkCmdDrawMeshTasksEXT(commandBuffer, std::min(maxTaskWorkGroupCount, groupCount - base), 1, 1);
+		}
+	}
+	else
+	{
+		Renderer::DrawConstants pushConsts
+		{
+			.vertexBufferAddress = vertexBuffer.address,
+			.drawDataAddress = drawDataBuffer.address,
+			.transformAddress = transformBuffer.address,
+			.materialAddress = materialBuffer.address,
+			.instanceAddress = instanceStreamAddress,
+			.globalTime = static_cast<float>(globalTime),
+			.viewProj = viewProj
+		};
+		vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Renderer::DrawConstants), &pushConsts);
+
+		// one pass per index width so each buffer is bound once
+		for (const VkIndexType indexType : { VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 })
+		{
+			const Renderer::Buffer &boundIndices = indexType == VK_INDEX_TYPE_UINT16 ? indexBuffer16 : indexBuffer;
+			if (boundIndices.buffer == nullptr)
+			{
+				continue;
+			}
+			vkCmdBindIndexBuffer(commandBuffer, boundIndices.buffer, 0, indexType);
+
+			if (gpuDrivenEnabled)
+			{
+				// the culling pass wrote the surviving commands and their count for each phase and index width
+				const bool wide = indexType == VK_INDEX_TYPE_UINT32;
+				const VkDeviceSize commandOffset = ((2 * cullSlot + cullPhase) * drawCount + (wide ? drawCount16 : 0)) * sizeof(VkDrawIndexedIndirectCommand);
+				const VkDeviceSize countOffset = cullSlot * sizeof(Renderer::DrawCounts) + (cullPhase * 2 + (wide ? 1 : 0)) * sizeof(uint32_t);
+				const uint32_t maxDraws = wide ? drawCount - drawCount16 : drawCount16;
+				vkCmdDrawIndexedIndirectCount(commandBuffer, drawCommandBuffer.buffer, commandOffset,
+					drawCountBuffer.buffer, countOffset, maxDraws, sizeof(VkDrawIndexedIndirectCommand));
+				continue;
+			}
+
+			if (instanceStreamAddress)
+			{
+				// the batches of this index width within the range, their instances are consecutive in the stream
+				const bool wide = indexType == VK_INDEX_TYPE_UINT32;
+				const uint32_t first = std::max(firstDraw, wide ? instanceBatchCount16 : 0u);
+				const uint32_t end = std::min(endDraw, wide ? static_cast<uint32_t>(instanceBatches.size()) : instanceBatchCount16);
+				for (uint32_t batchIndex = first; batchIndex < end; ++batchIndex)
+				{
+					const Renderer::InstanceBatch &batch = instanceBatches[batchIndex];
+					vkCmdDrawIndexed(commandBuffer, batch.indexCount, batch.instanceCount, batch.firstIndex, batch.vertexOffset, batch.firstInstance);
+				}
+				continue;
+			}
+
+			// the draw index goes in as firstInstance so the vertex shader can find its draw data
+			const uint32_t drawType = indexType == VK_INDEX_TYPE_UINT16 ? 0u : 1u;
+			for (uint32_t entry = firstDraw; entry < endDraw; ++entry)
+			{
+				const uint32_t drawIndex = cpuCullingEnabled ? visibleDraws[entry] : entry;
+				const Renderer::DrawData &draw = draws[drawIndex];
+				if (draw.indexType != drawType)
+				{
+					continue;
+				}
+				if (const uint32_t lod = selectLod(draw, viewProj); lod > 0)
+				{
+					const Renderer::DrawLod &level = drawLods[draw.lodStart + lod - 1];
+					vkCmdDrawIndexed(commandBuffer, level.indexCount, 1, level.firstIndex, draw.vertexOffset, drawIndex);
+				}
+				else
+				{
+					vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, drawIndex);
+				}
+			}
+		}
+	}
+}
+
+void Application::recordDrawsParallel(FrameResources &res, const VkCommandBufferInheritanceInfo &inheritance, const glm::mat4 &view, const glm::mat4 &viewProj)
+{
+	// contiguous draw ranges keep each job's index passes and the submission order deterministic, with instancing
+	// the ranges are over the batches
+	const uint32_t recordCount = recordedDrawCount();
+	const uint32_t jobCount = std::min(static_cast<uint32_t>(res.recordCommandBuffers.size()), recordCount / MinDrawsPerRecordJob);
+	const uint32_t drawsPerJob = (recordCount + jobCount - 1) / jobCount;
+	threadPool.parallelFor(jobCount, [&](size_t job)
+	{
+		CPU_ZONE("record draws");
+		const uint32_t slot = static_cast<uint32_t>(job);
+		vkResetCommandPool(device, res.recordPools[slot], 0);
+
+		VkCommandBufferBeginInfo beginInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+			.pInheritanceInfo = &inheritance
+		};
+		VkCommandBuffer commandBuffer = res.recordCommandBuffers[slot];
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		const uint32_t firstDraw = slot * drawsPerJob;
+		recordDraws(commandBuffer, firstDraw, std::min(recordCount, firstDraw + drawsPerJob), view, viewProj);
+		vkEndCommandBuffer(commandBuffer);
+	});
+	vkCmdExecuteCommands(res.commandBuffer, jobCount, res.recordCommandBuffers.data());
+}
+
+uint32_t Application::selectLod(const Renderer::DrawData &draw, const glm::mat4 &viewProj) const
+{
+	// mirrors cull.comp, the coarsest level whose error projects below the bias, measured from the nearest the
+	// bounds get in view depth
+	if (draw.lodCount == 0 || lodScale <= 0)
+	{
+		return 0;
+	}
+	const glm::mat4 &world = scene.worlds()[draw.transformIndex];
+	const float scale = std::sqrt(std::max({ glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+		glm::dot(glm::vec3(world[1]), glm::vec3(world[1])), glm::dot(glm::vec3(world[2]), glm::vec3(world[2])) }));
+	const glm::vec3 center = (draw.boundsMin + draw.boundsMax) * 0.5f;
+	const float radius = glm::length(draw.boundsMax - draw.boundsMin) * 0.5f * scale;
+	const float distance = (viewProj * world * glm::vec4(center, 1.0f)).w - radius;
+
+	uint32_t selected = 0;
+	for (uint32_t lod = 0; lod < draw.lodCount; ++lod)
+	{
+		if (drawLods[draw.lodStart + lod].error * scale * lodScale <= distance)
+		{
+			selected = lod + 1;
+		}
+	}
+	return selected;
+}
+
+void Application::render(float deltaTime)
+{
+	// first check if our swapchain is still valid, the old one retires without stalling the GPU
+	if (requireSwapchainRecreate)
+	{
+		createSwapchain(width, height);
+		requireSwapchainRecreate = false;
+	}
+
+	const uint32_t frameResIndex = frameCounter++ % framesInFlight;
+	// wait for frame using this frame's resources to complete
+	uint64_t frameId = ++timelineValue; // this is our frame "ID", and what we're using to signal the end of this frame later
+	uint64_t waitForId = frameId - framesInFlight; // frame N and frame N - framesInFlight share resources (3 - 2 = 1 -- frame 3 and 1 share resources)
+
+	VkSemaphoreWaitInfo waitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &timelineSemaphore,
+		.pValues = &waitForId
+	};
+	const uint64_t waitStart = SDL_GetTicksNS();
+	{
+		CPU_ZONE("wait frame");
+		vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+	}
+	frameWaitNs += SDL_GetTicksNS() - waitStart;
+
+	// frame boundary: retire what the GPU has finished with and pick up rebuilt shaders
+	processDeletions(false);
+	retireSwapchains(false);
+	applyShaderReload();
+	gpuMemory.beginFrame(frameId);
+
+	// now its safe to start recording commands
+	FrameResources &res = frameResources[frameResIndex];
+	vkResetCommandPool(device, res.commandPool, 0); // resets all buffers
+	readCullCounts(res);
+	reportCulling();
+	res.arena.reset();
+
+	// get the resources for this frame
+	VkSemaphore imageAcquireSemaphore = frameResources[frameResIndex].imageAcquiredSemaphore;
+
+	// acquire the swapchain image, no need to wait for timeline semaphore just to then wait for the swapchain image
+	// offscreen targets are owned per frame resource, the timeline wait above already made this one free
+	uint32_t imageIndex = offscreenEnabled ? frameResIndex : 0;
+	VkResult acquireResult = VK_SUCCESS;
+	if (!offscreenEnabled)
+	{
+		CPU_ZONE("acquire");
+		const uint64_t acquireStart = SDL_GetTicksNS();
+		acquireResult = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAcquireSemaphore, VK_NULL_HANDLE, &imageIndex);
+		frameWaitNs += SDL_GetTicksNS() - acquireStart;
+	}
+	// handle resize and out-of-date images, may need swapchain recreate
+
+	if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		// nothing gets submitted, so the frame gives its ID back, otherwise nothing would ever signal it and the
+		// frame framesInFlight later, along with every deletion deferred to it, would wait forever
+		requireSwapchainRecreate = true;
+		--timelineValue;
+		--frameCounter;
+		return;
+	}
+	else if (acquireResult == VK_SUBOPTIMAL_KHR)
+	{
+		// can render this frame, recreate next time around
+		requireSwapchainRecreate = true;
+	}
+
+	constexpr float fov = glm::radians(45.0);
+	float aspect = static_cast<float>(width) / static_cast<float>(height);
+	float nearP = 0.1f;
+	float farP = 32.0f;
+
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), (float)width / (float)height, nearP, farP);
+	proj[1][1] *= -1;
+	glm::mat4 rotation = glm::rotate(glm::mat4(1), static_cast<float>(globalTime), glm::vec3(0, 1, 0));
+	glm::mat4 translate = glm::translate(glm::mat4(1), glm::vec3(0, -0.4, -1));
+	glm::mat4 scale = glm::scale(glm::mat4(1), glm::vec3(1.0f, 1.0f, 1.0f));
+	glm::mat4 view = translate * rotation * scale;
+	glm::mat4 viewProj = proj * view;
+
+	// an error of e at view depth d covers e / d * proj[1][1] * height / 2 pixels
+	lodScale = config.lodBias > 0 ? proj[1][1] * -0.5f * static_cast<float>(swapchainHeight) / config.lodBias : 0.0f;
+	updateTextureStreaming(viewProj, proj[1][1] * -0.5f * static_cast<float>(swapchainHeight));
+
+	// async compute culls into this slot's commands, the visibility alternates between frames
+	cullSlot = asyncComputeEnabled ? frameResIndex : 0;
+	visibilitySlot = asyncComputeEnabled && occlusionCullingEnabled ? static_cast<uint32_t>(frameId % 2) : 0;
+	if (asyncComputeEnabled)
+	{
+		recordAsyncCompute(res, frameResIndex, frameId, viewProj);
+	}
+
+	// begin recording commands
+	VkCommandBufferBeginInfo cmdBeginInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	CPU_ZONE_BEGIN(record);
+	vkBeginCommandBuffer(res.commandBuffer, &cmdBeginInfo);
+	gpuProfiler.beginFrame(res.commandBuffer, frameResIndex, frameId);
+
+	// take ownership of anything the upload queue finished handing over, streamed textures included
+	gpuProfiler.beginScope(res.commandBuffer, "uploads");
+	applyTextureLoads();
+	uploadEngine.retire();
+	const uint64_t uploadWaitValue = uploadEngine.recordAcquires(res.commandBuffer);
+	generateMipmaps(res.commandBuffer);
+	gpuProfiler.endScope(res.commandBuffer);
+
+	// world matrices of nodes changed since the last frame, and materials pointing at swapped in textures,
+	// async compute already submitted the transforms with the culling
+	gpuProfiler.beginScope(res.commandBuffer, asyncComputeEnabled ? "materials" : "transforms");
+	if (!asyncComputeEnabled)
+	{
+		updateTransforms(res.commandBuffer, res.arena);
+	}
+	updateMaterials(res.commandBuffer, res.arena);
+	gpuProfiler.endScope(res.commandBuffer);
+
+	// GPU-driven draws are culled and compacted before rendering starts, with occlusion culling only
+	// those visible last frame, the rest follow once their depth is in the pyramid
+	if (gpuDrivenEnabled && !asyncComputeEnabled)
+	{
+		gpuProfiler.beginScope(res.commandBuffer, "culling");
+		recordCulling(res.commandBuffer, viewProj, occlusionCullingEnabled ? Renderer::CullEarly : 0u);
+		gpuProfiler.endScope(res.commandBuffer);
+	}
+
+	// the frame's targets and the passes over them, the graph places the barriers between them and keeps
+	// depth and the pyramid in memory they share whenever their lifetimes allow
+	renderGraph.reset();
+	const RenderGraph::Resource colorTarget = renderGraph.importImage("color", RenderGraph::ImportedImage
+	{
+		.image = swapchainImages[imageIndex],
+		.view = swapchainImageViews[imageIndex],
+		.readyStages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		.finalUsage = offscreenEnabled ? RenderGraph::Usage::TransferSource : RenderGraph::Usage::Present
+	});
+	depthTarget = renderGraph.createImage("depth", RenderGraph::ImageDesc
+	{
+		.format = depthFormat,
+		.extent = depthExtent,
+		.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (occlusionCullingEnabled ? VK_IMAGE_USAGE_SAMPLED_BIT : 0u)
+	});
+	depthPyramidTarget = occlusionCullingEnabled ? renderGraph.createImage("depth pyramid", RenderGraph::ImageDesc
+	{
+		.format = depthPyramidFormat,
+		.extent = depthPyramidExtent,
+		.mipLevels = depthPyramidLevels,
+		.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+	}) : RenderGraph::NoResource;
+
+	// setup the attachments (color and depth) and begin rendering (dynamic)
+	VkRenderingAttachmentInfo colorAttachInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+		.imageView = renderGraph.view(colorTarget),
+		.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, // clear the image
+		.storeOp = VK_ATTACHMENT_STORE_OP_STORE, // keep data for presentation
+		.clearValue{.color{0.0f, 0.0f, 0.0f, 1}}
+	};
+	VkRenderingAttachmentInfo depthAttachInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+		.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, // clear the depth data
+		.storeOp = occlusionCullingEnabled ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE, // reduced into the pyramid
+		.clearValue{.depthStencil{1.0f, 0}}
+	};
+	VkRenderingInfo renderingInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+		.renderArea
+		{
+			.offset{.x = 0, .y = 0},
+			.extent{.width = swapchainWidth, .height = swapchainHeight}
+		},
+		.layerCount = 1,
+		.colorAttachmentCount = 1,
+		.pColorAttachments = &colorAttachInfo,
+		.pDepthAttachment = &depthAttachInfo
+	};
+
+	// draws outside the frustum are dropped before anything else looks at them, sorting is left to batching
+	if (cpuCullingEnabled)
+	{
+		CPU_ZONE("cull draws");
+		visibleDraws = drawCuller.cull(viewProj, &threadPool, !instancingEnabled);
+		const uint32_t visibleCount = static_cast<uint32_t>(visibleDraws.size());
+		lastDrawCounts = Renderer::DrawCounts{ .drawn{ { visibleCount, 0 } }, .frustumCulled = drawCount - visibleCount };
+		++cullFrames;
+		totalDrawn += visibleCount;
+		totalFrustumCulled += drawCount - visibleCount;
+	}
+
+	// copies of a sub-mesh become one instanced draw, what's left to record is a draw per batch
+	if (instancingEnabled)
+	{
+		batchInstances(res.arena, viewProj);
+	}
+	const uint32_t recordCount = recordedDrawCount();
+
+	// large CPU draw lists are recorded into secondaries across the thread pool, the rest inline
+	const bool parallel = !meshShadingEnabled && !gpuDrivenEnabled && !res.recordCommandBuffers.empty() &&
+		recordCount >= 2 * MinDrawsPerRecordJob && (!gpuProfiler.collectsStatistics() || inheritedQueriesEnabled);
+	if (parallel)
+	{
+		renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+	}
+
+	// begin dynamic rendering, the depth view only exists once the graph is compiled
+	renderGraph.addPass("main", [&](VkCommandBuffer commandBuffer)
+	{
+		depthAttachInfo.imageView = renderGraph.view(depthTarget);
+		gpuProfiler.beginStatistics(commandBuffer);
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+		if (parallel)
+		{
+			VkCommandBufferInheritanceRenderingInfo inheritanceRendering
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+				.colorAttachmentCount = 1,
+				.pColorAttachmentFormats = &swapchainFormat,
+				.depthAttachmentFormat = depthFormat,
+				.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT
+			};
+			VkCommandBufferInheritanceInfo inheritance
+			{
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+				.pNext = &inheritanceRendering,
+				.pipelineStatistics = gpuProfiler.statisticFlags()
+			};
+			recordDrawsParallel(res, inheritance, view, viewProj);
+		}
+		else
+		{
+			recordDraws(commandBuffer, 0, recordCount, view, viewProj);
+		}
+		// end dynamic rendering
+		vkCmdEndRendering(commandBuffer);
+		if (!occlusionCullingEnabled)
+		{
+			gpuProfiler.endStatistics(commandBuffer);
+		}
+	}).use(colorTarget, RenderGraph::Usage::ColorAttachment).use(depthTarget, RenderGraph::Usage::DepthAttachment);
+
+	if (occlusionCullingEnabled)
+	{
+		renderGraph.addPass("depth pyramid", [&](VkCommandBuffer commandBuffer) { buildDepthPyramid(commandBuffer); })
+			.use(depthTarget, RenderGraph::Usage::ComputeSampled).use(depthPyramidTarget, RenderGraph::Usage::ComputeWrite);
+		// its output is the late draw commands, which the graph doesn't track
+		renderGraph.addPass("late culling", [&](VkCommandBuffer commandBuffer) { recordCulling(commandBuffer, viewProj, Renderer::CullLate | Renderer::CullOcclusion); })
+			.use(depthPyramidTarget, RenderGraph::Usage::ComputeRead).sideEffects();
+
+		// the late pass draws on top of the early one
+		renderGraph.addPass("late", [&](VkCommandBuffer commandBuffer)
+		{
+			colorAttachInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			depthAttachInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			depthAttachInfo.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			vkCmdBeginRendering(commandBuffer, &renderingInfo);
+			recordDraws(commandBuffer, 0, drawCount, view, viewProj, 1);
+			vkCmdEndRendering(commandBuffer);
+			gpuProfiler.endStatistics(commandBuffer);
+		}).use(colorTarget, RenderGraph::Usage::ColorAttachment).use(depthTarget, RenderGraph::Usage::DepthAttachment);
+	}
+
+	// failing to allocate the targets was reported, the image is still handed on in its final layout
+	renderGraph.compile();
+	renderGraph.execute(res.commandBuffer, gpuProfiler);
+
+	// the frame's culling statistics, read once this frame slot comes around again
+	if (gpuDrivenEnabled && drawCount > 0)
+	{
+		res.cullCounts = res.arena.allocate(sizeof(Renderer::DrawCounts), alignof(Renderer::DrawCounts));
+		if (res.cullCounts.data)
+		{
+			const VkBufferCopy region{ .srcOffset = cullSlot * sizeof(Renderer::DrawCounts), .dstOffset = res.cullCounts.offset, .size = sizeof(Renderer::DrawCounts) };
+			vkCmdCopyBuffer(res.commandBuffer, drawCountBuffer.buffer, res.cullCounts.buffer, 1, &region);
+			VkMemoryBarrier2 hostBarrier
+			{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+				.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+				.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+				.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT
+			};
+			VkDependencyInfo hostDep{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &hostBarrier };
+			vkCmdPipelineBarrier2(res.commandBuffer, &hostDep);
+		}
+	}
+
+	gpuProfiler.endFrame(res.commandBuffer);
+	vkEndCommandBuffer(res.commandBuffer);
+	res.arena.flush();
+	CPU_ZONE_END(record, "record");
+
+	// ensure swapchain image is actually vailable to start color output
+	std::vector<VkSemaphoreSubmitInfo> semaphoreWaits;
+	if (!offscreenEnabled)
+	{
+		semaphoreWaits.push_back(VkSemaphoreSubmitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = imageAcquireSemaphore,
+			.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | // wait before drawing to image
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT // prevent depth buffer clearing before image is ready
+		});
+	}
+	if (uploadWaitValue)
+	{
+		// uploaded resources must have landed before the ownership acquire and first use
+		semaphoreWaits.push_back(VkSemaphoreSubmitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = uploadEngine.semaphore(),
+			.value = uploadWaitValue,
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+		});
+	}
+	if (asyncComputeEnabled)
+	{
+		// this frame's transforms, commands and counts, everything before the draws runs beside the compute work
+		semaphoreWaits.push_back(VkSemaphoreSubmitInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = computeSemaphore,
+			.value = frameId,
+			.stageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT
+		});
+	}
+	// signal that the image can be presented
+	std::vector<VkSemaphoreSubmitInfo> semaphoreSignals
+	{
+		{ // entire frame is completed (timeline)
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = timelineSemaphore,
+			.value = frameId, // we're signalling our current frame ID is complete
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+		}
+	};
+	if (!offscreenEnabled)
+	{
+		semaphoreSignals.push_back(VkSemaphoreSubmitInfo
+		{ // render work completion signal
+			.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+			.semaphore = renderCompleteSemaphores[imageIndex],
+			.stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT
+		});
+	}
+	VkCommandBufferSubmitInfo cmdSubmitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		.commandBuffer = res.commandBuffer,
+	};
+	VkSubmitInfo2 submitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		.waitSemaphoreInfoCount = static_cast<uint32_t>(semaphoreWaits.size()),
+		.pWaitSemaphoreInfos = semaphoreWaits.data(), // ensure the image is ready
+		.commandBufferInfoCount = 1,
+		.pCommandBufferInfos = &cmdSubmitInfo,
+		.signalSemaphoreInfoCount = static_cast<uint32_t>(semaphoreSignals.size()),
+		.pSignalSemaphoreInfos = semaphoreSignals.data()
+	};
+	{
+		CPU_ZONE("submit");
+		vkQueueSubmit2(gfxQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+	if (offscreenEnabled)
+	{
+		return;
+	}
+
+	// present the image, tagged with the frame ID when the next frame paces itself on it
+	VkPresentIdKHR presentId
+	{
+		.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+		.swapchainCount = 1,
+		.pPresentIds = &frameId
+	};
+	// and with a fence that tells when this swapchain's semaphore and image are no longer the present engine's
+	const VkFence presentFence = presentFencesEnabled ? acquirePresentFence() : nullptr;
+	VkSwapchainPresentFenceInfoEXT presentFenceInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT,
+		.pNext = presentWaitEnabled ? &presentId : nullptr,
+		.swapchainCount = 1,
+		.pFences = &presentFence
+	};
+	VkPresentInfoKHR presentInfo{
+		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.pNext = presentFence ? static_cast<const void *>(&presentFenceInfo) : presentFenceInfo.pNext,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &renderCompleteSemaphores[imageIndex], // render work completed semaphore
+		.swapchainCount = 1,
+		.pSwapchains = &swapchain,
+		.pImageIndices = &imageIndex,
+		.pResults = nullptr
+	};
+
+	VkResult presentResult = VK_SUCCESS;
+	{
+		CPU_ZONE("present");
+		presentResult = vkQueuePresentKHR(gfxQueue, &presentInfo);
+	}
+	if (presentFence)
+	{
+		// an out of date swapchain still had the present queued, and its semaphore waited on
+		if (presentResult == VK_SUCCESS || presentResult == VK_SUBOPTIMAL_KHR || presentResult == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			pendingPresents.push_back(PendingPresent{ .fence = presentFence, .swapchain = swapchain });
+		}
+		else
+		{
+			freePresentFences.push_back(presentFence);
+		}
+	}
+	if (presentWaitEnabled)
+	{
+		pendingPresentId = frameId;
+		pendingInputTime = inputSampleTime;
+	}
+}
+
+static glm::mat4 nodeLocalTransform(const tinygltf::Node &node)
+{
+	if (node.matrix.size() == 16)
+	{
+		glm::dmat4 matrix;
+		std::copy(node.matrix.begin(), node.matrix.end(), glm::value_ptr(matrix));
+		return glm::mat4(matrix);
+	}
+
+	glm::mat4 transform(1);
+	if (node.translation.size() == 3)
+	{
+		transform = glm::translate(transform, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+	}
+	if (node.rotation.size() == 4)
+	{
+		// glTF stores quaternions as x, y, z, w
+		transform *= glm::mat4_cast(glm::quat(static_cast<float>(node.rotation[3]), static_cast<float>(node.rotation[0]),
+			static_cast<float>(node.rotation[1]), static_cast<float>(node.rotation[2])));
+	}
+	if (node.scale.size() == 3)
+	{
+		transform = glm::scale(transform, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+	}
+	return transform;
+}
+
+// depth first, so the scene ends up in the pre-order it requires
+static void addSceneNode(Scene &scene, const tinygltf::Model &model, int nodeIndex, uint32_t parent, uint32_t depth)
+{
+	// glTF node graphs are trees, the depth limit only guards against malformed files
+	if (nodeIndex < 0 || nodeIndex >= static_cast<int>(model.nodes.size()) || depth > 256)
+	{
+		return;
+	}
+	const tinygltf::Node &node = model.nodes[nodeIndex];
+	const uint32_t added = scene.addNode(parent, nodeLocalTransform(node), node.mesh);
+	for (int childNodeIndex : node.children)
+	{
+		addSceneNode(scene, model, childNodeIndex, added, depth + 1);
+	}
+}
+
+void Application::buildScene(const tinygltf::Model &model)
+{
+	scene.clear();
+	if (model.scenes.empty())
+	{
+		// no node graph at all, every mesh is placed once at the origin
+		for (size_t meshIdx = 0; meshIdx < model.meshes.size(); ++meshIdx)
+		{
+			scene.addNode(Scene::NoParent, glm::mat4(1), static_cast<int32_t>(meshIdx));
+		}
+		return;
+	}
+
+	const tinygltf::Scene &gltfScene = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0];
+	for (int rootIndex : gltfScene.nodes)
+	{
+		addSceneNode(scene, model, rootIndex, Scene::NoParent, 0);
+	}
+}
+
+// unit of decode work, large primitives are split so a single huge mesh still spreads across workers
+struct DecodeJob
+{
+	const tinygltf::Primitive *primitive = nullptr;
+	const Renderer::SubMesh *subMesh = nullptr;
+	bool decodeIndices = false;
+	size_t begin = 0;
+	size_t end = 0;
+};
+
+static const tinygltf::Accessor *findFloatAttribute(const tinygltf::Model &model, const tinygltf::Primitive &primitive, const char *name, int type)
+{
+	if (const auto &itr = primitive.attributes.find(name); itr != primitive.attributes.end())
+	{
+		const tinygltf::Accessor &access = model.accessors[itr->second];
+		if (access.type == type && access.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && access.bufferView >= 0)
+		{
+			return &access;
+		}
+	}
+	return nullptr;
+}
+
+static const tinygltf::Accessor *findIndexAccessor(const tinygltf::Model &model, const tinygltf::Primitive &primitive)
+{
+	if (primitive.indices != -1)
+	{
+		const tinygltf::Accessor &access = model.accessors[primitive.indices];
+		if (access.type == TINYGLTF_TYPE_SCALAR && access.bufferView >= 0 &&
+			(access.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ||
+			access.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ||
+			access.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE))
+		{
+			return &access;
+		}
+	}
+	return nullptr;
+}
+
+static const unsigned char *accessorData(const tinygltf::Model &model, const tinygltf::Accessor &access, size_t elementSize, size_t &stride)
+{
+	const tinygltf::BufferView &bv = model.bufferViews[access.bufferView];
+	stride = bv.byteStride > 0 ? bv.byteStride : elementSize;
+	return model.buffers[bv.buffer].data.data() + bv.byteOffset + access.byteOffset;
+}
+
+static void decodePrimitiveRange(const tinygltf::Model &model, const DecodeJob &job, Renderer::Vertex *vertices, uint32_t *indices)
+{
+	using namespace tinygltf;
+	const Renderer::SubMesh &subMesh = *job.subMesh;
+
+	if (job.decodeIndices)
+	{
+		const Accessor &access = *findIndexAccessor(model, *job.primitive);
+		size_t stride = 0;
+		const unsigned char *src = accessorData(model, access, tinygltf::GetComponentSizeInBytes(access.componentType), stride);
+		uint32_t *dst = indices + subMesh.indexStart;
+		for (size_t i = job.begin; i < job.end; ++i)
+		{
+			const unsigned char *element = src + i * stride;
+			switch (access.componentType)
+			{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: dst[i] = *reinterpret_cast<const uint32_t *>(element); break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: dst[i] = *reinterpret_cast<const uint16_t *>(element); break;
+			default: dst[i] = *element; break;
+			}
+		}
+		return;
+	}
+
+	// position and uv are written in a single pass over the vertex range
+	size_t posStride = 0;
+	const Accessor *posAccess = findFloatAttribute(model, *job.primitive, "POSITION", TINYGLTF_TYPE_VEC3);
+	const unsigned char *posData = accessorData(model, *posAccess, sizeof(glm::vec3), posStride);
+
+	size_t uvStride = 0;
+	const unsigned char *uvData = nullptr;
+	if (const Accessor *uvAccess = findFloatAttribute(model, *job.primitive, "TEXCOORD_0", TINYGLTF_TYPE_VEC2); uvAccess && uvAccess->count >= subMesh.vertexCount)
+	{
+		uvData = accessorData(model, *uvAccess, sizeof(glm::vec2), uvStride);
+	}
+
+	Renderer::Vertex *dst = vertices + subMesh.vertexStart;
+	for (size_t i = job.begin; i < job.end; ++i)
+	{
+		std::memcpy(&dst[i].position, posData + i * posStride, sizeof(glm::vec3));
+		if (uvData)
+		{
+			std::memcpy(&dst[i].uv, uvData + i * uvStride, sizeof(glm::vec2));
+		}
+		else
+		{
+			dst[i].uv = glm::vec2(0);
+		}
+	}
+}
+
+static void computeBounds(Renderer::SubMesh &subMesh, const Renderer::Vertex *vertices)
+{
+	if (subMesh.vertexCount == 0)
+	{
+		return;
+	}
+	subMesh.boundsMin = subMesh.boundsMax = vertices[subMesh.vertexStart].position;
+	for (size_t i = subMesh.vertexStart; i < subMesh.vertexStart + subMesh.vertexCount; ++i)
+	{
+		subMesh.boundsMin = glm::min(subMesh.boundsMin, vertices[i].position);
+		subMesh.boundsMax = glm::max(subMesh.boundsMax, vertices[i].position);
+	}
+}
+
+static void quantizeVertices(const Renderer::SubMesh &subMesh, const Renderer::Vertex *vertices, Renderer::CompactVertex *compact)
+{
+	// flat axes quantize to 0, the shader decodes min + q * extent, so they land on the bounds without dividing by zero
+	const glm::vec3 extent = subMesh.boundsMax - subMesh.boundsMin;
+	const glm::vec3 scale = glm::vec3(
+		extent.x > 0 ? 1.0f / extent.x : 0.0f,
+		extent.y > 0 ? 1.0f / extent.y : 0.0f,
+		extent.z > 0 ? 1.0f / extent.z : 0.0f);
+	for (size_t i = subMesh.vertexStart; i < subMesh.vertexStart + subMesh.vertexCount; ++i)
+	{
+		const glm::vec3 normalized = glm::clamp((vertices[i].position - subMesh.boundsMin) * scale, 0.0f, 1.0f);
+		Renderer::CompactVertex &out = compact[i];
+		for (int c = 0; c < 3; ++c)
+		{
+			out.position[c] = glm::packUnorm1x16(normalized[c]);
+		}
+		out.padding = 0;
+		out.uv[0] = glm::packHalf1x16(vertices[i].uv.x);
+		out.uv[1] = glm::packHalf1x16(vertices[i].uv.y);
+	}
+}
+
+// reordering and meshlet building need an indexed triangle list with every index inside the sub-mesh
+static bool isValidTriangleList(const Renderer::SubMesh &subMesh, const uint32_t *indices)
+{
+	if (subMesh.indexCount == 0 || subMesh.indexCount % 3 != 0)
+	{
+		return false;
+	}
+	return std::all_of(indices + subMesh.indexStart, indices + subMesh.indexStart + subMesh.indexCount,
+		[&subMesh](uint32_t index) { return index < subMesh.vertexCount; });
+}
+
+void Application::optimizeGeometry(const std::vector<Renderer::SubMesh *> &subMeshes)
+{
+	using namespace MeshOptimizer;
+	const auto start = std::chrono::steady_clock::now();
+
+	// triangles are ordered for the post-transform cache, then clusters for overdraw,
+	// then vertices are renumbered in first-use order for fetch locality
+	std::vector<CacheStats> before(subMeshes.size());
+	std::vector<CacheStats> after(subMeshes.size());
+	threadPool.parallelFor(subMeshes.size(), [&](size_t i)
+	{
+		const Renderer::SubMesh &sub = *subMeshes[i];
+		const std::span<uint32_t> subIndices(indices.data() + sub.indexStart, sub.indexCount);
+		Renderer::Vertex *subVertices = vertices.data() + sub.vertexStart;
+		if (!isValidTriangleList(sub, indices.data()))
+		{
+			return; // keep it as imported
+		}
+
+		before[i] = analyzeVertexCache(subIndices, sub.vertexCount);
+		optimizeVertexCache(subIndices, sub.vertexCount);
+		optimizeOverdraw(subIndices, &subVertices->position.x, sizeof(Renderer::Vertex), sub.vertexCount, 1.05f);
+
+		const std::vector<uint32_t> remap = optimizeVertexFetch(subIndices, sub.vertexCount);
+		std::vector<Renderer::Vertex> reordered(sub.vertexCount);
+		for (size_t v = 0; v < sub.vertexCount; ++v)
+		{
+			reordered[remap[v]] = subVertices[v];
+		}
+		std::copy(reordered.begin(), reordered.end(), subVertices);
+		after[i] = analyzeVertexCache(subIndices, sub.vertexCount);
+	});
+
+	// totals are weighted by triangle and vertex counts so large sub-meshes dominate
+	double trianglesTotal = 0, verticesTotal = 0;
+	double missesBefore = 0, missesAfter = 0;
+	for (size_t i = 0; i < subMeshes.size(); ++i)
+	{
+		const Renderer::SubMesh &sub = *subMeshes[i];
+		if (before[i].acmr == 0)
+		{
+			continue;
+		}
+		const double triangles = sub.indexCount / 3.0;
+		trianglesTotal += triangles;
+		verticesTotal += sub.vertexCount;
+		missesBefore += before[i].acmr * triangles;
+		missesAfter += after[i].acmr * triangles;
+		std::cout << "  sub-mesh " << i << " (" << sub.indexCount / 3 << " triangles): ACMR " << before[i].acmr << " -> " << after[i].acmr
+			<< ", ATVR " << before[i].atvr << " -> " << after[i].atvr << std::endl;
+	}
+	if (trianglesTotal > 0)
+	{
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Mesh optimization in " << ms << " ms: ACMR " << missesBefore / trianglesTotal << " -> " << missesAfter / trianglesTotal
+			<< ", ATVR " << missesBefore / verticesTotal << " -> " << missesAfter / verticesTotal << std::endl;
+	}
+}
+
+void Application::packIndices(const std::vector<Renderer::SubMesh *> &subMeshes)
+{
+	// sub-meshes addressable with 16 bit indices move to their own buffer, halving their index bandwidth,
+	// each one's LODs follow its full detail range
+	std::vector<std::array<size_t, Renderer::SubMesh::MaxLods + 1>> sourceStarts(subMeshes.size());
+	size_t total16 = 0;
+	size_t total32 = 0;
+	for (size_t i = 0; i < subMeshes.size(); ++i)
+	{
+		Renderer::SubMesh &sub = *subMeshes[i];
+		sub.indexType = sub.vertexCount < 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+		size_t &total = sub.indexType == VK_INDEX_TYPE_UINT16 ? total16 : total32;
+		sourceStarts[i][0] = sub.indexStart;
+		sub.indexStart = total;
+		total += sub.indexCount;
+		for (uint32_t lod = 0; lod < sub.lodCount; ++lod)
+		{
+			sourceStarts[i][lod + 1] = sub.lods[lod].indexStart;
+			sub.lods[lod].indexStart = total;
+			total += sub.lods[lod].indexCount;
+		}
+	}
+
+	std::vector<uint32_t> indices32(total32);
+	indices16.resize(total16);
+	threadPool.parallelFor(subMeshes.size(), [&](size_t i)
+	{
+		const Renderer::SubMesh &sub = *subMeshes[i];
+		auto copyRange = [&](size_t sourceStart, size_t start, size_t count)
+		{
+			const uint32_t *src = indices.data() + sourceStart;
+			if (sub.indexType == VK_INDEX_TYPE_UINT16)
+			{
+				std::transform(src, src + count, indices16.begin() + start, [](uint32_t index) { return static_cast<uint16_t>(index); });
+			}
+			else
+			{
+				std::copy(src, src + count, indices32.begin() + start);
+			}
+		};
+		copyRange(sourceStarts[i][0], sub.indexStart, sub.indexCount);
+		for (uint32_t lod = 0; lod < sub.lodCount; ++lod)
+		{
+			copyRange(sourceStarts[i][lod + 1], sub.lods[lod].indexStart, sub.lods[lod].indexCount);
+		}
+	});
+	indices = std::move(indices32);
+}
+
+void Application::buildMeshlets(const std::vector<Renderer::SubMesh *> &subMeshes, const std::vector<bool> &doubleSided)
+{
+	std::vector<MeshOptimizer::MeshletData> subMeshMeshlets(subMeshes.size());
+	threadPool.parallelFor(subMeshes.size(), [&](size_t i)
+	{
+		const Renderer::SubMesh &sub = *subMeshes[i];
+		if (isValidTriangleList(sub, indices.data()))
+		{
+			subMeshMeshlets[i] = MeshOptimizer::buildMeshlets(std::span(indices.data() + sub.indexStart, sub.indexCount), sub.vertexCount);
+		}
+	});
+
+	// place every sub-mesh's meshlets with a prefix sum, then fill in parallel
+	std::vector<size_t> vertexBases(subMeshes.size());
+	std::vector<size_t> triangleBases(subMeshes.size());
+	size_t meshletTotal = 0;
+	size_t vertexTotal = 0;
+	size_t triangleTotal = 0;
+	for (size_t i = 0; i < subMeshes.size(); ++i)
+	{
+		subMeshes[i]->meshletStart = static_cast<uint32_t>(meshletTotal);
+		subMeshes[i]->meshletCount = static_cast<uint32_t>(subMeshMeshlets[i].meshlets.size());
+		vertexBases[i] = vertexTotal;
+		triangleBases[i] = triangleTotal;
+		meshletTotal += subMeshMeshlets[i].meshlets.size();
+		vertexTotal += subMeshMeshlets[i].vertices.size();
+		triangleTotal += subMeshMeshlets[i].triangles.size();
+	}
+	// triangles follow all of the vertex indices in the same array
+	for (size_t &base : triangleBases)
+	{
+		base += vertexTotal;
+	}
+	meshlets.resize(meshletTotal);
+	meshletData.resize(vertexTotal + triangleTotal);
+
+	threadPool.parallelFor(subMeshes.size(), [&](size_t i)
+	{
+		const Renderer::SubMesh &sub = *subMeshes[i];
+		const MeshOptimizer::MeshletData &data = subMeshMeshlets[i];
+		const float *positions = &vertices[sub.vertexStart].position.x;
+		// compact vertices can move by up to half a quantization step per axis
+		const float quantizationSlack = glm::length(sub.boundsMax - sub.boundsMin) / 65535.0f;
+		for (size_t m = 0; m < data.meshlets.size(); ++m)
+		{
+			const MeshOptimizer::Meshlet &meshlet = data.meshlets[m];
+			const MeshOptimizer::MeshletBounds bounds = MeshOptimizer::computeMeshletBounds(data, meshlet, positions, sizeof(Renderer::Vertex), !doubleSided[i]);
+			meshlets[sub.meshletStart + m] = Renderer::Meshlet
+			{
+				.center = glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]),
+				.radius = bounds.radius + quantizationSlack,
+				.coneApex = glm::vec3(bounds.coneApex[0], bounds.coneApex[1], bounds.coneApex[2]),
+				.coneCutoff = bounds.coneCutoff,
+				.coneAxis = glm::vec3(bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2]),
+				.subMeshIndex = static_cast<uint32_t>(i),
+				.vertexOffset = static_cast<uint32_t>(vertexBases[i] + meshlet.vertexOffset),
+				.triangleOffset = static_cast<uint32_t>(triangleBases[i] + meshlet.triangleOffset),
+				.vertexCount = meshlet.vertexCount,
+				.triangleCount = meshlet.triangleCount
+			};
+		}
+		std::transform(data.vertices.begin(), data.vertices.end(), meshletData.begin() + vertexBases[i],
+			[&sub](uint32_t local) { return static_cast<uint32_t>(sub.vertexStart + local); });
+		std::copy(data.triangles.begin(), data.triangles.end(), meshletData.begin() + triangleBases[i]);
+	});
+}
+
+void Application::buildLods(const std::vector<Renderer::SubMesh *> &subMeshes)
+{
+	// levels below this many triangles aren't worth a separate draw range
+	constexpr size_t MinLodTriangles = 64;
+	// a level may stray this far relative to the sub-mesh size, beyond that it no longer looks like the same mesh
+	constexpr float MaxRelativeError = 0.05f;
+	const auto start = std::chrono::steady_clock::now();
+
+	// every level is simplified from the full detail indices at half the previous level's triangles, so its
+	// error is relative to the original surface, and the chain stops once simplification barely gains anything
+	std::vector<std::vector<std::vector<uint32_t>>> subMeshLods(subMeshes.size());
+	threadPool.parallelFor(subMeshes.size(), [&](size_t i)
+	{
+		Renderer::SubMesh &sub = *subMeshes[i];
+		if (!isValidTriangleList(sub, indices.data()))
+		{
+			return;
+		}
+		const std::span<const uint32_t> fullIndices(indices.data() + sub.indexStart, sub.indexCount);
+		const float *positions = &vertices[sub.vertexStart].position.x;
+		const float maxError = glm::length(sub.boundsMax - sub.boundsMin) * MaxRelativeError;
+		size_t previousCount = sub.indexCount;
+		for (uint32_t lod = 0; lod < Renderer::SubMesh::MaxLods && previousCount / 3 >= 2 * MinLodTriangles; ++lod)
+		{
+			float error = 0;
+			std::vector<uint32_t> lodIndices = MeshOptimizer::simplify(fullIndices, positions, sizeof(Renderer::Vertex), sub.vertexCount,
+				previousCount / 6 * 3, maxError, error);
+			if (lodIndices.size() > previousCount * 85 / 100)
+			{
+				break;
+			}
+			MeshOptimizer::optimizeVertexCache(lodIndices, sub.vertexCount);
+			previousCount = lodIndices.size();
+			sub.lods[lod].error = error;
+			sub.lodCount = lod + 1;
+			subMeshLods[i].push_back(std::move(lodIndices));
+		}
+	});
+
+	// the levels go after every full detail range for now, packIndices moves them next to their sub-mesh
+	size_t levels = 0, fullTriangles = 0, coarsestTriangles = 0;
+	for (size_t i = 0; i < subMeshes.size(); ++i)
+	{
+		Renderer::SubMesh &sub = *subMeshes[i];
+		for (uint32_t lod = 0; lod < sub.lodCount; ++lod)
+		{
+			sub.lods[lod].indexStart = indices.size();
+			sub.lods[lod].indexCount = subMeshLods[i][lod].size();
+			indices.insert(indices.end(), subMeshLods[i][lod].begin(), subMeshLods[i][lod].end());
+		}
+		levels += sub.lodCount;
+		fullTriangles += sub.indexCount / 3;
+		coarsestTriangles += (sub.lodCount > 0 ? sub.lods[sub.lodCount - 1].indexCount : sub.indexCount) / 3;
+	}
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Mesh LODs in " << ms << " ms: " << levels << " levels over " << subMeshes.size() << " sub-meshes, "
+		<< fullTriangles << " -> " << coarsestTriangles << " triangles at the coarsest" << std::endl;
+}
+
+void Application::uploadDrawData()
+{
+	// LOD levels of every sub-mesh, shared by all of its draws
+	drawLods.clear();
+	std::vector<std::vector<uint32_t>> lodStarts(meshes.size());
+	std::vector<uint32_t> subMeshStarts(meshes.size());
+	std::vector<uint32_t> subMeshMaterials;
+	subMeshCount = 0;
+	for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex)
+	{
+		subMeshStarts[meshIndex] = subMeshCount;
+		subMeshCount += static_cast<uint32_t>(meshes[meshIndex].subMeshes.size());
+		for (const Renderer::SubMesh &sub : meshes[meshIndex].subMeshes)
+		{
+			subMeshMaterials.push_back(sub.materialIndex < materials.size() ? sub.materialIndex : 0u);
+			lodStarts[meshIndex].push_back(static_cast<uint32_t>(drawLods.size()));
+			for (const Renderer::MeshLod &lod : std::span(sub.lods).first(sub.lodCount))
+			{
+				drawLods.push_back(Renderer::DrawLod
+				{
+					.firstIndex = static_cast<uint32_t>(lod.indexStart),
+					.indexCount = static_cast<uint32_t>(lod.indexCount),
+					.error = lod.error
+				});
+			}
+		}
+	}
+
+	// instanced batches follow the rank of their sub-mesh, ranked by material so a material's batches are recorded together
+	std::vector<uint32_t> subMeshOrder(subMeshCount);
+	std::iota(subMeshOrder.begin(), subMeshOrder.end(), 0u);
+	std::ranges::stable_sort(subMeshOrder, {}, [&](uint32_t subMesh) { return subMeshMaterials[subMesh]; });
+	std::vector<uint32_t> subMeshRanks(subMeshCount);
+	for (uint32_t rank = 0; rank < subMeshCount; ++rank)
+	{
+		subMeshRanks[subMeshOrder[rank]] = rank;
+	}
+
+	// one draw per sub-mesh of every scene node that references a mesh, indexing that node's world matrix
+	std::vector<DrawCuller::Draw> cullDraws;
+	draws.clear();
+	drawSubMeshes.clear();
+	taskGroups.clear();
+	for (uint32_t node = 0; node < scene.size(); ++node)
+	{
+		const int32_t meshIndex = scene.meshIndex(node);
+		if (meshIndex < 0 || meshIndex >= static_cast<int32_t>(meshes.size()))
+		{
+			continue;
+		}
+		for (size_t subIndex = 0; subIndex < meshes[meshIndex].subMeshes.size(); ++subIndex)
+		{
+			const Renderer::SubMesh &sub = meshes[meshIndex].subMeshes[subIndex];
+			const uint32_t drawIndex = static_cast<uint32_t>(draws.size());
+			draws.push_back(Renderer::DrawData
+			{
+				.boundsMin = sub.boundsMin,
+				.indexCount = static_cast<uint32_t>(sub.indexCount),
+				.boundsMax = sub.boundsMax,
+				.firstIndex = static_cast<uint32_t>(sub.indexStart),
+				.vertexOffset = static_cast<int32_t>(sub.vertexStart),
+				.indexType = sub.indexType == VK_INDEX_TYPE_UINT16 ? 0u : 1u,
+				.transformIndex = node,
+				.materialIndex = sub.materialIndex < materials.size() ? sub.materialIndex : 0u,
+				.lodStart = lodStarts[meshIndex][subIndex],
+				.lodCount = sub.lodCount
+			});
+			drawSubMeshes.push_back(subMeshRanks[subMeshStarts[meshIndex] + subIndex]);
+			if (cpuCullingEnabled)
+			{
+				// sorted by index width first, the one binding that changes between CPU draws, then material
+				const Renderer::DrawData &draw = draws.back();
+				cullDraws.push_back(DrawCuller::Draw
+				{
+					.center = (sub.boundsMin + sub.boundsMax) * 0.5f,
+					.radius = glm::length(sub.boundsMax - sub.boundsMin) * 0.5f,
+					.transformIndex = node,
+					.stateKey = draw.indexType << 15 | std::min(draw.materialIndex, 0x7fffu)
+				});
+			}
+			for (uint32_t first = 0; first < sub.meshletCount; first += TaskGroupSize)
+			{
+				taskGroups.push_back(Renderer::TaskGroup
+				{
+					.drawIndex = drawIndex,
+					.meshletStart = sub.meshletStart + first,
+					.meshletCount = std::min(TaskGroupSize, sub.meshletCount - first)
+				});
+			}
+		}
+	}
+	drawCount = static_cast<uint32_t>(draws.size());
+	drawCount16 = static_cast<uint32_t>(std::count_if(draws.begin(), draws.end(), [](const Renderer::DrawData &draw) { return draw.indexType == 0; }));
+
+	// sized once here, batching every frame only reuses them
+	if (instancingEnabled)
+	{
+		instanceKeys.resize(drawCount);
+		instanceBucketEnds.reserve(2 * subMeshCount * (Renderer::SubMesh::MaxLods + 1));
+		instanceBatches.reserve(std::min<size_t>(drawCount, instanceBucketEnds.capacity()));
+	}
+
+	VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	if (meshShadingEnabled)
+	{
+		readStages |= VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+	}
+	drawDataBuffer = createDeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		draws.size() * sizeof(Renderer::DrawData), draws.data(), readStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, true);
+
+	// initial world matrices, later changes are written per frame by updateTransforms
+	scene.update();
+	const std::span<const glm::mat4> worlds = scene.worlds();
+	transformBuffer = createDeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		worlds.size_bytes(), worlds.data(), readStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, true);
+	std::cout << "Scene: " << scene.size() << " nodes, " << drawCount << " draws" << std::endl;
+	if (cpuCullingEnabled)
+	{
+		drawCuller.initialize(cullDraws, worlds);
+		std::cout << "CPU culling: " << DrawCuller::pathName(drawCuller.activePath()) << std::endl;
+	}
+
+	// meshlets only cover the full detail level, so the mesh shader path never selects a LOD
+	if (!meshShadingEnabled)
+	{
+		drawLodBuffer = createDeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			drawLods.size() * sizeof(Renderer::DrawLod), drawLods.data(), VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, true);
+	}
+
+	// written by the culling pass every frame, the early and late phase each get room for every draw,
+	// once per cull slot so async compute can fill the next frame's while the current one is drawn
+	if (gpuDrivenEnabled && drawCount > 0)
+	{
+		drawCommandBuffer = createDeviceBuffer(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			cullSlotCount * 2 * drawCount * sizeof(VkDrawIndexedIndirectCommand), nullptr, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, true);
+		drawCountBuffer = createDeviceBuffer(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, cullSlotCount * sizeof(Renderer::DrawCounts), nullptr,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, true);
+	}
+	// nothing counts as visible before the first frame, so it draws everything in the late phase
+	if (occlusionCullingEnabled && drawCount > 0)
+	{
+		const std::vector<uint32_t> visibility((asyncComputeEnabled ? 2 : 1) * drawCount, 0);
+		drawVisibilityBuffer = createDeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+			visibility.size() * sizeof(uint32_t), visibility.data(), VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, true);
+	}
+}
+
+void Application::buildMaterials(const tinygltf::Model &model)
+{
+	// material 0 is the default for primitives without one, glTF material i becomes i + 1
+	materials.assign(1, Renderer::Material{});
+	for (const tinygltf::Material &material : model.materials)
+	{
+		const tinygltf::PbrMetallicRoughness &pbr = material.pbrMetallicRoughness;
+		Renderer::Material newMaterial;
+		if (pbr.baseColorFactor.size() == 4)
+		{
+			newMaterial.baseColorFactor = glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2], pbr.baseColorFactor[3]);
+		}
+		// images are loaded in glTF order, so a texture's source is its bindless slot
+		const int texture = pbr.baseColorTexture.index;
+		if (texture >= 0 && texture < static_cast<int>(model.textures.size()) && model.textures[texture].source >= 0)
+		{
+			newMaterial.baseColorTexture = static_cast<uint32_t>(model.textures[texture].source);
+		}
+		if (material.alphaMode == "MASK")
+		{
+			newMaterial.alphaCutoff = static_cast<float>(material.alphaCutoff);
+		}
+		materials.push_back(newMaterial);
+	}
+}
+
+void Application::uploadMaterials()
+{
+	if (materials.empty())
+	{
+		materials.emplace_back();
+	}
+
+	// textures that failed to load keep their slot empty, they and the ones that don't fit the array fall back to the
+	// factor alone
+	const uint32_t textureCount = std::min(static_cast<uint32_t>(images.size()), bindlessTextureCapacity);
+	for (Renderer::Material &material : materials)
+	{
+		if (material.baseColorTexture >= textureCount || images[material.baseColorTexture].view == nullptr)
+		{
+			material.baseColorTexture = Renderer::Material::NoTexture;
+		}
+	}
+
+	// the set isn't in use yet, but update-after-bind would also allow filling it while bound. Empty slots are
+	// left unwritten, which partially bound allows as long as nothing samples them
+	std::vector<VkDescriptorImageInfo> imageInfos(textureCount);
+	std::vector<VkWriteDescriptorSet> writes;
+	for (uint32_t i = 0; i < textureCount; ++i)
+	{
+		if (images[i].view == nullptr)
+		{
+			continue;
+		}
+		imageInfos[i] = VkDescriptorImageInfo{ .imageView = images[i].view, .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		if (!writes.empty() && writes.back().dstArrayElement + writes.back().descriptorCount == i)
+		{
+			++writes.back().descriptorCount;
+			continue;
+		}
+		writes.push_back(VkWriteDescriptorSet
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = bindlessSet,
+			.dstBinding = 1,
+			.dstArrayElement = i,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			.pImageInfo = &imageInfos[i]
+		});
+	}
+	if (!writes.empty())
+	{
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	// read where the geometry stage fetches the material of its draw, rewritten by updateMaterials as textures stream
+	const VkPipelineStageFlags2 readStages = meshShadingEnabled ? VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT : VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+	materialBuffer = createDeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		materials.size() * sizeof(Renderer::Material), materials.data(), readStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	std::cout << "Materials: " << materials.size() << ", " << textureCount << " bindless textures" << std::endl;
+}
+
+void Application::startTextureStreaming(std::span<const TextureStreamer::Source> sources)
+{
+	// texture i starts in slot i, the rest of the array takes the images streaming swaps in
+	const uint32_t textureCount = std::min(static_cast<uint32_t>(sources.size()), bindlessTextureCapacity);
+	textureSlots.resize(textureCount);
+	std::iota(textureSlots.begin(), textureSlots.end(), 0u);
+	freeTextureSlots.clear();
+	for (uint32_t slot = bindlessTextureCapacity; slot > textureCount; --slot)
+	{
+		freeTextureSlots.push_back(slot - 1);
+	}
+	materialTextures.clear();
+	for (const Renderer::Material &material : materials)
+	{
+		materialTextures.push_back(material.baseColorTexture);
+	}
+
+	textureStreamer.initialize(std::vector<TextureStreamer::Source>(sources.begin(), sources.begin() + textureCount));
+	constexpr double MB = 1024.0 * 1024.0;
+	std::cout << "Texture streaming: " << textureCount << " textures, " << textureStreamer.residentBytes() / MB << " of "
+		<< textureStreamer.fullBytes() / MB << " MB resident at start" << std::endl;
+}
+
+void Application::applyTextureLoads()
+{
+	std::vector<TextureStreamer::Load> loads = textureStreamer.takeCompleted();
+	if (loads.empty())
+	{
+		return;
+	}
+
+	for (const TextureStreamer::Load &load : loads)
+	{
+		const uint32_t texture = load.texture;
+		const TextureStreamer::Source &source = textureStreamer.source(texture);
+		Renderer::Image newImage;
+		if (!freeTextureSlots.empty())
+		{
+			newImage = createImageFromMips(load.levels, std::max(1u, source.width >> load.firstMip), std::max(1u, source.height >> load.firstMip),
+				source.mipLevels - load.firstMip);
+		}
+		if (newImage.handle == nullptr)
+		{
+			// out of memory, or every spare slot still waits for its old image to retire, asked for again later
+			textureStreamer.cancel(texture);
+			continue;
+		}
+
+		// the new slot is one no pending frame samples, the old one is only handed out again once they are done
+		const uint32_t slot = freeTextureSlots.back();
+		freeTextureSlots.pop_back();
+		const VkDescriptorImageInfo imageInfo{ .imageView = newImage.view, .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VkWriteDescriptorSet write
+		{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = bindlessSet,
+			.dstBinding = 1,
+			.dstArrayElement = slot,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			.pImageInfo = &imageInfo
+		};
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+		deferDeletion([this, oldImage = images[texture], oldSlot = textureSlots[texture]]()
+		{
+			gpuMemory.destroyImage(oldImage.handle, oldImage.allocation);
+			vkDestroyImageView(device, oldImage.view, nullptr);
+			freeTextureSlots.push_back(oldSlot);
+		});
+		images[texture] = newImage;
+		textureSlots[texture] = slot;
+
+		for (size_t i = 0; i < materials.size(); ++i)
+		{
+			if (materialTextures[i] == texture)
+			{
+				materials[i].baseColorTexture = slot;
+				materialsDirty = true;
+			}
+		}
+		textureStreamer.markResident(texture, load.firstMip);
+	}
+	// the frame being recorded waits on this batch, so it may already sample the new images
+	uploadEngine.submit();
+}
+
+void Application::updateTextureStreaming(const glm::mat4 &viewProj, float pixelScale)
+{
+	// detail takes a few frames to stream in anyway, so estimates don't need to be any more frequent
+	if (!textureStreamer.isActive() || frameCounter % TextureStreamingInterval != 0)
+	{
+		return;
+	}
+	CPU_ZONE("texture streaming");
+
+	// the frustum planes of the clip volume, depth runs from 0 to 1
+	const glm::vec4 rowX(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+	const glm::vec4 rowY(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+	const glm::vec4 rowZ(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+	const glm::vec4 rowW(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+	std::array<glm::vec4, 6> planes{ rowW + rowX, rowW - rowX, rowW + rowY, rowW - rowY, rowZ, rowW - rowZ };
+	for (glm::vec4 &plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	// a draw's texture is assumed to span its bounds, so the bounds' projected diameter is the texels it needs across
+	textureStreamer.beginUpdate();
+	for (const Renderer::DrawData &draw : draws)
+	{
+		const uint32_t texture = draw.materialIndex < materialTextures.size() ? materialTextures[draw.materialIndex] : Renderer::Material::NoTexture;
+		if (texture >= textureSlots.size())
+		{
+			continue;
+		}
+		const glm::mat4 &world = scene.worlds()[draw.transformIndex];
+		const float scale = std::sqrt(std::max({ glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+			glm::dot(glm::vec3(world[1]), glm::vec3(world[1])), glm::dot(glm::vec3(world[2]), glm::vec3(world[2])) }));
+		const glm::vec4 center = world * glm::vec4((draw.boundsMin + draw.boundsMax) * 0.5f, 1.0f);
+		const float radius = glm::length(draw.boundsMax - draw.boundsMin) * 0.5f * scale;
+		if (std::any_of(planes.begin(), planes.end(), [&](const glm::vec4 &plane) { return glm::dot(plane, center) < -radius; }))
+		{
+			continue;
+		}
+		// measured from the nearest the bounds get, never closer than the near plane
+		const float distance = std::max((viewProj * center).w - radius, 0.1f);
+		textureStreamer.want(texture, 2.0f * radius * pixelScale / distance);
+	}
+	textureStreamer.endUpdate(textureStreamingBudget());
+}
+
+size_t Application::textureStreamingBudget() const
+{
+	if (config.textureBudget > 0)
+	{
+		return static_cast<size_t>(config.textureBudget) << 20;
+	}
+
+	// what the device local heaps leave once everything but textures is counted, with a tenth held back for
+	// render targets recreated on resize and for images waiting on their deferred deletion
+	VkDeviceSize budget = 0;
+	VkDeviceSize usage = 0;
+	for (const GpuMemory::HeapStats &heap : gpuMemory.heapStats())
+	{
+		if (heap.deviceLocal)
+		{
+			budget += heap.budget;
+			usage += heap.usage;
+		}
+	}
+	const VkDeviceSize others = usage - std::min(usage, gpuMemory.usage(GpuMemory::Textures));
+	const VkDeviceSize margin = budget / 10;
+	return budget > others + margin ? static_cast<size_t>(budget - others - margin) : 0;
+}
+
+void Application::uploadMeshlets(std::span<const std::byte> meshletData, std::span<const std::byte> meshletIndexData)
+{
+	constexpr VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+	constexpr VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_2_MESH_SHADER_BIT_EXT;
+	meshletBuffer = createDeviceBuffer(usage, meshletData.size(), meshletData.data(), stages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	meshletDataBuffer = createDeviceBuffer(usage, meshletIndexData.size(), meshletIndexData.data(), stages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	taskGroupBuffer = createDeviceBuffer(usage, taskGroups.size() * sizeof(Renderer::TaskGroup), taskGroups.data(), VK_PIPELINE_STAGE_2_TASK_SHADER_BIT_EXT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	meshletCount = static_cast<uint32_t>(meshletData.size() / sizeof(Renderer::Meshlet));
+
+	std::cout << "Meshlets: " << meshletCount << " in " << taskGroups.size() << " task groups, "
+		<< (meshletData.size() + meshletIndexData.size()) / (1024.0 * 1024.0) << " MB" << std::endl;
+}
+
+void Application::uploadGeometry(std::span<const std::byte> vertexData, std::span<const std::byte> indexData, std::span<const std::byte> indexData16)
+{
+	// geometry lives in device local memory, filled through the staging ring
+	vertexBuffer = createDeviceBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		vertexData.size(), vertexData.data(),
+		VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+	indexBuffer = createDeviceBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		indexData.size(), indexData.data(),
+		VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
+	indexBuffer16 = createDeviceBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		indexData16.size(), indexData16.data(),
+		VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
+
+	const char *formatName = config.vertexFormat == VertexFormat::Compact ? "compact" : "full";
+	std::cout << "Geometry memory (" << formatName << " vertices): vertex " << vertexData.size() / (1024.0 * 1024.0)
+		<< " MB, index " << indexData.size() / (1024.0 * 1024.0) << " MB 32 bit + " << indexData16.size() / (1024.0 * 1024.0)
+		<< " MB 16 bit" << std::endl;
+}
+
+void Application::loadModel()
+{
+	using namespace tinygltf;
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point lapStart = Clock::now();
+	auto lap = [&lapStart]()
+	{
+		const Clock::time_point now = Clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(now - lapStart).count();
+		lapStart = now;
+		return ms;
+	};
+
+	const std::string &modelPath = config.scenePath;
+
+	// a baked cache from a previous run skips parsing and decoding entirely
+	const uint64_t sourceHash = MeshCache::hashSource(modelPath, (config.optimizeMeshes ? 1 : 0) | (config.meshLods ? 2 : 0));
+	const std::string cacheFile = MeshCache::cachePath(modelPath);
+	if (loadModelCache(cacheFile, sourceHash))
+	{
+		return;
+	}
+
+	Model model;
+	TinyGLTF loader;
+
+	std::string err;
+	std::string warn;
+	if (std::filesystem::path(modelPath).extension() == ".glb")
+	{
+		loader.LoadBinaryFromFile(&model, &err, &warn, modelPath);
+	}
+	else
+	{
+		loader.LoadASCIIFromFile(&model, &err, &warn, modelPath);
+	}
+	const double parseMs = lap();
+
+	// load images, their transitions are batched with the geometry into a single upload submission
+	for (const Image &image : model.images)
+	{
+		// a failed image leaves its slot empty, so the glTF image index stays the bindless slot of the rest
+		images.push_back(createImage(image.image, image.width, image.height, image.component, image.bits));
+	}
+	const double imagesMs = lap();
+
+	// pass one: place every sub-mesh with a prefix sum over the accessor counts
+	size_t vertexTotal = 0;
+	size_t indexTotal = 0;
+	std::vector<bool> doubleSided; // per sub-mesh, disables meshlet cone culling
+	for (const Mesh &mesh : model.meshes)
+	{
+		Renderer::Mesh newMesh;
+		for (const Primitive &primitive : mesh.primitives)
+		{
+			Renderer::SubMesh subMesh{ .vertexStart = vertexTotal, .indexStart = indexTotal };
+			if (const Accessor *posAccess = findFloatAttribute(model, primitive, "POSITION", TINYGLTF_TYPE_VEC3))
+			{
+				subMesh.vertexCount = posAccess->count;
+			}
+			if (const Accessor *indexAccess = findIndexAccessor(model, primitive))
+			{
+				subMesh.indexCount = indexAccess->count;
+			}
+			if (primitive.material >= 0 && primitive.material < static_cast<int>(model.materials.size()))
+			{
+				subMesh.materialIndex = static_cast<uint32_t>(primitive.material) + 1;
+			}
+			vertexTotal += subMesh.vertexCount;
+			indexTotal += subMesh.indexCount;
+			newMesh.subMeshes.push_back(subMesh);
+			doubleSided.push_back(primitive.material >= 0 && model.materials[primitive.material].doubleSided);
+		}
+		meshes.push_back(std::move(newMesh));
+	}
+	vertices.resize(vertexTotal);
+	indices.resize(indexTotal);
+
+	constexpr size_t DecodeChunkSize = 64 * 1024;
+	std::vector<DecodeJob> jobs;
+	for (size_t meshIdx = 0; meshIdx < model.meshes.size(); ++meshIdx)
+	{
+		for (size_t primIdx = 0; primIdx < model.meshes[meshIdx].primitives.size(); ++primIdx)
+		{
+			const Primitive &primitive = model.meshes[meshIdx].primitives[primIdx];
+			const Renderer::SubMesh &subMesh = meshes[meshIdx].subMeshes[primIdx];
+			for (size_t begin = 0; begin < subMesh.vertexCount; begin += DecodeChunkSize)
+			{
+				jobs.push_back(DecodeJob{ &primitive, &subMesh, false, begin, std::min(begin + DecodeChunkSize, subMesh.vertexCount) });
+			}
+			for (size_t begin = 0; begin < subMesh.indexCount; begin += DecodeChunkSize)
+			{
+				jobs.push_back(DecodeJob{ &primitive, &subMesh, true, begin, std::min(begin + DecodeChunkSize, subMesh.indexCount) });
+			}
+		}
+	}
+	const double layoutMs = lap();
+
+	// pass two: decode straight into the final arrays in parallel
+	threadPool.parallelFor(jobs.size(), [&](size_t jobIdx)
+	{
+		decodePrimitiveRange(model, jobs[jobIdx], vertices.data(), indices.data());
+	});
+	std::vector<Renderer::SubMesh *> subMeshes;
+	for (Renderer::Mesh &mesh : meshes)
+	{
+		for (Renderer::SubMesh &sub : mesh.subMeshes)
+		{
+			subMeshes.push_back(&sub);
+		}
+	}
+	const double decodeMs = lap();
+
+	if (config.optimizeMeshes)
+	{
+		optimizeGeometry(subMeshes);
+	}
+	const double optimizeMs = lap();
+
+	// sub-mesh bounds, then the compact layout quantized against them
+	compactVertices.resize(vertices.size());
+	threadPool.parallelFor(subMeshes.size(), [&](size_t i)
+	{
+		computeBounds(*subMeshes[i], vertices.data());
+		quantizeVertices(*subMeshes[i], vertices.data(), compactVertices.data());
+	});
+	buildMeshlets(subMeshes, doubleSided);
+	if (config.meshLods)
+	{
+		buildLods(subMeshes);
+	}
+	packIndices(subMeshes);
+	const double packMs = lap();
+
+	uploadGeometry(config.vertexFormat == VertexFormat::Compact ? std::as_bytes(std::span(compactVertices)) : std::as_bytes(std::span(vertices)),
+		std::as_bytes(std::span(indices)), std::as_bytes(std::span(indices16)));
+	buildScene(model);
+	buildMaterials(model);
+	uploadDrawData();
+	uploadMaterials();
+	if (meshShadingEnabled)
+	{
+		uploadMeshlets(std::as_bytes(std::span(meshlets)), std::as_bytes(std::span(meshletData)));
+	}
+	uploadEngine.submit();
+	const double buffersMs = lap();
+
+	std::cout << "Model load: parse " << parseMs << " ms, images " << imagesMs << " ms, layout " << layoutMs
+		<< " ms, decode " << decodeMs << " ms (" << jobs.size() << " jobs, " << threadPool.size() + 1 << " threads), optimize "
+		<< optimizeMs << " ms, meshlets, LODs and packing " << packMs << " ms, buffers " << buffersMs << " ms" << std::endl;
+
+	if (sourceHash != MeshCache::UncachedSource)
+	{
+		bakeModelCache(cacheFile, sourceHash, model);
+		std::cout << "Baked model cache in " << lap() << " ms: " << cacheFile << std::endl;
+	}
+}
+
+bool Application::loadModelCache(const std::string &cacheFile, uint64_t sourceHash)
+{
+	const auto start = std::chrono::steady_clock::now();
+	MeshCache::Reader &cache = modelCache;
+	if (!cache.open(cacheFile, sourceHash))
+	{
+		return false;
+	}
+
+	const std::span<const MeshCache::MeshRecord> meshRecords = cache.array<MeshCache::MeshRecord>(MeshCache::Section::Meshes);
+	const std::span<const MeshCache::SubMeshRecord> subMeshRecords = cache.array<MeshCache::SubMeshRecord>(MeshCache::Section::SubMeshes);
+	const std::span<const MeshCache::LodRecord> lodRecords = cache.array<MeshCache::LodRecord>(MeshCache::Section::Lods);
+	// every range has to lie inside the sections handed to uploadGeometry and uploadMeshlets, the GPU doesn't check
+	const MeshCache::Section vertexSection = config.vertexFormat == VertexFormat::Compact ? MeshCache::Section::CompactVertices : MeshCache::Section::Vertices;
+	const size_t vertexSize = config.vertexFormat == VertexFormat::Compact ? sizeof(Renderer::CompactVertex) : sizeof(Renderer::Vertex);
+	const uint64_t vertexTotal = cache.section(vertexSection).size() / vertexSize;
+	const uint64_t indexTotal = cache.array<uint32_t>(MeshCache::Section::Indices).size();
+	const uint64_t indexTotal16 = cache.array<uint16_t>(MeshCache::Section::Indices16).size();
+	const uint64_t meshletTotal = cache.array<Renderer::Meshlet>(MeshCache::Section::Meshlets).size();
+	// written so a garbage start or count can't wrap around
+	auto inRange = [](uint64_t start, uint64_t count, uint64_t total) { return start <= total && count <= total - start; };
+	const bool subMeshesValid = std::all_of(subMeshRecords.begin(), subMeshRecords.end(), [&](const MeshCache::SubMeshRecord &record)
+	{
+		if (record.indexType != VK_INDEX_TYPE_UINT16 && record.indexType != VK_INDEX_TYPE_UINT32)
+		{
+			return false;
+		}
+		const uint64_t indices = record.indexType == VK_INDEX_TYPE_UINT16 ? indexTotal16 : indexTotal;
+		if (!inRange(record.vertexStart, record.vertexCount, vertexTotal) || !inRange(record.indexStart, record.indexCount, indices) ||
+			(meshShadingEnabled && !inRange(record.meshletStart, record.meshletCount, meshletTotal)))
+		{
+			return false;
+		}
+		if (record.lodCount > Renderer::SubMesh::MaxLods || !inRange(record.lodStart, record.lodCount, lodRecords.size()))
+		{
+			return false;
+		}
+		return std::all_of(lodRecords.begin() + record.lodStart, lodRecords.begin() + record.lodStart + record.lodCount, [&](const MeshCache::LodRecord &lod)
+		{
+			return inRange(lod.indexStart, lod.indexCount, indices);
+		});
+	});
+	for (const MeshCache::MeshRecord &meshRecord : meshRecords)
+	{
+		if (!subMeshesValid || !inRange(meshRecord.firstSubMesh, meshRecord.subMeshCount, subMeshRecords.size()))
+		{
+			std::cerr << "Corrupt mesh cache: " << cacheFile << std::endl;
+			meshes.clear();
+			cache.close();
+			return false;
+		}
+
+		Renderer::Mesh newMesh;
+		for (const MeshCache::SubMeshRecord &record : subMeshRecords.subspan(meshRecord.firstSubMesh, meshRecord.subMeshCount))
+		{
+			newMesh.subMeshes.push_back(Renderer::SubMesh
+			{
+				.vertexStart = record.vertexStart,
+				.vertexCount = record.vertexCount,
+				.indexStart = record.indexStart,
+				.indexCount = record.indexCount,
+				.indexType = static_cast<VkIndexType>(record.indexType),
+				.meshletStart = record.meshletStart,
+				.meshletCount = record.meshletCount,
+				.materialIndex = record.materialIndex,
+				.boundsMin = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]),
+				.boundsMax = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]),
+				.lodCount = record.lodCount
+			});
+			for (uint32_t lod = 0; lod < record.lodCount; ++lod)
+			{
+				const MeshCache::LodRecord &lodRecord = lodRecords[record.lodStart + lod];
+				newMesh.subMeshes.back().lods[lod] = Renderer::MeshLod{ .indexStart = lodRecord.indexStart, .indexCount = lodRecord.indexCount, .error = lodRecord.error };
+			}
+		}
+		meshes.push_back(std::move(newMesh));
+	}
+
+	// pre-mipped textures go from the mapping straight into staging, when streaming only from their tail
+	const std::span<const std::byte> textureData = cache.section(MeshCache::Section::TextureData);
+	const std::span<const MeshCache::TextureRecord> textureRecords = cache.array<MeshCache::TextureRecord>(MeshCache::Section::Textures);
+	// a streamed load only lands in a spare slot, without any every load would be dropped and requested again forever
+	const bool streamTextures = textureStreamingEnabled && textureRecords.size() + MinSpareTextureSlots <= bindlessTextureCapacity;
+	if (textureStreamingEnabled && !streamTextures)
+	{
+		std::cerr << "Texture streaming needs " << MinSpareTextureSlots << " spare bindless slots, loading full textures" << std::endl;
+	}
+	std::vector<TextureStreamer::Source> textureSources;
+	auto discardTextures = [&](const char *reason)
+	{
+		// materials index every texture, so a partial set falls back to the glTF import. The uploads of the images
+		// made so far finish first, and their acquires never reach the graphics queue
+		std::cerr << reason << cacheFile << std::endl;
+		uploadEngine.submit();
+		uploadEngine.wait(uploadEngine.lastSubmittedValue());
+		for (const Renderer::Image &image : images)
+		{
+			uploadEngine.discardAcquire(image.handle);
+			gpuMemory.destroyImage(image.handle, image.allocation);
+			vkDestroyImageView(device, image.view, nullptr);
+		}
+		images.clear();
+		meshes.clear();
+		cache.close();
+	};
+	for (const MeshCache::TextureRecord &record : textureRecords)
+	{
+		if (record.width == 0 && record.dataSize == 0)
+		{
+			// an image the bake couldn't convert, its slot stays empty and its materials use the factor alone
+			images.emplace_back();
+			textureSources.emplace_back();
+			continue;
+		}
+		if (record.width == 0 || record.height == 0 || record.dataOffset + record.dataSize > textureData.size())
+		{
+			discardTextures("Corrupt texture in the mesh cache: ");
+			return false;
+		}
+		const std::span<const unsigned char> mipChain{ reinterpret_cast<const unsigned char *>(textureData.data()) + record.dataOffset, record.dataSize };
+		uint32_t firstMip = 0;
+		while (streamTextures && firstMip + 1 < record.mipLevels &&
+			(std::max(record.width, record.height) >> firstMip) > TextureStreamer::ResidentTailSize)
+		{
+			++firstMip;
+		}
+		const size_t offset = std::min(TextureStreamer::levelOffset(record.width, record.height, firstMip), mipChain.size());
+		Renderer::Image newImage = createImageFromMips(mipChain.subspan(offset), std::max(1u, record.width >> firstMip),
+			std::max(1u, record.height >> firstMip), record.mipLevels - firstMip);
+		if (newImage.handle == nullptr)
+		{
+			discardTextures("Error creating a texture from the mesh cache: ");
+			return false;
+		}
+		images.push_back(newImage);
+		textureSources.push_back(TextureStreamer::Source{ .width = record.width, .height = record.height, .mipLevels = record.mipLevels, .mipChain = mipChain });
+	}
+
+	// records are in pre-order already, a parent always comes before its children
+	scene.clear();
+	for (const MeshCache::NodeRecord &record : cache.array<MeshCache::NodeRecord>(MeshCache::Section::Nodes))
+	{
+		const uint32_t parent = record.parent < scene.size() ? record.parent : Scene::NoParent;
+		scene.addNode(parent, glm::make_mat4(record.localTransform), record.meshIndex);
+	}
+
+	uploadGeometry(cache.section(vertexSection), cache.section(MeshCache::Section::Indices), cache.section(MeshCache::Section::Indices16));
+	const std::span<const Renderer::Material> materialRecords = cache.array<Renderer::Material>(MeshCache::Section::Materials);
+	materials.assign(materialRecords.begin(), materialRecords.end());
+	uploadDrawData();
+	uploadMaterials();
+	if (meshShadingEnabled)
+	{
+		uploadMeshlets(cache.section(MeshCache::Section::Meshlets), cache.section(MeshCache::Section::MeshletData));
+	}
+	uploadEngine.submit();
+	if (streamTextures)
+	{
+		startTextureStreaming(textureSources);
+	}
+	else
+	{
+		cache.close();
+	}
+
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Model loaded from cache in " << ms << " ms: " << cacheFile << std::endl;
+	return true;
+}
+
+void Application::bakeModelCache(const std::string &cacheFile, uint64_t sourceHash, const tinygltf::Model &model)
+{
+	std::vector<MeshCache::MeshRecord> meshRecords;
+	std::vector<MeshCache::SubMeshRecord> subMeshRecords;
+	std::vector<MeshCache::LodRecord> lodRecords;
+	for (const Renderer::Mesh &mesh : meshes)
+	{
+		meshRecords.push_back(MeshCache::MeshRecord
+		{
+			.firstSubMesh = static_cast<uint32_t>(subMeshRecords.size()),
+			.subMeshCount = static_cast<uint32_t>(mesh.subMeshes.size())
+		});
+		for (const Renderer::SubMesh &sub : mesh.subMeshes)
+		{
+			subMeshRecords.push_back(MeshCache::SubMeshRecord
+			{
+				.vertexStart = sub.vertexStart,
+				.vertexCount = sub.vertexCount,
+				.indexStart = sub.indexStart,
+				.indexCount = sub.indexCount,
+				.boundsMin{ sub.boundsMin.x, sub.boundsMin.y, sub.boundsMin.z },
+				.boundsMax{ sub.boundsMax.x, sub.boundsMax.y, sub.boundsMax.z },
+				.indexType = static_cast<uint32_t>(sub.indexType),
+				.meshletStart = sub.meshletStart,
+				.meshletCount = sub.meshletCount,
+				.materialIndex = sub.materialIndex,
+				.lodStart = static_cast<uint32_t>(lodRecords.size()),
+				.lodCount = sub.lodCount
+			});
+			for (const Renderer::MeshLod &lod : std::span(sub.lods).first(sub.lodCount))
+			{
+				lodRecords.push_back(MeshCache::LodRecord{ .indexStart = lod.indexStart, .indexCount = lod.indexCount, .error = lod.error });
+			}
+		}
+	}
+
+	// textures are expanded and mipped on the CPU once, unsupported images get an empty record the load keeps
+	// as an empty slot
+	std::vector<std::vector<unsigned char>> mipChains(model.images.size());
+	std::vector<MeshCache::TextureRecord> textureRecords(model.images.size());
+	threadPool.parallelFor(model.images.size(), [&](size_t i)
+	{
+		const tinygltf::Image &image = model.images[i];
+		const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+		const bool supported = image.component >= 1 && image.component <= 4 && (image.bits == 8 || image.bits == 16) &&
+			image.image.size() >= pixelCount * image.component * (image.bits / 8);
+		if (!supported)
+		{
+			return;
+		}
+
+		std::vector<unsigned char> rgba(pixelCount * 4);
+		expandToRGBA(rgba.data(), image.image.data(), pixelCount, image.component, image.bits);
+		MeshCache::TextureRecord &record = textureRecords[i];
+		record.width = image.width;
+		record.height = image.height;
+		mipChains[i] = buildMipChainRGBA8(rgba, record.width, record.height, record.mipLevels);
+	});
+
+	std::vector<unsigned char> textureData;
+	for (size_t i = 0; i < mipChains.size(); ++i)
+	{
+		textureRecords[i].dataOffset = textureData.size();
+		textureRecords[i].dataSize = mipChains[i].size();
+		textureData.insert(textureData.end(), mipChains[i].begin(), mipChains[i].end());
+	}
+
+	std::vector<MeshCache::NodeRecord> nodeRecords(scene.size());
+	for (uint32_t node = 0; node < scene.size(); ++node)
+	{
+		nodeRecords[node].parent = scene.parent(node);
+		nodeRecords[node].meshIndex = scene.meshIndex(node);
+		std::memcpy(nodeRecords[node].localTransform, glm::value_ptr(scene.localTransform(node)), sizeof(nodeRecords[node].localTransform));
+	}
+
+	MeshCache::Writer writer;
+	writer.add(MeshCache::Section::Vertices, std::span<const Renderer::Vertex>(vertices));
+	writer.add(MeshCache::Section::CompactVertices, std::span<const Renderer::CompactVertex>(compactVertices));
+	writer.add(MeshCache::Section::Indices, std::span<const uint32_t>(indices));
+	writer.add(MeshCache::Section::Indices16, std::span<const uint16_t>(indices16));
+	writer.add(MeshCache::Section::Meshlets, std::span<const Renderer::Meshlet>(meshlets));
+	writer.add(MeshCache::Section::MeshletData, std::span<const uint32_t>(meshletData));
+	writer.add(MeshCache::Section::Nodes, std::span<const MeshCache::NodeRecord>(nodeRecords));
+	writer.add(MeshCache::Section::Meshes, std::span<const MeshCache::MeshRecord>(meshRecords));
+	writer.add(MeshCache::Section::SubMeshes, std::span<const MeshCache::SubMeshRecord>(subMeshRecords));
+	writer.add(MeshCache::Section::Lods, std::span<const MeshCache::LodRecord>(lodRecords));
+	writer.add(MeshCache::Section::Materials, std::span<const Renderer::Material>(materials));
+	writer.add(MeshCache::Section::Textures, std::span<const MeshCache::TextureRecord>(textureRecords));
+	writer.add(MeshCache::Section::TextureData, std::span<const unsigned char>(textureData));
+	writer.write(cacheFile, sourceHash);
+}
+
+Renderer::Buffer Application::createDeviceBuffer(VkBufferUsageFlags usage, size_t byteSize, const void *initData,
+	VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, bool computeShared)
+{
+	if (byteSize == 0)
+	{
+		return Renderer::Buffer{}; // zero sized buffers are invalid, callers check the handle
+	}
+
+	// without initData the buffer is only allocated, for contents the GPU produces itself
+	const bool directWrite = initData && uploadEngine.prefersDirectWrites();
+	const bool concurrent = computeShared && asyncComputeEnabled;
+	VkBufferCreateInfo buffInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = byteSize,
+		.usage = usage | (initData && !directWrite ? VK_BUFFER_USAGE_TRANSFER_DST_BIT : 0),
+		.sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(sharedQueueFamilies.size()) : 0,
+		.pQueueFamilyIndices = concurrent ? sharedQueueFamilies.data() : nullptr
+	};
+
+	// ReBAR / unified memory can be written in place, otherwise the data goes through staging
+	VmaAllocationCreateInfo allocInfo
+	{
+		.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+	};
+	if (directWrite)
+	{
+		allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+		allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	}
+
+	Renderer::Buffer newBuff;
+	VmaAllocationInfo allocResult{};
+	if (!gpuMemory.createBuffer(GpuMemory::Geometry, buffInfo, allocInfo, newBuff.buffer, newBuff.allocation, &allocResult))
+	{
+		showError("Error allocating buffer");
+		return Renderer::Buffer{};
+	}
+	if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+	{
+		VkBufferDeviceAddressInfo bdaInfo{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = newBuff.buffer };
+		newBuff.address = vkGetBufferDeviceAddress(device, &bdaInfo);
+	}
+
+	if (directWrite)
+	{
+		std::memcpy(allocResult.pMappedData, initData, byteSize);
+		vmaFlushAllocation(gpuMemory.handle(), newBuff.allocation, 0, VK_WHOLE_SIZE);
+		uploadEngine.noteDirectWrite(byteSize);
+	}
+	else if (initData)
+	{
+		uploadEngine.uploadBuffer(newBuff.buffer, 0, initData, byteSize);
+		uploadEngine.releaseBuffer(newBuff.buffer, dstStage, dstAccess, concurrent);
+	}
+	return newBuff;
+}
+
+Renderer::Image Application::allocateImage(uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	VkImageCreateInfo imageInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = textureFormat,
+		.extent {.width = width, .height = height, .depth = 1},
+		.mipLevels = mipLevels,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	VmaAllocationCreateInfo allocInfo{ .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE };
+
+	Renderer::Image image{ .width = width, .height = height, .mipLevels = mipLevels };
+	if (!gpuMemory.createImage(GpuMemory::Textures, imageInfo, allocInfo, image.handle, image.allocation))
+	{
+		showError("Error creating image");
+		return Renderer::Image{};
+	}
+
+	VkImageViewCreateInfo imgViewInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = image.handle,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = textureFormat,
+		.subresourceRange
+		{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.levelCount = mipLevels,
+			.layerCount = 1
+		}
+	};
+	if (vkCreateImageView(device, &imgViewInfo, nullptr, &image.view) != VK_SUCCESS)
+	{
+		showError("Error creating image view");
+		gpuMemory.destroyImage(image.handle, image.allocation);
+		return Renderer::Image{};
+	}
+
+	uploadEngine.prepareImage(image.handle, VkImageSubresourceRange{ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = mipLevels, .layerCount = 1 });
+	return image;
+}
+
+void Application::stageImageLevel(const Renderer::Image &image, uint32_t level, const unsigned char *pixels, int components, int bitsPerChannel)
+{
+	const uint32_t width = std::max(1u, image.width >> level);
+	const uint32_t height = std::max(1u, image.height >> level);
+	const size_t srcRowBytes = static_cast<size_t>(width) * components * (bitsPerChannel / 8);
+
+	// expand straight into staging, in row bands so large textures don't need a larger ring
+	const size_t dstRowBytes = static_cast<size_t>(width) * 4;
+	const uint32_t rowsPerChunk = std::max<uint32_t>(1, static_cast<uint32_t>(uploadEngine.stagingCapacity() / 2 / dstRowBytes));
+	for (uint32_t row = 0; row < height; row += rowsPerChunk)
+	{
+		const uint32_t rowCount = std::min(rowsPerChunk, height - row);
+		const UploadEngine::StagingAllocation staging = uploadEngine.allocateStaging(dstRowBytes * rowCount, 16);
+		expandToRGBA(static_cast<unsigned char *>(staging.data), pixels + srcRowBytes * row,
+			static_cast<size_t>(width) * rowCount, components, bitsPerChannel);
+
+		uploadEngine.copyBufferToImage(staging.buffer, image.handle, VkBufferImageCopy
+		{
+			.bufferOffset = staging.offset,
+			.imageSubresource{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1 },
+			.imageOffset{.x = 0, .y = static_cast<int32_t>(row), .z = 0 },
+			.imageExtent{.width = width, .height = rowCount, .depth = 1 }
+		});
+	}
+}
+
+Renderer::Image Application::createImage(std::span<const unsigned char> imageData, uint32_t width, uint32_t height, int components, int bitsPerChannel)
+{
+	const size_t srcRowBytes = static_cast<size_t>(width) * components * (bitsPerChannel / 8);
+	if (components < 1 || components > 4 || (bitsPerChannel != 8 && bitsPerChannel != 16) || imageData.size() < srcRowBytes * height)
+	{
+		std::cerr << "Unsupported image data: " << components << " components, " << bitsPerChannel << " bits" << std::endl;
+		return Renderer::Image{};
+	}
+
+	// full mip chain when the format can be blitted, mips are generated on the graphics queue
+	const uint32_t mipLevels = mipBlitSupported ? std::bit_width(std::max(width, height)) : 1;
+	Renderer::Image image = allocateImage(width, height, mipLevels);
+	if (!image.handle)
+	{
+		return image;
+	}
+	stageImageLevel(image, 0, imageData.data(), components, bitsPerChannel);
+
+	const VkImageSubresourceRange range
+	{
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.levelCount = mipLevels,
+		.layerCount = 1
+	};
+	if (mipLevels > 1)
+	{
+		// stays in TRANSFER_DST, the graphics queue blits the rest of the chain after acquiring it
+		uploadEngine.releaseImage(image.handle, range, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT);
+		pendingMipImages.push_back(image);
+	}
+	else
+	{
+		uploadEngine.releaseImage(image.handle, range, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	}
+	return image;
+}
+
+Renderer::Image Application::createImageFromMips(std::span<const unsigned char> mipChain, uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+	Renderer::Image image = allocateImage(width, height, mipLevels);
+	if (!image.handle)
+	{
+		return image;
+	}
+
+	// every level is already baked, no blits needed
+	size_t offset = 0;
+	for (uint32_t level = 0; level < mipLevels; ++level)
+	{
+		const size_t levelSize = static_cast<size_t>(std::max(1u, width >> level)) * std::max(1u, height >> level) * 4;
+		if (offset + levelSize > mipChain.size())
+		{
+			break;
+		}
+		stageImageLevel(image, level, mipChain.data() + offset, 4, 8);
+		offset += levelSize;
+	}
+	uploadEngine.releaseImage(image.handle, VkImageSubresourceRange{ .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = mipLevels, .layerCount = 1 },
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	return image;
+}
+
+void Application::generateMipmaps(VkCommandBuffer commandBuffer)
+{
+	// images are only ready once their upload batch has been submitted
+	if (pendingMipImages.empty() || uploadEngine.hasPendingWork())
+	{
+		return;
+	}
+
+	uint32_t maxLevels = 0;
+	for (const Renderer::Image &image : pendingMipImages)
+	{
+		maxLevels = std::max(maxLevels, image.mipLevels);
+	}
+
+	// walk the chains level by level so every image shares one barrier batch per level
+	std::vector<VkImageMemoryBarrier2> barriers;
+	for (uint32_t level = 1; level < maxLevels; ++level)
+	{
+		barriers.clear();
+		for (const Renderer::Image &image : pendingMipImages)
+		{
+			if (level < image.mipLevels)
+			{
+				barriers.push_back(VkImageMemoryBarrier2
+				{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+					.srcStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT,
+					.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+					.dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT,
+					.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					.image = image.handle,
+					.subresourceRange{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = level - 1, .levelCount = 1, .layerCount = 1 }
+				});
+			}
+		}
+		VkDependencyInfo depInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+			.pImageMemoryBarriers = barriers.data()
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &depInfo);
+
+		for (const Renderer::Image &image : pendingMipImages)
+		{
+			if (level < image.mipLevels)
+			{
+				const int32_t srcWidth = std::max(1u, image.width >> (level - 1));
+				const int32_t srcHeight = std::max(1u, image.height >> (level - 1));
+				VkImageBlit blit
+				{
+					.srcSubresource{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level - 1, .layerCount = 1 },
+					.srcOffsets{ {0, 0, 0}, {srcWidth, srcHeight, 1} },
+					.dstSubresource{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1 },
+					.dstOffsets{ {0, 0, 0}, {std::max(1, srcWidth / 2), std::max(1, srcHeight / 2), 1} }
+				};
+				vkCmdBlitImage(commandBuffer, image.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					image.handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+			}
+		}
+	}
+
+	// whole chain to shader read, the last level was never used as a blit source
+	barriers.clear();
+	for (const Renderer::Image &image : pendingMipImages)
+	{
+		const VkImageMemoryBarrier2 barrier
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			.image = image.handle,
+			.subresourceRange{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = image.mipLevels - 1, .layerCount = 1 }
+		};
+		barriers.push_back(barrier);
+
+		VkImageMemoryBarrier2 lastLevel = barrier;
+		lastLevel.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		lastLevel.subresourceRange.baseMipLevel = image.mipLevels - 1;
+		lastLevel.subresourceRange.levelCount = 1;
+		barriers.push_back(lastLevel);
+	}
+	VkDependencyInfo depInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+		.pImageMemoryBarriers = barriers.data()
+	};
+	vkCmdPipelineBarrier2(commandBuffer, &depInfo);
+	pendingMipImages.clear();
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL Application::debugCallback(
+	VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+	VkDebugUtilsMessageTypeFlagsEXT messageType,
+	const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+	void *pUserData)
+{
+	if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+	{
+		std::cerr << "Validation Layer: " << pCallbackData->pMessage << std::endl;
+	}
+
+	return VK_FALSE;
+}
@@ -1,171 +1,634 @@
-#pragma once
-
-#define VK_NO_PROTOTYPES
-#include <SDL3/SDL_vulkan.h>
-#include <string>
-#include <vulkan/vulkan.h>
-#include <vector>
-#include <array>
-#include <shaderc/shaderc.hpp>
-#include <glm/glm.hpp>
-
-struct SDL_Window;
-struct VmaAllocator_T;
-typedef struct VmaAllocator_T *VmaAllocator;
-struct VmaAllocation_T;
-typedef struct VmaAllocation_T *VmaAllocation;
-
-struct Pipeline
-{
-	VkPipelineLayout layout = nullptr;
-	VkPipeline handle = nullptr;
-};
-
-struct FrameResources
-{
-	uint32_t lastFrameId = 0;
-	VkCommandPool commandPool = nullptr;
-	VkCommandBuffer commandBuffer = nullptr;
-	VkSemaphore imageAcquiredSemaphore = nullptr;
-	VkSemaphore workCompleteSemaphore = nullptr;
-};
-
-namespace Renderer
-{
-	struct Buffer
-	{
-		VkBuffer buffer = nullptr;
-		VmaAllocation allocation = nullptr;
-	};
-
-	struct Image
-	{
-		VkImage handle = nullptr;
-		VkImageView view = nullptr;
-		VmaAllocation allocation = nullptr;
-	};
-
-	struct Vertex
-	{
-		glm::vec3 position;
-		glm::vec2 uv;
-	};
-
-	struct SubMesh
-	{
-		size_t vertexStart = 0;
-		size_t vertexCount = 0;
-		size_t indexStart = 0;
-		size_t indexCount = 0;
-	};
-
-	struct Mesh
-	{
-		std::vector<SubMesh> subMeshes;
-	};
-
-	struct DrawConstants
-	{
-		uint64_t vertexBufferAddress = 0;
-		float globalTime = 0;
-		float padding = 0;
-		glm::mat4 mvp;
-	};
-}
-
-class Application
-{
-	constexpr static uint32_t VulkanVersion{ VK_API_VERSION_1_4 };
-	constexpr static uint32_t MaxFramesInFlight{ 2 };
-	constexpr static VkFormat swapchainFormat{ VK_FORMAT_B8G8R8A8_SRGB };
-	constexpr static VkFormat depthFormat{ VK_FORMAT_D32_SFLOAT };
-
-	uint64_t prevTime = 0;
-	uint64_t nowTime = 0;
-	double globalTime = 0;
-	SDL_Window *window = nullptr;
-	uint32_t width = 1280;
-	uint32_t height = 720;
-	bool running = false;
-	uint64_t frameCounter = 0;
-	uint64_t timelineValue = MaxFramesInFlight - 1; // subtract 1 to ensure wait-for-ID / frame resource index start at 0 during render, avoids if (frameId < MaxFramesInFlight) check
-
-	// vulkan core
-	VkInstance vulkanInstance = nullptr;
-	VkPhysicalDevice physicalDevice = nullptr;
-	VkDevice device = nullptr;
-	VkSurfaceKHR surface = nullptr;
-	VmaAllocator vmaAllocator = nullptr;
-
-	// queue related
-	uint32_t gfxQueueFamIdx = UINT32_MAX;
-	VkQueue gfxQueue = nullptr;
-	VkCommandPool commandPool = nullptr;
-
-	// swapchain related
-	VkSwapchainKHR swapchain = nullptr;
-	std::vector<VkImage> swapchainImages;
-	std::vector<VkImageView> swapchainImageViews;
-	std::vector<VkSemaphore> renderCompleteSemaphores;
-	bool requireSwapchainRecreate = false;
-	uint32_t swapchainWidth = 0;
-	uint32_t swapchainHeight = 0;
-
-	VkImage depthImage = nullptr;
-	VkImageView depthImageView = nullptr;
-	VmaAllocation depthImageAllocation = nullptr;
-
-	// graphics pipeline related
-	Pipeline pipeline;
-
-	// shader resources
-	VkShaderModule vertShader = nullptr;
-	VkShaderModule fragShader = nullptr;
-
-	// frame and synchronization resources
-	VkSemaphore timelineSemaphore = nullptr;
-	std::array<FrameResources, MaxFramesInFlight> frameResources;
-
-	// assets
-	std::vector<Renderer::Mesh> meshes;
-	std::vector<Renderer::Vertex> vertices;
-	std::vector<uint32_t> indices;
-	Renderer::Buffer vertexBuffer;
-	Renderer::Buffer indexBuffer;
-
-	std::vector<Renderer::Image> images;
-
-	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-		VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-		VkDebugUtilsMessageTypeFlagsEXT messageType,
-		const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
-		void *pUserData);
-	void showError(const std::string &errorMessasge) const;
-
-	bool initializeVulkan();
-	bool createVulkanInstance();
-	bool createSurface();
-	VkPhysicalDevice findPhysicalDevice();
-	bool findGraphicsQueue();
-	bool createDevice(VkPhysicalDevice physicalDevice);
-	bool initializeVMA();
-	bool createSwapchain(uint32_t width, uint32_t height);
-	void destroySwapchain();
-	VkShaderModule createShaderModule(const std::string &fileName, shaderc_shader_kind kind) const;
-	bool createShaders();
-	Pipeline createGraphicsPipeline() const;
-	bool createSyncResources();
-	bool createCommandBuffers();
-	void render(float deltaTime);
-
-	void loadModel();
-
-	VkCommandBuffer startTransientCommandBuffer();
-	void submitTransientCommandBuffer(VkCommandBuffer commandBuffer);
-	Renderer::Image createImage(std::vector<unsigned char> imageData, uint32_t width, uint32_t height, int components);
-
-public:
-	bool initialize();
-	void shutdown();
-	void run();
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <SDL3/SDL_vulkan.h>
+#include <string>
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <array>
+#include <span>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <shaderc/shaderc.hpp>
+#include <glm/glm.hpp>
+
+#include "config.h"
+#include "upload.h"
+#include "frame_arena.h"
+#include "gpu_memory.h"
+#include "gpu_profiler.h"
+#include "mesh_cache.h"
+#include "thread_pool.h"
+#include "scene.h"
+#include "texture_streamer.h"
+#include "render_graph.h"
+#include "draw_culler.h"
+
+struct SDL_Window;
+struct VmaAllocator_T;
+typedef struct VmaAllocator_T *VmaAllocator;
+struct VmaAllocation_T;
+typedef struct VmaAllocation_T *VmaAllocation;
+namespace tinygltf { class Model; }
+
+struct Pipeline
+{
+	VkPipelineLayout layout = nullptr;
+	VkPipeline handle = nullptr;
+};
+
+// shader modules and the pipelines built from them, replaced as a whole on hot reload
+struct ShaderPrograms
+{
+	VkShaderModule vertShader = nullptr;
+	VkShaderModule fragShader = nullptr;
+	VkShaderModule taskShader = nullptr;
+	VkShaderModule meshShader = nullptr;
+	VkShaderModule cullShader = nullptr;
+	VkShaderModule depthReduceShader = nullptr;
+	Pipeline pipeline; // layout only with shader objects
+	Pipeline meshletPipeline; // layout only with shader objects
+	Pipeline cullPipeline;
+	Pipeline depthReducePipeline;
+
+	// VK_EXT_shader_object path, unlinked so every stage binds on its own
+	VkShaderEXT vertObject = nullptr;
+	VkShaderEXT fragObject = nullptr;
+	VkShaderEXT taskObject = nullptr;
+	VkShaderEXT meshObject = nullptr;
+};
+
+struct FrameResources
+{
+	uint32_t lastFrameId = 0;
+	VkCommandPool commandPool = nullptr;
+	VkCommandBuffer commandBuffer = nullptr;
+	VkCommandPool computePool = nullptr; // async compute, on the compute family
+	VkCommandBuffer computeCommandBuffer = nullptr;
+	// one pool and secondary buffer per parallel recording job, a job only ever touches its own pool
+	std::vector<VkCommandPool> recordPools;
+	std::vector<VkCommandBuffer> recordCommandBuffers;
+	VkSemaphore imageAcquiredSemaphore = nullptr;
+	VkSemaphore workCompleteSemaphore = nullptr;
+	FrameArena arena; // transient data of this slot's frame, reset once the slot comes around again
+	FrameArena::Allocation cullCounts; // culling statistics copied back by this slot's frame, read once it retired
+};
+
+namespace Renderer
+{
+	struct Buffer
+	{
+		VkBuffer buffer = nullptr;
+		VmaAllocation allocation = nullptr;
+		VkDeviceAddress address = 0; // queried once at creation, 0 without device address usage
+	};
+
+	struct Image
+	{
+		VkImage handle = nullptr;
+		VkImageView view = nullptr;
+		VmaAllocation allocation = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 1;
+	};
+
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec2 uv;
+	};
+
+	// quantized layout selected with VertexFormat::Compact, dequantized in the vertex shader
+	struct CompactVertex
+	{
+		uint16_t position[3]; // unorm16 within the sub-mesh bounds
+		uint16_t padding;
+		uint16_t uv[2]; // half float, uvs may tile outside [0, 1]
+	};
+
+	// simplified index range over the same vertices as the full detail one
+	struct MeshLod
+	{
+		size_t indexStart = 0;
+		size_t indexCount = 0;
+		float error = 0; // furthest the simplification moved the surface, in mesh units
+	};
+
+	struct SubMesh
+	{
+		constexpr static uint32_t MaxLods{ 3 }; // simplified levels besides the full detail one
+
+		size_t vertexStart = 0;
+		size_t vertexCount = 0;
+		size_t indexStart = 0;
+		size_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32; // indexStart points into the 16 or 32 bit index buffer
+		uint32_t meshletStart = 0;
+		uint32_t meshletCount = 0;
+		uint32_t materialIndex = 0; // into the material table, 0 is the default material
+		glm::vec3 boundsMin{ 0 };
+		glm::vec3 boundsMax{ 0 };
+		uint32_t lodCount = 0;
+		std::array<MeshLod, MaxLods> lods{}; // coarser with every level, the index type matches indexStart's
+	};
+
+	// GPU layout of the material table, textures index the bindless texture array
+	struct Material
+	{
+		constexpr static uint32_t NoTexture{ UINT32_MAX };
+
+		glm::vec4 baseColorFactor{ 1.0f };
+		uint32_t baseColorTexture = NoTexture;
+		float alphaCutoff = 0; // fragments below it are discarded, 0 for opaque materials
+		uint32_t padding[2]{};
+	};
+
+	// GPU layout read by the task and mesh shaders
+	struct Meshlet
+	{
+		glm::vec3 center{ 0 };
+		float radius = 0;
+		glm::vec3 coneApex{ 0 };
+		float coneCutoff = 2.0f; // > 1 disables cone culling
+		glm::vec3 coneAxis{ 0 };
+		uint32_t subMeshIndex = 0;
+		uint32_t vertexOffset = 0; // into the meshlet data buffer, entries are global vertex indices
+		uint32_t triangleOffset = 0; // into the meshlet data buffer, one packed uint per triangle
+		uint32_t vertexCount = 0;
+		uint32_t triangleCount = 0;
+	};
+
+	struct Mesh
+	{
+		std::vector<SubMesh> subMeshes;
+	};
+
+	// one sub-mesh instanced by a scene node, shared by every render path, draws pass their index as firstInstance
+	struct DrawData
+	{
+		glm::vec3 boundsMin{ 0 };
+		uint32_t indexCount = 0;
+		glm::vec3 boundsMax{ 0 };
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t indexType = 0; // 0 for 16 bit, 1 for 32 bit indices
+		uint32_t transformIndex = 0; // scene node, indexes the world matrix buffer
+		uint32_t materialIndex = 0;
+		uint32_t lodStart = 0; // into the LOD table, shared by every draw of the sub-mesh
+		uint32_t lodCount = 0;
+	};
+
+	// draws of one sub-mesh at one LOD, recorded as a single instanced draw over a slice of the frame's instance stream
+	struct InstanceBatch
+	{
+		uint32_t indexCount = 0;
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t firstInstance = 0; // into the instance stream
+		uint32_t instanceCount = 0;
+	};
+
+	// GPU layout of the LOD table, drawn instead of the full index range once error projects small enough
+	struct DrawLod
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0;
+	};
+
+	// up to TaskGroupSize meshlets of one draw, culled by a single task workgroup
+	struct TaskGroup
+	{
+		uint32_t drawIndex = 0;
+		uint32_t meshletStart = 0;
+		uint32_t meshletCount = 0;
+	};
+
+	// fixed function state recorded dynamically, so it never multiplies pipelines
+	struct RasterState
+	{
+		VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+		VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+		bool depthTest = true;
+		bool depthWrite = true;
+		VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+	};
+
+	struct DrawConstants
+	{
+		uint64_t vertexBufferAddress = 0;
+		uint64_t drawDataAddress = 0;
+		uint64_t transformAddress = 0;
+		uint64_t materialAddress = 0;
+		uint64_t instanceAddress = 0; // draw index per instance, 0 draws index the draw data with gl_InstanceIndex
+		float globalTime = 0;
+		float padding = 0;
+		glm::mat4 viewProj;
+	};
+
+	// phases of two-phase occlusion culling, matches the defines in cull.comp
+	enum CullFlags : uint32_t
+	{
+		CullEarly = 1, // draws visible last frame, tested against nothing but the frustum
+		CullLate = 2, // every draw against the pyramid of the early depth, records this frame's visibility
+		CullOcclusion = 4,
+	};
+
+	struct CullConstants
+	{
+		uint64_t drawDataAddress = 0;
+		uint64_t transformAddress = 0;
+		uint64_t commandAddress = 0;
+		uint64_t countAddress = 0;
+		uint64_t visibilityAddress = 0; // one uint per draw, 0 without occlusion culling
+		uint64_t lodAddress = 0;
+		glm::mat4 viewProj;
+		uint32_t drawCount = 0;
+		uint32_t commandOffset32 = 0; // 32 bit index commands follow the 16 bit ones
+		uint32_t flags = 0;
+		float lodScale = 0; // 0 always draws full detail
+	};
+
+	// GPU layout of the draw count buffer, indirect counts first and then what the culling pass rejected
+	struct DrawCounts
+	{
+		uint32_t drawn[2][2]{}; // early / late phase, 16 / 32 bit indices
+		uint32_t frustumCulled = 0;
+		uint32_t occluded = 0;
+	};
+
+	struct DepthReduceConstants
+	{
+		glm::vec2 size{ 0 }; // destination level
+		glm::vec2 uvScale{ 1 }; // part of the source that was rendered to
+	};
+
+	// push constants of the task/mesh shader path, past the guaranteed 128 bytes so mesh shading
+	// is only enabled where maxPushConstantsSize fits them
+	struct MeshletConstants
+	{
+		uint64_t vertexBufferAddress = 0;
+		uint64_t meshletAddress = 0;
+		uint64_t meshletDataAddress = 0; // meshlet vertex indices followed by packed triangles
+		uint64_t drawDataAddress = 0;
+		uint64_t transformAddress = 0;
+		uint64_t taskGroupAddress = 0;
+		uint64_t materialAddress = 0;
+		glm::mat4 viewProj;
+		glm::vec3 cameraPosition{ 0 }; // world space, for cone culling
+		uint32_t groupBase = 0;
+	};
+}
+
+class Application
+{
+	constexpr static uint32_t VulkanVersion{ VK_API_VERSION_1_4 };
+	constexpr static uint32_t MaxFramesInFlight{ 3 }; // capacity, framesInFlight is the runtime setting
+	constexpr static VkDeviceSize FrameArenaSize{ 8ull * 1024 * 1024 }; // per frame in flight
+	constexpr static VkFormat swapchainFormat{ VK_FORMAT_B8G8R8A8_SRGB };
+	constexpr static VkFormat depthFormat{ VK_FORMAT_D32_SFLOAT };
+	constexpr static VkFormat textureFormat{ VK_FORMAT_R8G8B8A8_SRGB };
+
+	AppConfig config;
+	uint64_t prevTime = 0; // SDL_GetTicksNS
+	uint64_t nowTime = 0;
+	double globalTime = 0;
+	SDL_Window *window = nullptr;
+	uint32_t width = 1280;
+	uint32_t height = 720;
+	bool running = false;
+	uint64_t frameCounter = 0;
+	uint32_t framesInFlight = 2;
+	uint64_t timelineValue = 1; // starts at framesInFlight - 1 to ensure wait-for-ID / frame resource index start at 0 during render, avoids if (frameId < framesInFlight) check
+
+	// vulkan core
+	VkInstance vulkanInstance = nullptr;
+	VkPhysicalDevice physicalDevice = nullptr;
+	VkDevice device = nullptr;
+	VkSurfaceKHR surface = nullptr;
+	GpuMemory gpuMemory;
+	bool memoryBudgetEnabled = false; // VK_EXT_memory_budget, VMA estimates the budgets from the heap sizes without it
+
+	// queue related
+	uint32_t gfxQueueFamIdx = UINT32_MAX;
+	uint32_t gfxTimestampValidBits = 0;
+	VkQueue gfxQueue = nullptr;
+	uint32_t transferQueueFamIdx = UINT32_MAX;
+	VkQueue transferQueue = nullptr;
+	UploadEngine uploadEngine;
+	uint32_t computeQueueFamIdx = UINT32_MAX; // a family without graphics, UINT32_MAX when there is none
+	uint32_t computeQueueIndex = 0; // 1 when it shares the transfer family, which then gets two queues
+	uint32_t computeTimestampValidBits = 0;
+	VkQueue computeQueue = nullptr;
+	std::vector<uint32_t> sharedQueueFamilies; // every family touching the concurrent culling buffers
+
+	// swapchain related
+	VkSwapchainKHR swapchain = nullptr;
+	std::vector<VkImage> swapchainImages;
+	std::vector<VkImageView> swapchainImageViews;
+	std::vector<VkSemaphore> renderCompleteSemaphores;
+	bool requireSwapchainRecreate = false;
+	uint32_t swapchainWidth = 0;
+	uint32_t swapchainHeight = 0;
+
+	// a retired swapchain and its render-complete semaphores live until the present engine is done with them.
+	// With VK_EXT_swapchain_maintenance1 every present signals a fence for that, without it the queue is
+	// drained when the swapchain is replaced
+	struct PendingPresent
+	{
+		VkFence fence = nullptr;
+		VkSwapchainKHR swapchain = nullptr;
+	};
+	struct RetiredSwapchain
+	{
+		VkSwapchainKHR swapchain = nullptr;
+		std::vector<VkImageView> views;
+		std::vector<VkSemaphore> renderCompleteSemaphores;
+	};
+	bool surfaceMaintenanceEnabled = false; // the instance extensions swapchain maintenance depends on
+	bool presentFencesEnabled = false;
+	std::vector<PendingPresent> pendingPresents;
+	std::vector<VkFence> freePresentFences;
+	std::vector<RetiredSwapchain> retiredSwapchains;
+
+	// benchmark targets that stand in for the swapchain images, one per frame in flight
+	bool offscreenEnabled = false;
+	std::vector<VmaAllocation> offscreenAllocations;
+
+	// benchmark mode, frame times exclude the warmup frames where pipelines and uploads settle
+	constexpr static uint32_t BenchmarkWarmupFrames{ 16 };
+	constexpr static float BenchmarkTimestep{ 1.0f / 60.0f };
+	std::vector<std::pair<std::string, double>> startupPhases; // name, ms
+	std::chrono::steady_clock::time_point phaseStart;
+	uint64_t frameWaitNs = 0; // time the current frame spent blocked on the GPU or the present engine
+
+	// low latency pacing, every present carries its frame ID so the next frame can wait until it is on screen
+	bool presentWaitEnabled = false;
+	uint64_t pendingPresentId = 0; // last present not yet waited on, 0 when none
+	uint64_t pendingInputTime = 0; // SDL_GetTicksNS when that frame sampled its input
+	uint64_t inputSampleTime = 0;
+	double latencyTotalMs = 0;
+	uint32_t latencySamples = 0;
+
+	// depth and the pyramid are transients of the render graph, which aliases their memory
+	RenderGraph renderGraph;
+	RenderGraph::Resource depthTarget = RenderGraph::NoResource;
+	RenderGraph::Resource depthPyramidTarget = RenderGraph::NoResource;
+	VkExtent2D depthExtent{ 0, 0 }; // can exceed the swapchain after a shrink
+
+	// hierarchical depth of the early pass, level 0 is the swapchain rounded down to a power of two
+	// and every texel further down holds the farthest depth of the four beneath it
+	constexpr static VkFormat depthPyramidFormat{ VK_FORMAT_R32_SFLOAT };
+	constexpr static uint32_t MaxDepthPyramidLevels{ 16 };
+	constexpr static uint32_t DepthReduceGroupSize{ 8 }; // matches depth_reduce.comp
+	uint32_t depthPyramidLevels = 0;
+	VkExtent2D depthPyramidExtent{ 0, 0 };
+
+	// shaders and pipelines of every render path
+	ShaderPrograms programs;
+
+	// persisted across runs, hits and misses come from pipeline creation feedback
+	VkPipelineCache pipelineCache = nullptr;
+	mutable std::atomic<uint32_t> pipelineCacheHits{ 0 };
+	mutable std::atomic<uint32_t> pipelineCacheMisses{ 0 };
+
+	// shader hot reload, a watcher thread rebuilds the programs and render() swaps them in between frames
+	std::jthread shaderWatcher;
+	std::mutex reloadMutex;
+	std::optional<ShaderPrograms> reloadedPrograms; // guarded by reloadMutex
+
+	// objects retired while the GPU may still use them, destroyed once the timeline passes their value
+	struct DeferredDeletion
+	{
+		uint64_t timelineValue = 0;
+		std::function<void()> destroy;
+	};
+	std::deque<DeferredDeletion> deletionQueue;
+
+	// VK_EXT_mesh_shader path, enabled in createDevice when supported
+	constexpr static uint32_t TaskGroupSize{ 32 }; // meshlets culled per task workgroup, matches meshlet.task
+	bool meshShadingEnabled = false;
+	uint32_t maxTaskWorkGroupCount = 0;
+
+	// VK_EXT_shader_object path, the graphics stages are shader objects bound independently
+	bool shaderObjectsEnabled = false;
+
+	// per pass GPU timings, secondaries can only run inside the statistics query with inheritedQueries
+	GpuProfiler gpuProfiler;
+	bool inheritedQueriesEnabled = false;
+
+	// GPU-driven path, compute culling into indirect commands drawn with vkCmdDrawIndexedIndirectCount
+	constexpr static uint32_t CullGroupSize{ 64 }; // matches cull.comp
+	bool gpuDrivenEnabled = false;
+
+	// two-phase occlusion culling on the GPU-driven path: draws visible last frame are drawn first, their
+	// depth is reduced into the pyramid, and everything else is tested against it and drawn in a second pass
+	bool occlusionCullingEnabled = false;
+	VkSampler depthReduceSampler = nullptr; // max reduction, a bilinear fetch returns the farthest of four texels
+	VkDescriptorSetLayout depthPyramidSetLayout = nullptr; // pushed, source and destination of a reduction
+	Renderer::DrawCounts lastDrawCounts; // of the newest retired frame
+	uint64_t cullFrames = 0;
+	uint64_t totalDrawn = 0;
+	uint64_t totalFrustumCulled = 0;
+	uint64_t totalOccluded = 0;
+	uint64_t titleUpdateTime = 0; // SDL_GetTicksNS of the last window title refresh
+
+	// async compute: transforms and culling are submitted to the compute queue ahead of the graphics work,
+	// which waits on computeSemaphore for the same frame ID, so they overlap the previous frame's rendering.
+	// Commands and counts get a slot per frame in flight and the visibility one per frame parity, the early
+	// phase then reads what the late phase of two frames back wrote and never waits on the frame before
+	bool asyncComputeEnabled = false;
+	VkSemaphore computeSemaphore = nullptr;
+	uint32_t cullSlotCount = 1;
+	uint32_t cullSlot = 0; // this frame's commands and counts
+	uint32_t visibilitySlot = 0;
+
+	// frame and synchronization resources
+	VkSemaphore timelineSemaphore = nullptr;
+	std::array<FrameResources, MaxFramesInFlight> frameResources;
+
+	// assets
+	std::vector<Renderer::Mesh> meshes;
+	std::vector<Renderer::Vertex> vertices;
+	std::vector<Renderer::CompactVertex> compactVertices;
+	std::vector<uint32_t> indices;
+	std::vector<uint16_t> indices16;
+	Renderer::Buffer vertexBuffer;
+	Renderer::Buffer indexBuffer;
+	Renderer::Buffer indexBuffer16;
+	std::vector<Renderer::Meshlet> meshlets;
+	std::vector<uint32_t> meshletData; // all meshlet vertex indices, then all packed triangles
+	uint32_t meshletCount = 0;
+	Renderer::Buffer meshletBuffer;
+	Renderer::Buffer meshletDataBuffer;
+	std::vector<Renderer::TaskGroup> taskGroups;
+	Renderer::Buffer taskGroupBuffer;
+
+	// scene, every node with a mesh instances all of its sub-meshes
+	Scene scene;
+	std::vector<Renderer::DrawData> draws;
+	Renderer::Buffer transformBuffer;
+	Renderer::Buffer drawDataBuffer;
+	Renderer::Buffer drawCommandBuffer;
+	Renderer::Buffer drawCountBuffer;
+	Renderer::Buffer drawVisibilityBuffer; // written by the late culling pass, read by the next frame's early one
+	std::vector<Renderer::DrawLod> drawLods;
+	Renderer::Buffer drawLodBuffer;
+	float lodScale = 0; // per frame, a LOD is drawn once error * world scale * lodScale fits in its view depth
+	uint32_t drawCount = 0;
+	uint32_t drawCount16 = 0; // 16 bit index draws, their commands come first
+
+	// CPU path instancing: every frame a counting sort buckets the draws by index width, sub-mesh and LOD, each
+	// bucket becomes one instanced draw whose instances find their draw index in the frame's instance stream.
+	// The scratch arrays keep their capacity from one frame to the next, so batching never allocates
+	constexpr static uint32_t MinDrawsPerBatchJob{ 4096 }; // keys of larger scenes are computed across the thread pool
+	bool instancingEnabled = false;
+	std::vector<uint32_t> drawSubMeshes; // per draw, its sub-mesh's rank among all sub-meshes ordered by material
+	uint32_t subMeshCount = 0;
+	std::vector<uint32_t> instanceKeys; // per entry of the draw list, its bucket
+	std::vector<uint32_t> instanceBucketEnds;
+	std::vector<Renderer::InstanceBatch> instanceBatches; // 16 bit index batches first
+	uint32_t instanceBatchCount16 = 0;
+	VkDeviceAddress instanceStreamAddress = 0; // this frame's, 0 when it draws one sub-mesh at a time
+
+	// CPU path frustum culling, only the draws that survive are batched or recorded. Without instancing they are
+	// sorted by index width, material and then front to back, the index buffer being the only state a draw binds
+	bool cpuCullingEnabled = false;
+	DrawCuller drawCuller;
+	std::span<const uint32_t> visibleDraws; // this frame's
+
+	std::vector<Renderer::Image> images;
+
+	// bindless materials, one update-after-bind set holds every texture and is bound once per command buffer,
+	// each draw finds its material through the table and the table's texture index selects the array slot
+	constexpr static uint32_t MaxBindlessTextures{ 4096 };
+	uint32_t bindlessTextureCapacity = 0; // MaxBindlessTextures clamped to the device limits
+	float maxSamplerAnisotropy = 0; // 0 when samplerAnisotropy is unsupported
+	VkSampler textureSampler = nullptr;
+	VkDescriptorSetLayout bindlessSetLayout = nullptr;
+	VkDescriptorPool bindlessPool = nullptr;
+	VkDescriptorSet bindlessSet = nullptr;
+	std::vector<Renderer::Material> materials;
+	Renderer::Buffer materialBuffer;
+
+	// textures loaded from the cache keep only their small mips until the view needs more, every swap puts the new
+	// image in a free slot so frames still in flight keep sampling the old one, and the material table follows
+	constexpr static uint32_t TextureStreamingInterval{ 4 }; // frames between screen-space estimates
+	constexpr static uint32_t MinSpareTextureSlots{ 64 }; // free slots streaming needs beyond one per texture
+	bool textureStreamingEnabled = false; // needs descriptorBindingUpdateUnusedWhilePending
+	MeshCache::Reader modelCache; // open while textures stream out of its mapping
+	TextureStreamer textureStreamer;
+	std::vector<uint32_t> textureSlots; // bindless slot of each texture's current image
+	std::vector<uint32_t> freeTextureSlots;
+	std::vector<uint32_t> materialTextures; // texture each material samples, NoTexture for none
+	bool materialsDirty = false;
+
+	ThreadPool threadPool;
+	constexpr static uint32_t MinDrawsPerRecordJob{ 512 }; // below this a secondary buffer costs more than it saves
+	std::vector<Renderer::Image> pendingMipImages; // uploaded, waiting for mip generation on the graphics queue
+	bool mipBlitSupported = false;
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
+		VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+		VkDebugUtilsMessageTypeFlagsEXT messageType,
+		const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
+		void *pUserData);
+	void showError(const std::string &errorMessasge) const;
+
+	bool initializeVulkan();
+	bool createVulkanInstance();
+	bool createSurface();
+	VkPhysicalDevice findPhysicalDevice();
+	bool findGraphicsQueue();
+	void findTransferQueue();
+	void findComputeQueue();
+	bool createDevice(VkPhysicalDevice physicalDevice);
+	bool initializeVMA();
+	bool createSwapchain(uint32_t width, uint32_t height);
+	bool createOffscreenTargets();
+	void sizeRenderTargets();
+	bool createOcclusionCullingResources();
+	void destroySwapchain();
+	// recycles the fences of finished presents and destroys the retired swapchains none are pending on
+	void retireSwapchains(bool wait);
+	VkFence acquirePresentFence();
+	bool createBindlessResources();
+	bool loadShaderCode(const std::string &fileName, shaderc_shader_kind kind, const std::vector<std::string> &defines, std::vector<uint32_t> &spv) const;
+	VkShaderEXT createShaderObject(const std::string &fileName, shaderc_shader_kind kind, const std::vector<std::string> &defines,
+		VkShaderStageFlagBits stage, VkShaderStageFlags nextStage, const VkPushConstantRange &pushConstants) const;
+	VkShaderModule createShaderModule(const std::string &fileName, shaderc_shader_kind kind, const std::vector<std::string> &defines = {}) const;
+	bool createShaders(ShaderPrograms &programs) const;
+	void createPipelineCache();
+	void savePipelineCache() const;
+	void recordPipelineFeedback(const VkPipelineCreationFeedback &feedback) const;
+	bool createPipelines(ShaderPrograms &programs);
+	void destroyPrograms(const ShaderPrograms &programs) const;
+	void watchShaders(std::stop_token stopToken);
+	void applyShaderReload();
+	void deferDeletion(std::function<void()> destroy);
+	void processDeletions(bool flushAll);
+	void defragmentMemory();
+	VkPipelineLayout createPipelineLayout(VkShaderStageFlags pushConstantStages, uint32_t pushConstantSize, VkDescriptorSetLayout pushDescriptorLayout = nullptr) const;
+	Pipeline createPipeline(std::span<const VkPipelineShaderStageCreateInfo> shaderStages, VkShaderStageFlags pushConstantStages, uint32_t pushConstantSize) const;
+	Pipeline createGraphicsPipeline(VkShaderModule vertShader, VkShaderModule fragShader) const;
+	Pipeline createMeshletPipeline(VkShaderModule taskShader, VkShaderModule meshShader, VkShaderModule fragShader) const;
+	Pipeline createComputePipeline(VkShaderModule shader, uint32_t pushConstantSize, VkDescriptorSetLayout pushDescriptorLayout = nullptr) const;
+	bool createSyncResources();
+	bool createCommandBuffers();
+	void waitForPresent();
+	void endStartupPhase(const char *name);
+	void writeBenchmarkReport(const std::vector<double> &frameMs, const std::vector<double> &busyMs) const;
+	void render(float deltaTime);
+	void bindGraphicsState(VkCommandBuffer commandBuffer, const Renderer::RasterState &state) const;
+	void batchInstances(FrameArena &arena, const glm::mat4 &viewProj);
+	// firstDraw and endDraw index instanceBatches when the frame has an instance stream, otherwise visibleDraws
+	// when culling on the CPU and the draws themselves without
+	uint32_t recordedDrawCount() const;
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw, const glm::mat4 &view, const glm::mat4 &viewProj, uint32_t cullPhase = 0) const;
+	void recordDrawsParallel(FrameResources &res, const VkCommandBufferInheritanceInfo &inheritance, const glm::mat4 &view, const glm::mat4 &viewProj);
+	bool updateTransforms(VkCommandBuffer commandBuffer, FrameArena &arena, bool computeQueue = false);
+	void updateMaterials(VkCommandBuffer commandBuffer, FrameArena &arena);
+	void recordCulling(VkCommandBuffer commandBuffer, const glm::mat4 &viewProj, uint32_t flags);
+	void recordAsyncCompute(FrameResources &res, uint32_t frameResIndex, uint64_t frameId, const glm::mat4 &viewProj);
+	void buildDepthPyramid(VkCommandBuffer commandBuffer);
+	void readCullCounts(FrameResources &res);
+	void reportCulling();
+
+	void loadModel();
+	void uploadGeometry(std::span<const std::byte> vertexData, std::span<const std::byte> indexData, std::span<const std::byte> indexData16);
+	void optimizeGeometry(const std::vector<Renderer::SubMesh *> &subMeshes);
+	void packIndices(const std::vector<Renderer::SubMesh *> &subMeshes);
+	void buildMeshlets(const std::vector<Renderer::SubMesh *> &subMeshes, const std::vector<bool> &doubleSided);
+	void buildLods(const std::vector<Renderer::SubMesh *> &subMeshes);
+	uint32_t selectLod(const Renderer::DrawData &draw, const glm::mat4 &viewProj) const;
+	void buildScene(const tinygltf::Model &model);
+	void buildMaterials(const tinygltf::Model &model);
+	void uploadDrawData();
+	void uploadMaterials();
+	void startTextureStreaming(std::span<const TextureStreamer::Source> sources);
+	void applyTextureLoads();
+	void updateTextureStreaming(const glm::mat4 &viewProj, float pixelScale);
+	size_t textureStreamingBudget() const;
+	void uploadMeshlets(std::span<const std::byte> meshletData, std::span<const std::byte> meshletIndexData);
+	bool loadModelCache(const std::string &cacheFile, uint64_t sourceHash);
+	void bakeModelCache(const std::string &cacheFile, uint64_t sourceHash, const tinygltf::Model &model);
+
+	Renderer::Buffer createDeviceBuffer(VkBufferUsageFlags usage, size_t byteSize, const void *initData,
+		VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, bool computeShared = false);
+	Renderer::Image allocateImage(uint32_t width, uint32_t height, uint32_t mipLevels);
+	void stageImageLevel(const Renderer::Image &image, uint32_t level, const unsigned char *pixels, int components, int bitsPerChannel);
+	Renderer::Image createImage(std::span<const unsigned char> imageData, uint32_t width, uint32_t height, int components, int bitsPerChannel);
+	Renderer::Image createImageFromMips(std::span<const unsigned char> mipChain, uint32_t width, uint32_t height, uint32_t mipLevels);
+	void generateMipmaps(VkCommandBuffer commandBuffer);
+
+public:
+	bool initialize(const AppConfig &config);
+	void shutdown();
+	void run();
 };
\ No newline at end of file
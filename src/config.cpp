@@ -0,0 +1,216 @@
+#include "config.h"
+
+#include <charconv>
+#include <iostream>
+#include <string_view>
+
+static void parseSwitch(std::string_view name, std::string_view value, bool &result)
+{
+	if (value == "on")
+	{
+		result = true;
+	}
+	else if (value == "off")
+	{
+		result = false;
+	}
+	else
+	{
+		std::cerr << "Unknown " << name << " value: " << value << " (expected on or off)" << std::endl;
+	}
+}
+
+static void parseCount(std::string_view name, std::string_view value, uint32_t minValue, uint32_t maxValue, uint32_t &result)
+{
+	uint32_t count = 0;
+	const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), count);
+	if (error == std::errc() && end == value.data() + value.size() && count >= minValue && count <= maxValue)
+	{
+		result = count;
+	}
+	else
+	{
+		std::cerr << "Invalid " << name << " value: " << value << " (expected " << minValue << " to " << maxValue << ")" << std::endl;
+	}
+}
+
+static void parseFloat(std::string_view name, std::string_view value, float minValue, float maxValue, float &result)
+{
+	float number = 0;
+	const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), number);
+	if (error == std::errc() && end == value.data() + value.size() && number >= minValue && number <= maxValue)
+	{
+		result = number;
+	}
+	else
+	{
+		std::cerr << "Invalid " << name << " value: " << value << " (expected " << minValue << " to " << maxValue << ")" << std::endl;
+	}
+}
+
+AppConfig parseCommandLine(int argc, char *argv[])
+{
+	AppConfig config;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		std::string_view value;
+		if (const size_t split = arg.find('='); split != std::string_view::npos)
+		{
+			value = arg.substr(split + 1);
+			arg = arg.substr(0, split);
+		}
+		else if (i + 1 < argc && std::string_view(argv[i + 1]).substr(0, 2) != "--")
+		{
+			value = argv[++i];
+		}
+
+		if (arg == "--scene")
+		{
+			config.scenePath = value;
+		}
+		else if (arg == "--vertex-format")
+		{
+			if (value == "full")
+			{
+				config.vertexFormat = VertexFormat::Full;
+			}
+			else if (value == "compact")
+			{
+				config.vertexFormat = VertexFormat::Compact;
+			}
+			else
+			{
+				std::cerr << "Unknown vertex format: " << value << " (expected full or compact)" << std::endl;
+			}
+		}
+		else if (arg == "--mesh-optimize")
+		{
+			parseSwitch(arg.substr(2), value, config.optimizeMeshes);
+		}
+		else if (arg == "--mesh-lods")
+		{
+			parseSwitch(arg.substr(2), value, config.meshLods);
+		}
+		else if (arg == "--lod-bias")
+		{
+			parseFloat(arg.substr(2), value, 0.0f, 64.0f, config.lodBias);
+		}
+		else if (arg == "--mesh-shading")
+		{
+			parseSwitch(arg.substr(2), value, config.meshShading);
+		}
+		else if (arg == "--gpu-driven")
+		{
+			parseSwitch(arg.substr(2), value, config.gpuDriven);
+		}
+		else if (arg == "--occlusion-culling")
+		{
+			parseSwitch(arg.substr(2), value, config.occlusionCulling);
+		}
+		else if (arg == "--async-compute")
+		{
+			parseSwitch(arg.substr(2), value, config.asyncCompute);
+		}
+		else if (arg == "--shader-objects")
+		{
+			parseSwitch(arg.substr(2), value, config.shaderObjects);
+		}
+		else if (arg == "--parallel-recording")
+		{
+			parseSwitch(arg.substr(2), value, config.parallelRecording);
+		}
+		else if (arg == "--instancing")
+		{
+			parseSwitch(arg.substr(2), value, config.instancing);
+		}
+		else if (arg == "--cpu-culling")
+		{
+			parseSwitch(arg.substr(2), value, config.cpuCulling);
+		}
+		else if (arg == "--frames-in-flight")
+		{
+			parseCount(arg.substr(2), value, 1, 3, config.framesInFlight);
+		}
+		else if (arg == "--present-mode")
+		{
+			if (value == "fifo")
+			{
+				config.presentMode = PresentMode::Fifo;
+			}
+			else if (value == "fifo-relaxed")
+			{
+				config.presentMode = PresentMode::FifoRelaxed;
+			}
+			else if (value == "mailbox")
+			{
+				config.presentMode = PresentMode::Mailbox;
+			}
+			else if (value == "immediate")
+			{
+				config.presentMode = PresentMode::Immediate;
+			}
+			else
+			{
+				std::cerr << "Unknown present mode: " << value << " (expected fifo, fifo-relaxed, mailbox or immediate)" << std::endl;
+			}
+		}
+		else if (arg == "--low-latency")
+		{
+			parseSwitch(arg.substr(2), value, config.lowLatency);
+		}
+		else if (arg == "--gpu-profiler")
+		{
+			parseSwitch(arg.substr(2), value, config.gpuProfiler);
+		}
+		else if (arg == "--pipeline-statistics")
+		{
+			parseSwitch(arg.substr(2), value, config.pipelineStatistics);
+		}
+		else if (arg == "--gpu-profile-dump")
+		{
+			config.gpuProfileDump = value;
+		}
+		else if (arg == "--cpu-trace")
+		{
+			config.cpuTraceFile = value;
+		}
+		else if (arg == "--memory-budget")
+		{
+			parseCount(arg.substr(2), value, 0, 1024 * 1024, config.memoryBudget);
+		}
+		else if (arg == "--texture-streaming")
+		{
+			parseSwitch(arg.substr(2), value, config.textureStreaming);
+		}
+		else if (arg == "--texture-budget")
+		{
+			parseCount(arg.substr(2), value, 0, 1024 * 1024, config.textureBudget);
+		}
+		else if (arg == "--hot-reload")
+		{
+			parseSwitch(arg.substr(2), value, config.hotReload);
+		}
+		else if (arg == "--benchmark")
+		{
+			parseCount(arg.substr(2), value, 1, 1000000, config.benchmarkFrames);
+		}
+		else if (arg == "--benchmark-report")
+		{
+			config.benchmarkReport = value;
+		}
+		else if (arg == "--offscreen")
+		{
+			parseSwitch(arg.substr(2), value, config.offscreen);
+		}
+		else if (arg == "--cull-benchmark")
+		{
+			parseCount(arg.substr(2), value, 1, 100000000, config.cullBenchmark);
+		}
+		else
+		{
+			std::cerr << "Unknown option: " << arg << std::endl;
+		}
+	}
+	return config;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class VertexFormat : uint32_t
+{
+	Full, // vec3 position + vec2 uv, 20 bytes
+	Compact, // unorm16 position relative to the sub-mesh bounds + half uv, 12 bytes
+};
+
+enum class PresentMode : uint32_t
+{
+	Fifo, // vsync, always supported
+	FifoRelaxed, // vsync, but a late frame tears instead of waiting a whole refresh
+	Mailbox, // newest finished frame is shown at vblank, no tearing and no queueing
+	Immediate, // no vsync
+};
+
+// Runtime settings, filled from the command line.
+struct AppConfig
+{
+	std::string scenePath = "D:/glTF-Sample-Models/2.0/FlightHelmet/glTF/FlightHelmet.gltf"; // .gltf or .glb
+	VertexFormat vertexFormat = VertexFormat::Full;
+	bool optimizeMeshes = true; // vertex cache / overdraw / fetch reordering at import
+	bool meshLods = true; // simplified index buffers per sub-mesh at import, picked per draw by projected error
+	float lodBias = 1.0f; // pixels of simplification error a LOD may show, higher trades detail for frame time, 0 keeps full detail
+	bool meshShading = true; // task/mesh shader path with meshlet culling, when the device supports VK_EXT_mesh_shader
+	bool gpuDriven = true; // compute culled indirect draws when mesh shading isn't used
+	bool occlusionCulling = true; // two-phase Hi-Z occlusion culling on the GPU-driven path
+	bool asyncCompute = true; // GPU-driven culling on a dedicated compute queue, overlapping the previous frame's graphics work
+	bool shaderObjects = true; // VK_EXT_shader_object instead of monolithic graphics pipelines, when supported
+	bool parallelRecording = true; // split large CPU draw lists into secondary command buffers across the thread pool
+	bool instancing = true; // CPU draws sharing a sub-mesh and LOD are batched into one instanced draw
+	bool cpuCulling = true; // CPU draws outside the frustum are skipped and the rest sorted by state and depth
+	uint32_t framesInFlight = 2; // 1 to 3
+	PresentMode presentMode = PresentMode::Fifo; // falls back to FIFO when the surface doesn't offer it
+	bool lowLatency = false; // wait for the previous present before sampling input, needs VK_KHR_present_wait
+	bool gpuProfiler = false; // timestamp queries per pass, reported at exit
+	bool pipelineStatistics = false; // vertex / clipping / fragment counts over the frame, implies gpuProfiler
+	std::string gpuProfileDump; // file every resolved GPU scope is written to at exit, .json for a chrome trace, otherwise CSV
+	std::string cpuTraceFile; // chrome trace of the CPU zones written at exit, needs a build with VULKANAPP_TRACE
+	uint32_t memoryBudget = 0; // MB each device local heap is capped at, allocations past it fail, 0 uses what the device reports
+	bool textureStreaming = true; // cached textures start from their small mips and stream detail in as the view needs it
+	uint32_t textureBudget = 0; // MB streamed textures may keep resident, 0 takes what the memory budget leaves
+	bool hotReload = false; // rebuild pipelines in the background when a file in src/shaders changes
+
+	// benchmark mode, a fixed number of frames at a fixed timestep with a JSON report at exit
+	uint32_t benchmarkFrames = 0; // 0 runs interactively
+	std::string benchmarkReport = "benchmark.json";
+	bool offscreen = true; // benchmark renders into offscreen images with a hidden window, nothing is presented
+	uint32_t cullBenchmark = 0; // spheres the CPU culling paths are timed over, then the app exits without a window, 0 runs normally
+};
+
+// accepts "--name value" and "--name=value", unknown options are reported and ignored
+AppConfig parseCommandLine(int argc, char *argv[]);
@@ -0,0 +1,109 @@
+#include "cpu_trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char *name = nullptr;
+		uint64_t beginNs = 0;
+		uint64_t endNs = 0;
+	};
+
+	// written only by its owning thread, head is published with release so the exporter sees whole events
+	struct ThreadRing
+	{
+		uint32_t threadId = 0;
+		std::atomic<const char *> threadName{ nullptr };
+		std::atomic<uint64_t> head{ 0 };
+		std::array<Event, CpuTrace::RingSize> events;
+	};
+
+	// rings outlive their threads so a pool can shut down before the export
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadRing>> registry;
+
+	ThreadRing &threadRing()
+	{
+		thread_local ThreadRing *ring = nullptr;
+		if (!ring)
+		{
+			std::scoped_lock lock(registryMutex);
+			registry.push_back(std::make_unique<ThreadRing>());
+			ring = registry.back().get();
+			ring->threadId = static_cast<uint32_t>(registry.size() - 1);
+		}
+		return *ring;
+	}
+}
+
+uint64_t CpuTrace::now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CpuTrace::setThreadName(const char *name)
+{
+	threadRing().threadName.store(name, std::memory_order_relaxed);
+}
+
+void CpuTrace::record(const char *name, uint64_t beginNs, uint64_t endNs)
+{
+	ThreadRing &ring = threadRing();
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	ring.events[head % RingSize] = Event{ .name = name, .beginNs = beginNs, .endNs = endNs };
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool CpuTrace::writeTrace(const std::string &filePath)
+{
+	std::ofstream out(filePath, std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cerr << "Unable to write CPU trace: " << filePath << std::endl;
+		return false;
+	}
+
+	std::scoped_lock lock(registryMutex);
+	uint64_t origin = UINT64_MAX;
+	for (const std::unique_ptr<ThreadRing> &ring : registry)
+	{
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		for (uint64_t i = head > RingSize ? head - RingSize : 0; i < head; ++i)
+		{
+			origin = std::min(origin, ring->events[i % RingSize].beginNs);
+		}
+	}
+
+	// complete events in microseconds, plus a metadata event naming each thread
+	size_t eventCount = 0;
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+	for (const std::unique_ptr<ThreadRing> &ring : registry)
+	{
+		if (const char *threadName = ring->threadName.load(std::memory_order_relaxed))
+		{
+			out << (eventCount++ ? "," : "") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->threadId
+				<< ",\"args\":{\"name\":\"" << threadName << "\"}}";
+		}
+		const uint64_t head = ring->head.load(std::memory_order_acquire);
+		for (uint64_t i = head > RingSize ? head - RingSize : 0; i < head; ++i)
+		{
+			const Event &event = ring->events[i % RingSize];
+			out << (eventCount++ ? "," : "") << "\n{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << ring->threadId
+				<< ",\"ts\":" << (event.beginNs - origin) / 1000.0 << ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << "}";
+		}
+	}
+	out << "\n]}\n";
+	std::cout << "Wrote " << eventCount << " CPU trace events to " << filePath << std::endl;
+	return out.good();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Scoped CPU zones recorded into a per-thread ring, exported as a chrome trace (chrome://tracing,
+// Perfetto). Recording is wait-free: each thread only ever writes its own ring, and the registry
+// lock is taken once per thread, on its first zone. Without VULKANAPP_TRACE the macros compile to
+// nothing, which is how release builds ship.
+namespace CpuTrace
+{
+	// events kept per thread, the oldest ones are overwritten
+	constexpr uint32_t RingSize = 1u << 15;
+
+	uint64_t now(); // steady clock, ns
+
+	void setThreadName(const char *name);
+	void record(const char *name, uint64_t beginNs, uint64_t endNs);
+
+	// call once the traced threads are idle, a ring being written while it is exported can tear
+	bool writeTrace(const std::string &filePath);
+
+	class Zone
+	{
+		const char *name;
+		uint64_t begin;
+
+	public:
+		explicit Zone(const char *name) : name(name), begin(now()) {}
+		~Zone() { record(name, begin, now()); }
+		Zone(const Zone &) = delete;
+		Zone &operator=(const Zone &) = delete;
+	};
+}
+
+#ifdef VULKANAPP_TRACE
+#define CPU_TRACE_CONCAT_INNER(a, b) a##b
+#define CPU_TRACE_CONCAT(a, b) CPU_TRACE_CONCAT_INNER(a, b)
+// name must be a string literal or otherwise outlive the export
+#define CPU_ZONE(name) CpuTrace::Zone CPU_TRACE_CONCAT(cpuZone, __LINE__){ name }
+#define CPU_THREAD_NAME(name) CpuTrace::setThreadName(name)
+// for spans that don't map onto a C++ scope
+#define CPU_ZONE_BEGIN(id) const uint64_t CPU_TRACE_CONCAT(cpuZoneBegin_, id) = CpuTrace::now()
+#define CPU_ZONE_END(id, name) CpuTrace::record(name, CPU_TRACE_CONCAT(cpuZoneBegin_, id), CpuTrace::now())
+#else
+#define CPU_ZONE(name) ((void)0)
+#define CPU_THREAD_NAME(name) ((void)0)
+#define CPU_ZONE_BEGIN(id) ((void)0)
+#define CPU_ZONE_END(id, name) ((void)0)
+#endif
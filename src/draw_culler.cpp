@@ -0,0 +1,439 @@
+#include "draw_culler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DRAW_CULLER_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define DRAW_CULLER_AVX_TARGET
+#else
+#define DRAW_CULLER_AVX_TARGET __attribute__((target("avx")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DRAW_CULLER_NEON
+#include <arm_neon.h>
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	// every kernel writes the indices of the spheres in [first, end) that pass all six planes to out and returns
+	// how many, first and end are multiples of the kernel's width
+	using CullKernel = uint32_t (*)(const glm::vec4 *planes, const float *x, const float *y, const float *z, const float *r,
+		uint32_t first, uint32_t end, uint32_t *out);
+
+	uint32_t cullScalar(const glm::vec4 *planes, const float *x, const float *y, const float *z, const float *r,
+		uint32_t first, uint32_t end, uint32_t *out)
+	{
+		// branchless, the index is always written and only kept when the sphere passed
+		uint32_t count = 0;
+		for (uint32_t i = first; i < end; ++i)
+		{
+			bool inside = true;
+			for (uint32_t p = 0; p < 6; ++p)
+			{
+				inside = inside & ((planes[p].x * x[i] + planes[p].y * y[i]) + (planes[p].z * z[i] + (planes[p].w + r[i])) >= 0.0f);
+			}
+			out[count] = i;
+			count += inside ? 1 : 0;
+		}
+		return count;
+	}
+
+#if defined(DRAW_CULLER_X86)
+	uint32_t cullSse(const glm::vec4 *planes, const float *x, const float *y, const float *z, const float *r,
+		uint32_t first, uint32_t end, uint32_t *out)
+	{
+		__m128 px[6], py[6], pz[6], pw[6];
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			px[p] = _mm_set1_ps(planes[p].x);
+			py[p] = _mm_set1_ps(planes[p].y);
+			pz[p] = _mm_set1_ps(planes[p].z);
+			pw[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		uint32_t count = 0;
+		for (uint32_t i = first; i < end; i += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(x + i);
+			const __m128 cy = _mm_loadu_ps(y + i);
+			const __m128 cz = _mm_loadu_ps(z + i);
+			const __m128 cr = _mm_loadu_ps(r + i);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (uint32_t p = 0; p < 6; ++p)
+			{
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)),
+					_mm_add_ps(_mm_mul_ps(pz[p], cz), _mm_add_ps(pw[p], cr)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+			}
+			for (uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside)); mask != 0; mask &= mask - 1)
+			{
+				out[count++] = i + std::countr_zero(mask);
+			}
+		}
+		return count;
+	}
+
+	DRAW_CULLER_AVX_TARGET uint32_t cullAvx(const glm::vec4 *planes, const float *x, const float *y, const float *z, const float *r,
+		uint32_t first, uint32_t end, uint32_t *out)
+	{
+		__m256 px[6], py[6], pz[6], pw[6];
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			px[p] = _mm256_set1_ps(planes[p].x);
+			py[p] = _mm256_set1_ps(planes[p].y);
+			pz[p] = _mm256_set1_ps(planes[p].z);
+			pw[p] = _mm256_set1_ps(planes[p].w);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		uint32_t count = 0;
+		for (uint32_t i = first; i < end; i += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(x + i);
+			const __m256 cy = _mm256_loadu_ps(y + i);
+			const __m256 cz = _mm256_loadu_ps(z + i);
+			const __m256 cr = _mm256_loadu_ps(r + i);
+			__m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+			for (uint32_t p = 0; p < 6; ++p)
+			{
+				const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], cx), _mm256_mul_ps(py[p], cy)),
+					_mm256_add_ps(_mm256_mul_ps(pz[p], cz), _mm256_add_ps(pw[p], cr)));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+			}
+			for (uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside)); mask != 0; mask &= mask - 1)
+			{
+				out[count++] = i + std::countr_zero(mask);
+			}
+		}
+		return count;
+	}
+
+	bool cpuSupportsAvx()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		// the CPU has it and the OS saves the upper halves of the registers
+		int info[4]{};
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+#endif
+
+#if defined(DRAW_CULLER_NEON)
+	uint32_t cullNeon(const glm::vec4 *planes, const float *x, const float *y, const float *z, const float *r,
+		uint32_t first, uint32_t end, uint32_t *out)
+	{
+		float32x4_t px[6], py[6], pz[6], pw[6];
+		for (uint32_t p = 0; p < 6; ++p)
+		{
+			px[p] = vdupq_n_f32(planes[p].x);
+			py[p] = vdupq_n_f32(planes[p].y);
+			pz[p] = vdupq_n_f32(planes[p].z);
+			pw[p] = vdupq_n_f32(planes[p].w);
+		}
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		// there is no movemask, a lane's bit is picked and the four are summed instead
+		constexpr uint32_t laneBits[4]{ 1, 2, 4, 8 };
+		const uint32x4_t bits = vld1q_u32(laneBits);
+
+		uint32_t count = 0;
+		for (uint32_t i = first; i < end; i += 4)
+		{
+			const float32x4_t cx = vld1q_f32(x + i);
+			const float32x4_t cy = vld1q_f32(y + i);
+			const float32x4_t cz = vld1q_f32(z + i);
+			const float32x4_t cr = vld1q_f32(r + i);
+			uint32x4_t inside = vdupq_n_u32(~0u);
+			for (uint32_t p = 0; p < 6; ++p)
+			{
+				const float32x4_t distance = vaddq_f32(vaddq_f32(vmulq_f32(px[p], cx), vmulq_f32(py[p], cy)),
+					vaddq_f32(vmulq_f32(pz[p], cz), vaddq_f32(pw[p], cr)));
+				inside = vandq_u32(inside, vcgeq_f32(distance, zero));
+			}
+			for (uint32_t mask = vaddvq_u32(vandq_u32(inside, bits)); mask != 0; mask &= mask - 1)
+			{
+				out[count++] = i + std::countr_zero(mask);
+			}
+		}
+		return count;
+	}
+#endif
+
+	CullKernel kernelFor(DrawCuller::Path path)
+	{
+		switch (path)
+		{
+#if defined(DRAW_CULLER_X86)
+		case DrawCuller::Path::Sse:
+			return cullSse;
+		case DrawCuller::Path::Avx:
+			return cullAvx;
+#endif
+#if defined(DRAW_CULLER_NEON)
+		case DrawCuller::Path::Neon:
+			return cullNeon;
+#endif
+		default:
+			return cullScalar;
+		}
+	}
+
+	// every path this build and CPU can run, scalar first
+	std::vector<DrawCuller::Path> availablePaths()
+	{
+		std::vector<DrawCuller::Path> paths{ DrawCuller::Path::Scalar };
+#if defined(DRAW_CULLER_X86)
+		paths.push_back(DrawCuller::Path::Sse);
+		if (cpuSupportsAvx())
+		{
+			paths.push_back(DrawCuller::Path::Avx);
+		}
+#endif
+#if defined(DRAW_CULLER_NEON)
+		paths.push_back(DrawCuller::Path::Neon);
+#endif
+		return paths;
+	}
+}
+
+DrawCuller::Path DrawCuller::bestPath()
+{
+	return availablePaths().back();
+}
+
+const char *DrawCuller::pathName(Path path)
+{
+	switch (path)
+	{
+	case Path::Sse:
+		return "SSE";
+	case Path::Avx:
+		return "AVX";
+	case Path::Neon:
+		return "NEON";
+	default:
+		return "scalar";
+	}
+}
+
+DrawCuller::Planes DrawCuller::frustumPlanes(const glm::mat4 &viewProj)
+{
+	// mirrors culling.glsl, the rows of the matrix, normalized so the radius can be added as it is
+	const glm::mat4 m = glm::transpose(viewProj);
+	Planes planes{ m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2] }; // depth is [0, 1]
+	for (glm::vec4 &plane : planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return planes;
+}
+
+void DrawCuller::initialize(std::span<const Draw> newDraws, std::span<const glm::mat4> worlds)
+{
+	path = bestPath();
+	draws.assign(newDraws.begin(), newDraws.end());
+
+	// the padding has no size at all, so it fails every plane and the kernels never need a tail loop
+	const uint32_t padded = (size() + Width - 1) / Width * Width;
+	centerX.assign(padded, 0.0f);
+	centerY.assign(padded, 0.0f);
+	centerZ.assign(padded, 0.0f);
+	radii.assign(padded, -1e30f);
+	visible.resize(padded);
+	chunkCounts.resize((padded + ChunkSize - 1) / ChunkSize);
+	sortItems.resize(size());
+	sortScratch.resize(size());
+	updateRange(worlds, 0, size());
+}
+
+void DrawCuller::updateRange(std::span<const glm::mat4> worlds, uint32_t first, uint32_t end)
+{
+	// the radius grows with the largest axis scale, as selectLod measures it
+	for (uint32_t i = first; i < end; ++i)
+	{
+		const Draw &draw = draws[i];
+		const glm::mat4 &world = worlds[draw.transformIndex];
+		const float scale = std::sqrt(std::max({ glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+			glm::dot(glm::vec3(world[1]), glm::vec3(world[1])), glm::dot(glm::vec3(world[2]), glm::vec3(world[2])) }));
+		const glm::vec3 center = glm::vec3(world * glm::vec4(draw.center, 1.0f));
+		centerX[i] = center.x;
+		centerY[i] = center.y;
+		centerZ[i] = center.z;
+		radii[i] = draw.radius * scale;
+	}
+}
+
+void DrawCuller::updateWorlds(std::span<const glm::mat4> worlds, uint32_t nodeBegin, uint32_t nodeEnd)
+{
+	// draws are in node order, so the changed nodes' draws are one range
+	auto byNode = [](const Draw &draw, uint32_t node) { return draw.transformIndex < node; };
+	const auto first = std::lower_bound(draws.begin(), draws.end(), nodeBegin, byNode);
+	const auto end = std::lower_bound(first, draws.end(), nodeEnd, byNode);
+	updateRange(worlds, static_cast<uint32_t>(first - draws.begin()), static_cast<uint32_t>(end - draws.begin()));
+}
+
+uint32_t DrawCuller::cullRange(Path kernelPath, const Planes &planes, uint32_t first, uint32_t end, uint32_t *out) const
+{
+	return kernelFor(kernelPath)(planes.data(), centerX.data(), centerY.data(), centerZ.data(), radii.data(), first, end, out);
+}
+
+std::span<const uint32_t> DrawCuller::cull(const glm::mat4 &viewProj, ThreadPool *threadPool, bool sorted)
+{
+	if (draws.empty())
+	{
+		return {};
+	}
+	const Planes planes = frustumPlanes(viewProj);
+	const uint32_t padded = static_cast<uint32_t>(radii.size());
+	const uint32_t chunkCount = static_cast<uint32_t>(chunkCounts.size());
+	auto cullChunk = [&](size_t chunk)
+	{
+		const uint32_t first = static_cast<uint32_t>(chunk) * ChunkSize;
+		chunkCounts[chunk] = cullRange(path, planes, first, std::min(padded, first + ChunkSize), visible.data() + first);
+	};
+	if (threadPool && chunkCount > 1)
+	{
+		threadPool->parallelFor(chunkCount, cullChunk);
+	}
+	else
+	{
+		for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+		{
+			cullChunk(chunk);
+		}
+	}
+
+	// each chunk's survivors move down behind the previous chunks', never onto ones still to be moved
+	uint32_t visibleCount = chunkCounts[0];
+	for (uint32_t chunk = 1; chunk < chunkCount; ++chunk)
+	{
+		const uint32_t *first = visible.data() + chunk * ChunkSize;
+		std::copy(first, first + chunkCounts[chunk], visible.data() + visibleCount);
+		visibleCount += chunkCounts[chunk];
+	}
+
+	const std::span<uint32_t> list(visible.data(), visibleCount);
+	if (sorted)
+	{
+		sortVisible(list, viewProj);
+	}
+	return list;
+}
+
+void DrawCuller::sortVisible(std::span<uint32_t> list, const glm::mat4 &viewProj)
+{
+	// a non-negative float orders like its bits, the upper 16 are plenty to draw front to back
+	const glm::vec4 depthRow(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+	const size_t count = list.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const uint32_t drawIndex = list[i];
+		const float depth = std::max(0.0f, depthRow.x * centerX[drawIndex] + depthRow.y * centerY[drawIndex] + depthRow.z * centerZ[drawIndex] + depthRow.w);
+		const uint32_t key = (draws[drawIndex].stateKey << 16) | (std::bit_cast<uint32_t>(depth) >> 16);
+		sortItems[i] = static_cast<uint64_t>(key) << 32 | drawIndex;
+	}
+
+	// LSD radix sort over the key's bytes, a byte every item shares is skipped
+	uint64_t *source = sortItems.data();
+	uint64_t *destination = sortScratch.data();
+	for (uint32_t shift = 32; shift < 64; shift += 8)
+	{
+		std::array<uint32_t, 256> offsets{};
+		for (size_t i = 0; i < count; ++i)
+		{
+			++offsets[(source[i] >> shift) & 0xff];
+		}
+		if (std::ranges::find(offsets, static_cast<uint32_t>(count)) != offsets.end())
+		{
+			continue;
+		}
+		uint32_t offset = 0;
+		for (uint32_t &bucket : offsets)
+		{
+			offset += std::exchange(bucket, offset);
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			destination[offsets[(source[i] >> shift) & 0xff]++] = source[i];
+		}
+		std::swap(source, destination);
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		list[i] = static_cast<uint32_t>(source[i]);
+	}
+}
+
+void DrawCuller::runBenchmark(uint32_t count)
+{
+	// spheres scattered around a camera looking down -z, about one in twenty ends up inside
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+	std::vector<Draw> benchmarkDraws(count);
+	for (Draw &draw : benchmarkDraws)
+	{
+		draw = Draw
+		{
+			.center = glm::vec3(position(random), position(random), position(random)),
+			.radius = radius(random),
+			.stateKey = static_cast<uint32_t>(random() & 0xff)
+		};
+	}
+	const glm::mat4 world(1.0f);
+	DrawCuller culler;
+	culler.initialize(benchmarkDraws, std::span(&world, 1));
+	const glm::mat4 viewProj = glm::perspectiveRH_ZO(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const Planes planes = frustumPlanes(viewProj);
+	const uint32_t padded = static_cast<uint32_t>(culler.radii.size());
+
+	// a warmup run, then as many as fit in a quarter of a second
+	constexpr double MinSeconds = 0.25;
+	auto measure = [&](auto &&run)
+	{
+		run();
+		uint32_t runs = 0;
+		double seconds = 0;
+		const auto start = std::chrono::steady_clock::now();
+		do
+		{
+			run();
+			++runs;
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		} while (seconds < MinSeconds);
+		return static_cast<double>(count) * runs / seconds;
+	};
+
+	std::cout << "Culling benchmark: " << count << " spheres, single threaded" << std::endl;
+	double scalarRate = 0;
+	for (const Path candidate : availablePaths())
+	{
+		uint32_t visibleCount = 0;
+		const double rate = measure([&] { visibleCount = culler.cullRange(candidate, planes, 0, padded, culler.visible.data()); });
+		scalarRate = candidate == Path::Scalar ? rate : scalarRate;
+		std::cout << "  " << pathName(candidate) << ": " << rate / 1e6 << " M spheres/s, " << rate / scalarRate << "x scalar, "
+			<< visibleCount << " visible" << std::endl;
+	}
+	// culling plus the sort as a frame does it, without the thread pool
+	size_t sortedCount = 0;
+	const double rate = measure([&] { sortedCount = culler.cull(viewProj, nullptr, true).size(); });
+	std::cout << "  " << pathName(culler.path) << " and sorted: " << rate / 1e6 << " M spheres/s, " << sortedCount << " visible" << std::endl;
+}
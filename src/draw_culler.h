@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// Frustum culling for the CPU draw path. World space bounding spheres are kept as separate x, y, z and radius
+// arrays, so one register tests 4 draws against a plane with SSE or NEON and 8 with AVX, whichever the CPU
+// runs. A sphere is only recomputed when its node's world matrix changed. Large scenes are culled in chunks
+// across the thread pool, and the survivors can be radix sorted by their state key ahead of view depth. All
+// the arrays are sized along with the draws, culling a frame never allocates.
+class DrawCuller
+{
+public:
+	enum class Path : uint32_t
+	{
+		Scalar,
+		Sse, // 4 wide, every x86-64 CPU
+		Avx, // 8 wide, when the CPU and OS support it
+		Neon, // 4 wide, every AArch64 CPU
+	};
+
+	struct Draw
+	{
+		glm::vec3 center{ 0 }; // bounding sphere in its node's space
+		float radius = 0;
+		uint32_t transformIndex = 0; // never decreases from one draw to the next
+		uint32_t stateKey = 0; // 16 bits, sorted on ahead of depth
+	};
+
+	using Planes = std::array<glm::vec4, 6>;
+
+private:
+	constexpr static uint32_t Width{ 8 }; // of the widest path, the sphere arrays are padded to it
+	constexpr static uint32_t ChunkSize{ 4096 }; // draws per job, a multiple of Width
+
+	std::vector<Draw> draws;
+	std::vector<float> centerX, centerY, centerZ, radii; // world space, padding never passes a plane
+	std::vector<uint32_t> visible; // every chunk first compacts its survivors at its own start
+	std::vector<uint32_t> chunkCounts;
+	std::vector<uint64_t> sortItems; // key in the upper half, draw index in the lower
+	std::vector<uint64_t> sortScratch;
+	Path path = Path::Scalar;
+
+	void updateRange(std::span<const glm::mat4> worlds, uint32_t first, uint32_t end);
+	uint32_t cullRange(Path path, const Planes &planes, uint32_t first, uint32_t end, uint32_t *out) const;
+	void sortVisible(std::span<uint32_t> list, const glm::mat4 &viewProj);
+
+public:
+	static Path bestPath();
+	static const char *pathName(Path path);
+	// normalized, a sphere is inside when dot(plane.xyz, center) + plane.w + radius >= 0 for all six
+	static Planes frustumPlanes(const glm::mat4 &viewProj);
+	// single threaded throughput of every path this CPU runs over count random spheres, printed
+	static void runBenchmark(uint32_t count);
+
+	void initialize(std::span<const Draw> draws, std::span<const glm::mat4> worlds);
+	// recomputes the spheres of the draws of nodes [nodeBegin, nodeEnd)
+	void updateWorlds(std::span<const glm::mat4> worlds, uint32_t nodeBegin, uint32_t nodeEnd);
+	// indices of the draws inside the frustum, valid until the next call. Sorted by state key and then front
+	// to back unless sorted is false, in draw order otherwise. threadPool may be null
+	std::span<const uint32_t> cull(const glm::mat4 &viewProj, ThreadPool *threadPool, bool sorted = true);
+
+	Path activePath() const { return path; }
+	uint32_t size() const { return static_cast<uint32_t>(draws.size()); }
+};
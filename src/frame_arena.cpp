@@ -0,0 +1,105 @@
+#include "frame_arena.h"
+#include "gpu_memory.h"
+
+#include <Volk/volk.h>
+#include <vma/vk_mem_alloc.h>
+#include <algorithm>
+#include <iostream>
+
+bool FrameArena::initialize(VkDevice device, GpuMemory &memory, VkDeviceSize capacity, std::span<const uint32_t> queueFamilies)
+{
+	this->device = device;
+	this->memory = &memory;
+	allocator = memory.handle();
+	this->capacity = capacity;
+
+	// usable as a shader buffer, a copy source or destination and an indirect argument buffer, whatever a frame needs to pass on
+	VkBufferCreateInfo bufferInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = capacity,
+		.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+		.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = queueFamilies.size() > 1 ? static_cast<uint32_t>(queueFamilies.size()) : 0,
+		.pQueueFamilyIndices = queueFamilies.size() > 1 ? queueFamilies.data() : nullptr
+	};
+	// ReBAR / unified memory when there is some, plain host memory read over the bus otherwise
+	VmaAllocationCreateInfo allocInfo
+	{
+		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+		.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+		.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+		.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+	};
+	VmaAllocationInfo allocResult{};
+	if (!memory.createBuffer(GpuMemory::Staging, bufferInfo, allocInfo, buffer, allocation, &allocResult))
+	{
+		std::cerr << "Unable to allocate a frame arena of " << capacity << " bytes" << std::endl;
+		return false;
+	}
+	mappedData = static_cast<unsigned char *>(allocResult.pMappedData);
+
+	VkMemoryPropertyFlags memoryFlags = 0;
+	vmaGetAllocationMemoryProperties(allocator, allocation, &memoryFlags);
+	deviceLocal = (memoryFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+
+	VkBufferDeviceAddressInfo addressInfo{ .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO, .buffer = buffer };
+	baseAddress = vkGetBufferDeviceAddress(device, &addressInfo);
+	return true;
+}
+
+void FrameArena::shutdown()
+{
+	if (buffer)
+	{
+		memory->destroyBuffer(buffer, allocation);
+	}
+	buffer = nullptr;
+	allocation = nullptr;
+	mappedData = nullptr;
+	baseAddress = 0;
+	head = 0;
+}
+
+void FrameArena::reset()
+{
+	peak = std::max(peak, head);
+	head = 0;
+}
+
+void FrameArena::flush() const
+{
+	// no-op on coherent memory
+	if (head > 0)
+	{
+		vmaFlushAllocation(allocator, allocation, 0, head);
+	}
+}
+
+void FrameArena::invalidate(const Allocation &range, VkDeviceSize size) const
+{
+	// no-op on coherent memory, reads are uncached with sequential write memory so keep them small
+	if (range.data)
+	{
+		vmaInvalidateAllocation(allocator, allocation, range.offset, size);
+	}
+}
+
+FrameArena::Allocation FrameArena::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	// alignment must be a power of two
+	const VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+	if (!mappedData || size == 0 || offset + size > capacity)
+	{
+		return Allocation{};
+	}
+	head = offset + size;
+	return Allocation
+	{
+		.buffer = buffer,
+		.offset = offset,
+		.address = baseAddress + offset,
+		.data = mappedData + offset
+	};
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <cstring>
+#include <span>
+
+class GpuMemory;
+struct VmaAllocator_T;
+typedef struct VmaAllocator_T *VmaAllocator;
+struct VmaAllocation_T;
+typedef struct VmaAllocation_T *VmaAllocation;
+
+// Bump allocator over one persistently mapped buffer, for data that only lives for a single frame.
+// Each frame slot owns an arena and resets it once the slot's previous frame has retired on the
+// timeline, so nothing is ever freed individually. The buffer prefers host visible device local
+// memory and its device address is queried once, sub-allocations hand out both a pointer and an
+// address. Not thread safe, allocate from the thread recording the frame.
+class FrameArena
+{
+	VkDevice device = nullptr;
+	GpuMemory *memory = nullptr;
+	VmaAllocator allocator = nullptr;
+	VkBuffer buffer = nullptr;
+	VmaAllocation allocation = nullptr;
+	unsigned char *mappedData = nullptr;
+	VkDeviceAddress baseAddress = 0;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize head = 0;
+	VkDeviceSize peak = 0;
+	bool deviceLocal = false;
+
+public:
+	struct Allocation
+	{
+		VkBuffer buffer = nullptr;
+		VkDeviceSize offset = 0;
+		VkDeviceAddress address = 0;
+		void *data = nullptr; // null when the arena is full
+	};
+
+	// more than one queue family shares the buffer concurrently, so other queues can read what a frame wrote
+	bool initialize(VkDevice device, GpuMemory &memory, VkDeviceSize capacity, std::span<const uint32_t> queueFamilies = {});
+	void shutdown();
+
+	// only once the GPU is done with everything handed out since the last reset
+	void reset();
+	// makes the host writes visible, call before submitting the frame
+	void flush() const;
+	// makes GPU writes into an allocation visible to the host, once the frame that wrote them retired
+	void invalidate(const Allocation &range, VkDeviceSize size) const;
+
+	Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+	template<typename T>
+	Allocation write(std::span<const T> items, VkDeviceSize alignment = alignof(T))
+	{
+		const Allocation result = allocate(items.size_bytes(), alignment);
+		if (result.data)
+		{
+			std::memcpy(result.data, items.data(), items.size_bytes());
+		}
+		return result;
+	}
+
+	VkBuffer handle() const { return buffer; }
+	VkDeviceSize used() const { return head; }
+	VkDeviceSize peakUsage() const { return peak; } // highest use of any single frame
+	bool isDeviceLocal() const { return deviceLocal; }
+};
@@ -0,0 +1,451 @@
+#include "gpu_memory.h"
+
+#include <Volk/volk.h>
+#include <vma/vk_mem_alloc.h>
+#include <algorithm>
+#include <iostream>
+#include <span>
+
+static double megabytes(VkDeviceSize bytes)
+{
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+bool GpuMemory::initialize(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t apiVersion,
+	bool budgetExtension, VkDeviceSize budgetLimit)
+{
+	this->device = device;
+	this->budgetExtension = budgetExtension;
+	hardBudget = budgetLimit > 0;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	// every device local heap is capped, on unified memory that is the one heap everything shares
+	heapLimits.assign(memoryProperties.memoryHeapCount, VK_WHOLE_SIZE);
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+	{
+		const VkMemoryHeap &heap = memoryProperties.memoryHeaps[i];
+		if (hardBudget && (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && budgetLimit < heap.size)
+		{
+			heapLimits[i] = budgetLimit;
+		}
+	}
+
+	VmaAllocatorCreateFlags flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+	if (budgetExtension)
+	{
+		flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+	}
+	VmaVulkanFunctions vmaFuncInfo{};
+	VmaAllocatorCreateInfo vmaAllocInfo
+	{
+		.flags = flags,
+		.physicalDevice = physicalDevice,
+		.device = device,
+		.pHeapSizeLimit = heapLimits.data(),
+		.pVulkanFunctions = &vmaFuncInfo,
+		.instance = instance,
+		.vulkanApiVersion = apiVersion
+	};
+
+	// vma can import directly from volk
+	vmaImportVulkanFunctionsFromVolk(&vmaAllocInfo, &vmaFuncInfo);
+
+	if (vmaCreateAllocator(&vmaAllocInfo, &allocator) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to create the VMA allocator" << std::endl;
+		return false;
+	}
+	if (!budgetExtension)
+	{
+		std::cerr << "VK_EXT_memory_budget isn't supported, budgets are estimated from the heap sizes" << std::endl;
+	}
+	if (hardBudget)
+	{
+		std::cout << "GPU memory budget: " << megabytes(budgetLimit) << " MB per device local heap" << std::endl;
+	}
+	return true;
+}
+
+void GpuMemory::shutdown()
+{
+	if (allocator)
+	{
+		vmaDestroyAllocator(allocator);
+	}
+	allocator = nullptr;
+}
+
+GpuMemory::Record *GpuMemory::track(Category category, VmaAllocation allocation)
+{
+	VmaAllocationInfo info{};
+	vmaGetAllocationInfo(allocator, allocation, &info);
+	Record *record = new Record{ .category = category, .size = info.size };
+	vmaSetAllocationUserData(allocator, allocation, record);
+
+	const VkDeviceSize total = categoryBytes[category].fetch_add(info.size, std::memory_order_relaxed) + info.size;
+	VkDeviceSize peak = categoryPeaks[category].load(std::memory_order_relaxed);
+	while (peak < total && !categoryPeaks[category].compare_exchange_weak(peak, total, std::memory_order_relaxed))
+	{
+	}
+	return record;
+}
+
+void GpuMemory::untrack(VmaAllocation allocation)
+{
+	VmaAllocationInfo info{};
+	vmaGetAllocationInfo(allocator, allocation, &info);
+	if (const Record *record = static_cast<const Record *>(info.pUserData))
+	{
+		categoryBytes[record->category].fetch_sub(record->size, std::memory_order_relaxed);
+		delete record;
+	}
+}
+
+void GpuMemory::reportFailure(Category category, VkDeviceSize size) const
+{
+	// which heap the allocation was meant for isn't known here, so every device local one is listed
+	std::cerr << "Out of GPU memory for " << categoryName(category) << ", " << megabytes(size) << " MB requested";
+	const std::vector<HeapStats> heaps = heapStats();
+	for (size_t i = 0; i < heaps.size(); ++i)
+	{
+		if (heaps[i].deviceLocal)
+		{
+			std::cerr << ", heap " << i << " at " << megabytes(heaps[i].usage) << " of " << megabytes(heaps[i].budget) << " MB";
+		}
+	}
+	std::cerr << std::endl;
+}
+
+bool GpuMemory::createBuffer(Category category, const VkBufferCreateInfo &bufferInfo, const VmaAllocationCreateInfo &allocInfo,
+	VkBuffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocResult)
+{
+	// geometry can always be copied, which is what lets defragmentation move it
+	VkBufferCreateInfo createInfo = bufferInfo;
+	if (category == Geometry)
+	{
+		createInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	}
+	VmaAllocationCreateInfo budgetedInfo = allocInfo;
+	if (hardBudget)
+	{
+		budgetedInfo.flags |= VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+	}
+
+	if (vmaCreateBuffer(allocator, &createInfo, &budgetedInfo, &buffer, &allocation, allocResult) != VK_SUCCESS)
+	{
+		reportFailure(category, bufferInfo.size);
+		buffer = nullptr;
+		allocation = nullptr;
+		return false;
+	}
+	Record *record = track(category, allocation);
+	record->buffer = buffer;
+	record->bufferSize = createInfo.size;
+	record->bufferUsage = createInfo.usage;
+	record->concurrent = createInfo.sharingMode == VK_SHARING_MODE_CONCURRENT;
+	return true;
+}
+
+bool GpuMemory::createImage(Category category, const VkImageCreateInfo &imageInfo, const VmaAllocationCreateInfo &allocInfo,
+	VkImage &image, VmaAllocation &allocation)
+{
+	VmaAllocationCreateInfo budgetedInfo = allocInfo;
+	if (hardBudget)
+	{
+		budgetedInfo.flags |= VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+	}
+
+	if (vmaCreateImage(allocator, &imageInfo, &budgetedInfo, &image, &allocation, nullptr) != VK_SUCCESS)
+	{
+		// the exact size isn't known before the image exists, texels at 4 bytes are close enough for the report
+		reportFailure(category, static_cast<VkDeviceSize>(imageInfo.extent.width) * imageInfo.extent.height * 4);
+		image = nullptr;
+		allocation = nullptr;
+		return false;
+	}
+	track(category, allocation);
+	return true;
+}
+
+bool GpuMemory::allocateMemory(Category category, const VkMemoryRequirements &requirements, const VmaAllocationCreateInfo &allocInfo,
+	VmaAllocation &allocation)
+{
+	VmaAllocationCreateInfo budgetedInfo = allocInfo;
+	if (hardBudget)
+	{
+		budgetedInfo.flags |= VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+	}
+
+	if (vmaAllocateMemory(allocator, &requirements, &budgetedInfo, &allocation, nullptr) != VK_SUCCESS)
+	{
+		reportFailure(category, requirements.size);
+		allocation = nullptr;
+		return false;
+	}
+	track(category, allocation);
+	return true;
+}
+
+void GpuMemory::destroyBuffer(VkBuffer buffer, VmaAllocation allocation)
+{
+	if (allocation)
+	{
+		untrack(allocation);
+	}
+	if (buffer || allocation)
+	{
+		vmaDestroyBuffer(allocator, buffer, allocation);
+	}
+}
+
+void GpuMemory::destroyImage(VkImage image, VmaAllocation allocation)
+{
+	if (allocation)
+	{
+		untrack(allocation);
+	}
+	if (image || allocation)
+	{
+		vmaDestroyImage(allocator, image, allocation);
+	}
+}
+
+void GpuMemory::freeMemory(VmaAllocation allocation)
+{
+	if (allocation)
+	{
+		untrack(allocation);
+		vmaFreeMemory(allocator, allocation);
+	}
+}
+
+void GpuMemory::beginFrame(uint64_t frameId)
+{
+	vmaSetCurrentFrameIndex(allocator, static_cast<uint32_t>(frameId));
+
+	// reported when usage crosses the budget and once it's back under, not on every frame in between
+	std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+	vmaGetHeapBudgets(allocator, budgets.data());
+	bool over = false;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+	{
+		over |= (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && budgets[i].usage > budgets[i].budget;
+	}
+	if (over != overBudget)
+	{
+		overBudget = over;
+		if (over)
+		{
+			std::cerr << "GPU memory over budget, the driver may start evicting resources" << std::endl;
+			printStats("over budget");
+		}
+		else
+		{
+			std::cout << "GPU memory back within budget" << std::endl;
+		}
+	}
+}
+
+std::vector<GpuMemory::HeapStats> GpuMemory::heapStats() const
+{
+	std::vector<VmaBudget> budgets(memoryProperties.memoryHeapCount);
+	vmaGetHeapBudgets(allocator, budgets.data());
+
+	std::vector<HeapStats> heaps(memoryProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+	{
+		heaps[i] = HeapStats
+		{
+			.deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+			.size = std::min(memoryProperties.memoryHeaps[i].size, heapLimits[i]),
+			.usage = budgets[i].usage,
+			.budget = budgets[i].budget,
+			.allocationBytes = budgets[i].statistics.allocationBytes,
+			.blockBytes = budgets[i].statistics.blockBytes
+		};
+	}
+	return heaps;
+}
+
+const char *GpuMemory::categoryName(Category category)
+{
+	switch (category)
+	{
+	case Geometry: return "geometry";
+	case Textures: return "textures";
+	case RenderTargets: return "render targets";
+	case Staging: return "staging";
+	default: return "unknown";
+	}
+}
+
+void GpuMemory::printStats(const char *when) const
+{
+	std::cout << "GPU memory " << when << ":";
+	for (uint32_t category = 0; category < CategoryCount; ++category)
+	{
+		std::cout << (category > 0 ? ", " : " ") << categoryName(static_cast<Category>(category)) << " "
+			<< megabytes(usage(static_cast<Category>(category))) << " MB";
+	}
+	const std::vector<HeapStats> heaps = heapStats();
+	for (size_t i = 0; i < heaps.size(); ++i)
+	{
+		if (heaps[i].deviceLocal)
+		{
+			std::cout << "; heap " << i << " " << megabytes(heaps[i].usage) << " of " << megabytes(heaps[i].budget) << " MB budget ("
+				<< megabytes(heaps[i].blockBytes - heaps[i].allocationBytes) << " MB unused in VMA blocks)";
+		}
+	}
+	std::cout << std::endl;
+}
+
+void GpuMemory::defragment(VkQueue queue, uint32_t queueFamIdx, const std::function<bool(VkBuffer)> &canMove,
+	const std::function<void(VkBuffer oldBuffer, VkBuffer newBuffer)> &moved, const std::function<void(VkCommandBuffer)> &prologue)
+{
+	VkCommandPoolCreateInfo poolInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = queueFamIdx
+	};
+	VkCommandPool commandPool = nullptr;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to create the defragmentation command pool, skipped" << std::endl;
+		return;
+	}
+	VkCommandBufferAllocateInfo cmdAllocInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = commandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1
+	};
+	VkCommandBuffer commandBuffer = nullptr;
+	VkFenceCreateInfo fenceInfo{ .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	VkFence fence = nullptr;
+	if (vkAllocateCommandBuffers(device, &cmdAllocInfo, &commandBuffer) != VK_SUCCESS || vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to create the defragmentation command buffer, skipped" << std::endl;
+		vkDestroyCommandPool(device, commandPool, nullptr);
+		return;
+	}
+
+	// the fast algorithm only packs allocations into fewer blocks, which is all a load boundary needs
+	VmaDefragmentationInfo defragInfo{ .flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FAST_BIT };
+	VmaDefragmentationContext context = nullptr;
+	if (vmaBeginDefragmentation(allocator, &defragInfo, &context) != VK_SUCCESS)
+	{
+		vkDestroyFence(device, fence, nullptr);
+		vkDestroyCommandPool(device, commandPool, nullptr);
+		return;
+	}
+
+	struct Move
+	{
+		Record *record = nullptr;
+		VkBuffer newBuffer = nullptr;
+	};
+	std::vector<Move> moves;
+	bool prologueRecorded = false;
+	for (;;)
+	{
+		VmaDefragmentationPassMoveInfo pass{};
+		if (vmaBeginDefragmentationPass(allocator, context, &pass) == VK_SUCCESS)
+		{
+			break; // nothing left to move
+		}
+
+		// every move gets a new buffer bound to its destination, the contents are copied before VMA swaps the memory
+		moves.clear();
+		VkCommandBufferBeginInfo beginInfo{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		if (!prologueRecorded)
+		{
+			prologue(commandBuffer);
+			prologueRecorded = true;
+		}
+		VkMemoryBarrier2 beforeCopy
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT
+		};
+		VkDependencyInfo beforeDependency{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &beforeCopy };
+		vkCmdPipelineBarrier2(commandBuffer, &beforeDependency);
+
+		for (VmaDefragmentationMove &move : std::span(pass.pMoves, pass.moveCount))
+		{
+			VmaAllocationInfo info{};
+			vmaGetAllocationInfo(allocator, move.srcAllocation, &info);
+			Record *record = static_cast<Record *>(info.pUserData);
+			if (!record || !record->buffer || record->concurrent || !canMove(record->buffer))
+			{
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			VkBufferCreateInfo bufferInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+				.size = record->bufferSize,
+				.usage = record->bufferUsage,
+				.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+			};
+			VkBuffer newBuffer = nullptr;
+			if (vkCreateBuffer(device, &bufferInfo, nullptr, &newBuffer) != VK_SUCCESS ||
+				vmaBindBufferMemory(allocator, move.dstTmpAllocation, newBuffer) != VK_SUCCESS)
+			{
+				vkDestroyBuffer(device, newBuffer, nullptr);
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+			VkBufferCopy region{ .size = record->bufferSize };
+			vkCmdCopyBuffer(commandBuffer, record->buffer, newBuffer, 1, &region);
+			moves.push_back(Move{ .record = record, .newBuffer = newBuffer });
+		}
+
+		VkMemoryBarrier2 afterCopy
+		{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT
+		};
+		VkDependencyInfo afterDependency{ .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO, .memoryBarrierCount = 1, .pMemoryBarriers = &afterCopy };
+		vkCmdPipelineBarrier2(commandBuffer, &afterDependency);
+		vkEndCommandBuffer(commandBuffer);
+
+		VkCommandBufferSubmitInfo cmdSubmitInfo{ .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = commandBuffer };
+		VkSubmitInfo2 submitInfo{ .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2, .commandBufferInfoCount = 1, .pCommandBufferInfos = &cmdSubmitInfo };
+		vkQueueSubmit2(queue, 1, &submitInfo, fence);
+		vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+		vkResetFences(device, 1, &fence);
+		vkResetCommandBuffer(commandBuffer, 0);
+
+		// the old buffers go before VMA frees the memory they were bound to
+		for (const Move &move : moves)
+		{
+			moved(move.record->buffer, move.newBuffer);
+			vkDestroyBuffer(device, move.record->buffer, nullptr);
+			move.record->buffer = move.newBuffer;
+		}
+		if (vmaEndDefragmentationPass(allocator, context, &pass) == VK_SUCCESS)
+		{
+			break;
+		}
+	}
+
+	VmaDefragmentationStats stats{};
+	vmaEndDefragmentation(allocator, context, &stats);
+	vkDestroyFence(device, fence, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	if (stats.allocationsMoved > 0)
+	{
+		std::cout << "Defragmented GPU memory: " << stats.allocationsMoved << " buffers moved (" << megabytes(stats.bytesMoved) << " MB), "
+			<< stats.deviceMemoryBlocksFreed << " blocks and " << megabytes(stats.bytesFreed) << " MB freed" << std::endl;
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+struct VmaAllocator_T;
+typedef struct VmaAllocator_T *VmaAllocator;
+struct VmaAllocation_T;
+typedef struct VmaAllocation_T *VmaAllocation;
+struct VmaAllocationCreateInfo;
+struct VmaAllocationInfo;
+
+// Owns the VMA allocator and every allocation made through it. Allocations are tagged with a
+// category so usage can be reported per kind of resource, and VK_EXT_memory_budget keeps the
+// per heap usage and budget current. A hard budget caps the device local heaps below what the
+// device reports, allocations beyond it fail instead of overcommitting video memory.
+// Buffers can be defragmented at load boundaries, when nothing else is using the device.
+class GpuMemory
+{
+public:
+	enum Category : uint32_t
+	{
+		Geometry, // vertex, index and per draw buffers
+		Textures,
+		RenderTargets,
+		Staging, // upload ring and frame arenas
+		CategoryCount
+	};
+
+	struct HeapStats
+	{
+		bool deviceLocal = false;
+		VkDeviceSize size = 0; // after the hard budget
+		VkDeviceSize usage = 0; // by this process, including memory allocated outside of VMA
+		VkDeviceSize budget = 0; // what the process can use before the driver starts evicting or failing
+		VkDeviceSize allocationBytes = 0;
+		VkDeviceSize blockBytes = 0;
+	};
+
+private:
+	// behind each allocation's user data, buffers keep what defragmentation needs to recreate them
+	struct Record
+	{
+		Category category = Geometry;
+		VkDeviceSize size = 0;
+		VkBuffer buffer = nullptr;
+		VkDeviceSize bufferSize = 0;
+		VkBufferUsageFlags bufferUsage = 0;
+		bool concurrent = false; // the queue family list isn't kept, so these stay where they are
+	};
+
+	VkDevice device = nullptr;
+	VmaAllocator allocator = nullptr;
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	std::vector<VkDeviceSize> heapLimits; // VK_WHOLE_SIZE where the heap isn't capped
+	bool budgetExtension = false;
+	bool hardBudget = false;
+	std::array<std::atomic<VkDeviceSize>, CategoryCount> categoryBytes{};
+	std::array<std::atomic<VkDeviceSize>, CategoryCount> categoryPeaks{};
+	bool overBudget = false;
+
+	Record *track(Category category, VmaAllocation allocation);
+	void untrack(VmaAllocation allocation);
+	void reportFailure(Category category, VkDeviceSize size) const;
+
+public:
+	// budgetLimit of 0 leaves the heaps at the size the device reports
+	bool initialize(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t apiVersion,
+		bool budgetExtension, VkDeviceSize budgetLimit);
+	void shutdown();
+
+	VmaAllocator handle() const { return allocator; }
+	bool hasBudgetExtension() const { return budgetExtension; }
+
+	// within the hard budget when one is set, failures are reported here so callers only check the result
+	bool createBuffer(Category category, const VkBufferCreateInfo &bufferInfo, const VmaAllocationCreateInfo &allocInfo,
+		VkBuffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocResult = nullptr);
+	bool createImage(Category category, const VkImageCreateInfo &imageInfo, const VmaAllocationCreateInfo &allocInfo,
+		VkImage &image, VmaAllocation &allocation);
+	// raw memory for resources bound by the caller, like render targets aliasing one allocation
+	bool allocateMemory(Category category, const VkMemoryRequirements &requirements, const VmaAllocationCreateInfo &allocInfo,
+		VmaAllocation &allocation);
+	// null handles are ignored
+	void destroyBuffer(VkBuffer buffer, VmaAllocation allocation);
+	void destroyImage(VkImage image, VmaAllocation allocation);
+	void freeMemory(VmaAllocation allocation);
+
+	// once per frame, VMA refreshes the budgets from the driver every few frame indices
+	void beginFrame(uint64_t frameId);
+	std::vector<HeapStats> heapStats() const;
+	VkDeviceSize usage(Category category) const { return categoryBytes[category].load(std::memory_order_relaxed); }
+	VkDeviceSize peakUsage(Category category) const { return categoryPeaks[category].load(std::memory_order_relaxed); }
+	static const char *categoryName(Category category);
+	void printStats(const char *when) const;
+
+	// compacts buffer allocations, the device must be idle and stay that way until this returns. canMove picks
+	// the buffers whose handles the caller can swap, moved hands over each new handle once its contents are copied
+	// and prologue is recorded ahead of the first copy. Images are never moved, bindless descriptors point at them
+	void defragment(VkQueue queue, uint32_t queueFamIdx, const std::function<bool(VkBuffer)> &canMove,
+		const std::function<void(VkBuffer oldBuffer, VkBuffer newBuffer)> &moved, const std::function<void(VkCommandBuffer)> &prologue);
+};
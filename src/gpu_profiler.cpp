@@ -0,0 +1,432 @@
+#include "gpu_profiler.h"
+
+#include <Volk/volk.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+
+bool GpuProfiler::initialize(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t timestampValidBits, uint32_t frameCount,
+	bool pipelineStatistics, bool keepSamples, uint32_t historyLength)
+{
+	this->device = device;
+	this->keepSamples = keepSamples;
+	this->historyLength = std::max(historyLength, 1u);
+	if (timestampValidBits == 0)
+	{
+		std::cerr << "The graphics queue doesn't support timestamps, GPU profiler disabled" << std::endl;
+		return true;
+	}
+
+	VkPhysicalDeviceProperties props{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	timestampPeriodMs = static_cast<double>(props.limits.timestampPeriod) / 1e6;
+	timestampMasks[GraphicsQueue] = timestampValidBits >= 64 ? UINT64_MAX : (1ull << timestampValidBits) - 1;
+
+	VkPhysicalDeviceFeatures features{};
+	vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+	statisticsEnabled = pipelineStatistics && features.pipelineStatisticsQuery;
+	if (pipelineStatistics && !statisticsEnabled)
+	{
+		std::cerr << "Pipeline statistics queries aren't supported, only timestamps are collected" << std::endl;
+	}
+
+	this->frameCount = std::min(frameCount, MaxFrames);
+	for (FrameQueries &frame : std::span(frames[GraphicsQueue]).first(this->frameCount))
+	{
+		if (!createQueries(frame, statisticsEnabled))
+		{
+			return false;
+		}
+	}
+	enabled = true;
+	return true;
+}
+
+bool GpuProfiler::createQueries(FrameQueries &frame, bool statistics)
+{
+	// a begin and end query per scope
+	VkQueryPoolCreateInfo timestampInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = MaxScopes * 2
+	};
+	if (vkCreateQueryPool(device, &timestampInfo, nullptr, &frame.timestamps) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to create the timestamp query pool" << std::endl;
+		return false;
+	}
+
+	if (statistics)
+	{
+		VkQueryPoolCreateInfo statisticsInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+			.queryCount = 1,
+			.pipelineStatistics = statisticFlags()
+		};
+		if (vkCreateQueryPool(device, &statisticsInfo, nullptr, &frame.statistics) != VK_SUCCESS)
+		{
+			std::cerr << "Unable to create the pipeline statistics query pool" << std::endl;
+			return false;
+		}
+	}
+	frame.scopes.reserve(MaxScopes);
+	return true;
+}
+
+bool GpuProfiler::enableComputeQueue(uint32_t timestampValidBits)
+{
+	if (!enabled)
+	{
+		return true;
+	}
+	if (timestampValidBits == 0)
+	{
+		std::cerr << "The async compute queue doesn't support timestamps, its work isn't profiled" << std::endl;
+		return true;
+	}
+
+	// timestamps of every queue on the device share one time domain, so the two can be compared directly
+	timestampMasks[ComputeQueue] = timestampValidBits >= 64 ? UINT64_MAX : (1ull << timestampValidBits) - 1;
+	for (FrameQueries &frame : std::span(frames[ComputeQueue]).first(frameCount))
+	{
+		if (!createQueries(frame, false))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void GpuProfiler::shutdown()
+{
+	for (std::array<FrameQueries, MaxFrames> &queueFrames : frames)
+	{
+		for (FrameQueries &frame : queueFrames)
+		{
+			if (frame.timestamps)
+			{
+				vkDestroyQueryPool(device, frame.timestamps, nullptr);
+			}
+			if (frame.statistics)
+			{
+				vkDestroyQueryPool(device, frame.statistics, nullptr);
+			}
+			frame = FrameQueries();
+		}
+	}
+	enabled = false;
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::statisticFlags() const
+{
+	// bit order matches Statistic, results come back in ascending bit order
+	return statisticsEnabled ? VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT : 0;
+}
+
+uint32_t GpuProfiler::findPass(const char *name)
+{
+	for (uint32_t i = 0; i < passes.size(); ++i)
+	{
+		if (passes[i].name == name)
+		{
+			return i;
+		}
+	}
+	passes.push_back(Pass{ .name = name, .history = std::vector<float>(historyLength) });
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void GpuProfiler::resolve(FrameQueries &frame, Queue queue)
+{
+	if (frame.frameId == 0 || frame.queryCount == 0)
+	{
+		return;
+	}
+
+	// the frame has completed, so this never waits, NOT_READY only happens if a scope was left open
+	std::array<uint64_t, MaxScopes * 2> timestamps{};
+	if (vkGetQueryPoolResults(device, frame.timestamps, 0, frame.queryCount, frame.queryCount * sizeof(uint64_t),
+		timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		frame.frameId = 0;
+		return;
+	}
+	if (firstTimestamp == 0)
+	{
+		firstTimestamp = timestamps[0];
+	}
+	const uint64_t timestampMask = timestampMasks[queue];
+
+	// the first scope spans the whole frame, graphics frames are kept for the compute frames resolved after them,
+	// which overlap the previous graphics frame and the start of their own
+	const uint64_t frameBegin = timestamps[frame.scopes[0].beginQuery] & timestampMask;
+	const uint64_t frameEnd = timestamps[frame.scopes[0].endQuery] & timestampMask;
+	if (queue == GraphicsQueue)
+	{
+		graphicsSpans[frame.frameId % graphicsSpans.size()] = FrameSpan{ .frameId = frame.frameId, .begin = frameBegin, .end = frameEnd };
+	}
+	else if (frameEnd > frameBegin)
+	{
+		uint64_t overlapTicks = 0;
+		for (const uint64_t graphicsFrame : { frame.frameId - 1, frame.frameId })
+		{
+			const FrameSpan &span = graphicsSpans[graphicsFrame % graphicsSpans.size()];
+			const uint64_t begin = std::max(span.begin, frameBegin);
+			const uint64_t end = std::min(span.end, frameEnd);
+			if (span.frameId == graphicsFrame && end > begin)
+			{
+				overlapTicks += end - begin;
+			}
+		}
+		computeBusyMs += (frameEnd - frameBegin) * timestampPeriodMs;
+		computeOverlapMs += std::min(overlapTicks, frameEnd - frameBegin) * timestampPeriodMs;
+		++computeFrames;
+	}
+
+	for (const Scope &scope : frame.scopes)
+	{
+		const uint64_t ticks = (timestamps[scope.endQuery] - timestamps[scope.beginQuery]) & timestampMask;
+		Pass &pass = passes[scope.pass];
+		pass.history[pass.sampleCount++ % historyLength] = static_cast<float>(ticks * timestampPeriodMs);
+		if (keepSamples)
+		{
+			const double beginMs = static_cast<double>((timestamps[scope.beginQuery] - firstTimestamp) & timestampMask) * timestampPeriodMs;
+			samples.push_back(Sample
+			{
+				.frameId = frame.frameId,
+				.pass = scope.pass,
+				.depth = scope.depth,
+				.queue = queue,
+				.beginMs = beginMs,
+				.endMs = beginMs + ticks * timestampPeriodMs
+			});
+		}
+	}
+
+	if (frame.statistics)
+	{
+		std::array<uint64_t, StatisticCount> values{};
+		if (vkGetQueryPoolResults(device, frame.statistics, 0, 1, sizeof(values), values.data(), sizeof(values), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			for (uint32_t i = 0; i < StatisticCount; ++i)
+			{
+				statisticTotals[i] += values[i];
+			}
+			++statisticFrames;
+		}
+	}
+	frame.frameId = 0;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameId, Queue queue)
+{
+	FrameQueries &frame = frames[queue][frameIndex];
+	if (!enabled || !frame.timestamps)
+	{
+		return;
+	}
+
+	// whichever queue records first resolves the slot for both, graphics ahead of the compute frames measured against it,
+	// a frame already begun for this frameId on the other queue is still in flight
+	for (uint32_t resolveQueue = 0; resolveQueue < QueueCount; ++resolveQueue)
+	{
+		if (frames[resolveQueue][frameIndex].frameId < frameId)
+		{
+			resolve(frames[resolveQueue][frameIndex], static_cast<Queue>(resolveQueue));
+		}
+	}
+
+	vkCmdResetQueryPool(commandBuffer, frame.timestamps, 0, MaxScopes * 2);
+	if (frame.statistics)
+	{
+		vkCmdResetQueryPool(commandBuffer, frame.statistics, 0, 1);
+	}
+	frame.frameId = frameId;
+	frame.queryCount = 0;
+	frame.scopes.clear();
+	frame.openScopes.clear();
+	recording = &frame;
+	beginScope(commandBuffer, queue == GraphicsQueue ? "frame" : "compute");
+}
+
+void GpuProfiler::endFrame(VkCommandBuffer commandBuffer)
+{
+	if (!recording)
+	{
+		return;
+	}
+	while (!recording->openScopes.empty())
+	{
+		endScope(commandBuffer);
+	}
+	recording = nullptr;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char *name)
+{
+	if (!recording)
+	{
+		return;
+	}
+
+	const VkDebugUtilsLabelEXT label{ .sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, .pLabelName = name };
+	vkCmdBeginDebugUtilsLabelEXT(commandBuffer, &label);
+
+	// the label still shows up in captures when the scope budget is used up
+	if (recording->scopes.size() == MaxScopes)
+	{
+		recording->openScopes.push_back(UINT32_MAX);
+		return;
+	}
+	const uint32_t query = recording->queryCount++;
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, recording->timestamps, query);
+	recording->openScopes.push_back(static_cast<uint32_t>(recording->scopes.size()));
+	recording->scopes.push_back(Scope
+	{
+		.pass = findPass(name),
+		.beginQuery = query,
+		.depth = static_cast<uint32_t>(recording->openScopes.size() - 1)
+	});
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer)
+{
+	if (!recording || recording->openScopes.empty())
+	{
+		return;
+	}
+
+	const uint32_t scope = recording->openScopes.back();
+	recording->openScopes.pop_back();
+	if (scope != UINT32_MAX)
+	{
+		const uint32_t query = recording->queryCount++;
+		vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, recording->timestamps, query);
+		recording->scopes[scope].endQuery = query;
+	}
+	vkCmdEndDebugUtilsLabelEXT(commandBuffer);
+}
+
+void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer)
+{
+	if (recording && recording->statistics)
+	{
+		vkCmdBeginQuery(commandBuffer, recording->statistics, 0, 0);
+	}
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer)
+{
+	if (recording && recording->statistics)
+	{
+		vkCmdEndQuery(commandBuffer, recording->statistics, 0);
+	}
+}
+
+std::vector<GpuProfiler::PassSummary> GpuProfiler::summarize() const
+{
+	std::vector<PassSummary> summaries;
+	for (const Pass &pass : passes)
+	{
+		const uint32_t count = std::min(pass.sampleCount, historyLength);
+		if (count > 0)
+		{
+			summaries.push_back(PassSummary
+			{
+				.name = pass.name,
+				.samples = count,
+				.ms = computePercentiles(std::vector<double>(pass.history.begin(), pass.history.begin() + count))
+			});
+		}
+	}
+	return summaries;
+}
+
+std::vector<double> GpuProfiler::statisticAverages() const
+{
+	std::vector<double> averages;
+	if (statisticFrames > 0)
+	{
+		for (uint64_t total : statisticTotals)
+		{
+			averages.push_back(static_cast<double>(total) / static_cast<double>(statisticFrames));
+		}
+	}
+	return averages;
+}
+
+void GpuProfiler::printReport() const
+{
+	const std::vector<PassSummary> summaries = summarize();
+	if (summaries.empty())
+	{
+		return;
+	}
+
+	std::cout << "GPU time per pass (ms, last " << historyLength << " frames):" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (const PassSummary &summary : summaries)
+	{
+		std::cout << "  " << std::left << std::setw(12) << summary.name << std::right
+			<< " avg " << summary.ms.average << "  p50 " << summary.ms.p50 << "  p95 " << summary.ms.p95 << "  p99 " << summary.ms.p99 << std::endl;
+	}
+	std::cout << std::defaultfloat;
+
+	const std::vector<double> statistics = statisticAverages();
+	if (!statistics.empty())
+	{
+		std::cout << "Pipeline statistics per frame: " << statistics[VertexInvocations] << " vertex invocations, "
+			<< statistics[ClippingPrimitives] << " clipped primitives, "
+			<< statistics[FragmentInvocations] << " fragment invocations" << std::endl;
+	}
+	if (computeFrames > 0)
+	{
+		std::cout << "Async compute: " << computeMsPerFrame() << " ms per frame on the compute queue, "
+			<< computeOverlap() * 100.0 << "% of it overlapped with graphics work" << std::endl;
+	}
+}
+
+bool GpuProfiler::writeDump(const std::string &filePath) const
+{
+	std::ofstream out(filePath, std::ios::trunc);
+	if (!out.is_open())
+	{
+		std::cerr << "Unable to write GPU profile: " << filePath << std::endl;
+		return false;
+	}
+
+	const bool trace = filePath.size() >= 5 && filePath.compare(filePath.size() - 5, 5, ".json") == 0;
+	out << std::fixed << std::setprecision(trace ? 3 : 6);
+	if (trace)
+	{
+		// chrome://tracing and Perfetto read complete events, times in microseconds
+		out << "{\"traceEvents\":[";
+		for (size_t i = 0; i < samples.size(); ++i)
+		{
+			const Sample &sample = samples[i];
+			out << (i ? "," : "") << "\n{\"name\":\"" << passes[sample.pass].name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << sample.queue << ",\"ts\":"
+				<< sample.beginMs * 1000.0 << ",\"dur\":" << (sample.endMs - sample.beginMs) * 1000.0 << ",\"args\":{\"frame\":" << sample.frameId << "}}";
+		}
+		out << "\n]}\n";
+	}
+	else
+	{
+		out << "frame,pass,depth,begin_ms,end_ms,duration_ms,queue\n";
+		for (const Sample &sample : samples)
+		{
+			out << sample.frameId << "," << passes[sample.pass].name << "," << sample.depth << ","
+				<< sample.beginMs << "," << sample.endMs << "," << sample.endMs - sample.beginMs << ","
+				<< (sample.queue == GraphicsQueue ? "graphics" : "compute") << "\n";
+		}
+	}
+	std::cout << "Wrote " << samples.size() << " GPU scopes to " << filePath << std::endl;
+	return out.good();
+}
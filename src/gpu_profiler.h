@@ -0,0 +1,148 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include "utils.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// Timestamps around named passes, plus an optional pipeline statistics query over the frame.
+// Every frame slot has its own query pools, results are read back without waiting once the
+// frame timeline shows the slot's previous frame has completed. Scopes double as debug utils
+// labels, so captures in external tools show the same breakdown. An async compute queue gets
+// pools of its own, and its frames are measured against the graphics frames they ran next to.
+class GpuProfiler
+{
+	constexpr static uint32_t MaxScopes{ 32 }; // per frame, later scopes are dropped
+
+public:
+	constexpr static uint32_t MaxFrames{ 3 };
+	constexpr static uint32_t DefaultHistoryLength{ 256 };
+
+	enum Queue : uint32_t
+	{
+		GraphicsQueue,
+		ComputeQueue,
+		QueueCount
+	};
+
+	enum Statistic : uint32_t
+	{
+		VertexInvocations,
+		ClippingPrimitives,
+		FragmentInvocations,
+		StatisticCount
+	};
+
+	struct PassSummary
+	{
+		std::string name;
+		uint32_t samples = 0;
+		Percentiles ms;
+	};
+
+private:
+	struct Scope
+	{
+		uint32_t pass = 0; // index into passes
+		uint32_t beginQuery = 0;
+		uint32_t endQuery = 0;
+		uint32_t depth = 0;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool timestamps = nullptr;
+		VkQueryPool statistics = nullptr;
+		uint64_t frameId = 0; // 0 when nothing is waiting to be read back
+		uint32_t queryCount = 0;
+		std::vector<Scope> scopes;
+		std::vector<uint32_t> openScopes;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::vector<float> history; // ms, ring indexed by sample count
+		uint32_t sampleCount = 0;
+	};
+
+	// one row per resolved scope, only kept when a dump was requested
+	struct Sample
+	{
+		uint64_t frameId = 0;
+		uint32_t pass = 0;
+		uint32_t depth = 0;
+		Queue queue = GraphicsQueue;
+		double beginMs = 0;
+		double endMs = 0;
+	};
+
+	// ticks of a resolved graphics frame, kept until the compute frames next to it are resolved
+	struct FrameSpan
+	{
+		uint64_t frameId = 0;
+		uint64_t begin = 0;
+		uint64_t end = 0;
+	};
+
+	VkDevice device = nullptr;
+	bool enabled = false;
+	bool statisticsEnabled = false;
+	bool keepSamples = false;
+	uint32_t historyLength = DefaultHistoryLength;
+	double timestampPeriodMs = 0; // ms per tick
+	std::array<uint64_t, QueueCount> timestampMasks{};
+	uint64_t firstTimestamp = 0; // dump times are relative to the first resolved frame
+	uint32_t frameCount = 0;
+	std::array<std::array<FrameQueries, MaxFrames>, QueueCount> frames;
+	FrameQueries *recording = nullptr;
+	std::array<FrameSpan, MaxFrames + 1> graphicsSpans;
+	double computeBusyMs = 0;
+	double computeOverlapMs = 0; // of computeBusyMs, while the graphics queue was inside a frame too
+	uint64_t computeFrames = 0;
+	std::vector<Pass> passes;
+	std::vector<Sample> samples;
+	std::array<uint64_t, StatisticCount> statisticTotals{};
+	uint64_t statisticFrames = 0;
+
+	uint32_t findPass(const char *name);
+	bool createQueries(FrameQueries &frame, bool statistics);
+	void resolve(FrameQueries &frame, Queue queue);
+
+public:
+	// timestampValidBits of the queue family the frames are submitted on, 0 disables the profiler
+	bool initialize(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t timestampValidBits, uint32_t frameCount,
+		bool pipelineStatistics, bool keepSamples, uint32_t historyLength = DefaultHistoryLength);
+	// pools for the async compute queue, its family's timestampValidBits of 0 leaves it unprofiled
+	bool enableComputeQueue(uint32_t timestampValidBits);
+	void shutdown();
+
+	bool isEnabled() const { return enabled; }
+	bool collectsStatistics() const { return statisticsEnabled; }
+	// the statistics flags secondaries executed inside the frame must inherit
+	VkQueryPipelineStatisticFlags statisticFlags() const;
+
+	// call once the slot's previous frame has completed, resolves it on every queue and resets the queries for frameId.
+	// Only one queue's frame is recorded at a time, it ends with endFrame before the next one begins
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameId, Queue queue = GraphicsQueue);
+	void endFrame(VkCommandBuffer commandBuffer);
+
+	// must be recorded outside of secondaries, nested scopes are allowed
+	void beginScope(VkCommandBuffer commandBuffer, const char *name);
+	void endScope(VkCommandBuffer commandBuffer);
+	void beginStatistics(VkCommandBuffer commandBuffer);
+	void endStatistics(VkCommandBuffer commandBuffer);
+
+	// per pass average and percentiles over the last historyLength frames
+	std::vector<PassSummary> summarize() const;
+	// per frame averages indexed by Statistic, empty without statistics
+	std::vector<double> statisticAverages() const;
+	// 0 until an async compute frame was resolved
+	double computeMsPerFrame() const { return computeFrames ? computeBusyMs / static_cast<double>(computeFrames) : 0.0; }
+	double computeOverlap() const { return computeBusyMs > 0 ? computeOverlapMs / computeBusyMs : 0.0; }
+	void printReport() const;
+	// every resolved scope, a .json path writes a chrome trace, anything else CSV
+	bool writeDump(const std::string &filePath) const;
+};
@@ -1,10 +1,20 @@
 #include <SDL3/SDL_main.h>
 #include "application.h"
+#include "config.h"
+#include "draw_culler.h"
 
 int main(int argc, char *argv[])
 {
+	const AppConfig config = parseCommandLine(argc, argv);
+	// the culling micro-benchmark needs neither a window nor a device
+	if (config.cullBenchmark > 0)
+	{
+		DrawCuller::runBenchmark(config.cullBenchmark);
+		return 0;
+	}
+
 	Application app;
-	if (app.initialize())
+	if (app.initialize(config))
 	{
 		app.run();
 	}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <span>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file, the mapping lives as long as the object.
+class MappedFile
+{
+	const std::byte *mappedData = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	bool open(const std::string &filePath);
+	void close();
+
+	bool isOpen() const { return mappedData != nullptr; }
+	std::span<const std::byte> data() const { return { mappedData, mappedSize }; }
+};
@@ -0,0 +1,350 @@
+#include "mesh_cache.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+	constexpr char Magic[8] = { 'V', 'K', 'M', 'C', 'A', 'C', 'H', 'E' };
+
+	uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	void appendUtf8(std::string &out, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (codePoint >> 18));
+			out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	// value of a hex digit, -1 for anything else
+	int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9')
+		{
+			return c - '0';
+		}
+		if (c >= 'a' && c <= 'f')
+		{
+			return c - 'a' + 10;
+		}
+		if (c >= 'A' && c <= 'F')
+		{
+			return c - 'A' + 10;
+		}
+		return -1;
+	}
+
+	// the code unit of a \uXXXX escape starting at text[0], -1 when it isn't one
+	int32_t unicodeEscape(std::string_view text)
+	{
+		if (text.size() < 6 || text[0] != '\\' || text[1] != 'u')
+		{
+			return -1;
+		}
+		int32_t value = 0;
+		for (char c : text.substr(2, 4))
+		{
+			const int digit = hexValue(c);
+			if (digit < 0)
+			{
+				return -1;
+			}
+			value = value * 16 + digit;
+		}
+		return value;
+	}
+
+	// a JSON string body as the parser hands it to tinygltf, escapes and surrogate pairs decoded to UTF-8,
+	// false when it's malformed
+	bool unescapeJson(std::string_view text, std::string &out)
+	{
+		out.clear();
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			if (text[i] != '\\')
+			{
+				out += text[i];
+				continue;
+			}
+			if (i + 1 == text.size())
+			{
+				return false;
+			}
+			switch (text[i + 1])
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t codePoint = 0;
+				const int32_t high = unicodeEscape(text.substr(i));
+				if (high < 0)
+				{
+					return false;
+				}
+				codePoint = static_cast<uint32_t>(high);
+				if (high >= 0xD800 && high < 0xDC00)
+				{
+					const int32_t low = unicodeEscape(text.substr(i + 6));
+					if (low < 0xDC00 || low >= 0xE000)
+					{
+						return false;
+					}
+					codePoint = 0x10000 + ((static_cast<uint32_t>(high) - 0xD800) << 10) + (static_cast<uint32_t>(low) - 0xDC00);
+					i += 6;
+				}
+				appendUtf8(out, codePoint);
+				i += 4;
+				break;
+			}
+			default:
+				return false;
+			}
+			++i;
+		}
+		return true;
+	}
+
+	// tinygltf's default URI decoding, '+' is a space and %XY a byte
+	std::string decodeUri(std::string_view uri)
+	{
+		std::string result;
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			if (uri[i] == '+')
+			{
+				result += ' ';
+			}
+			else if (uri[i] == '%' && i + 2 < uri.size())
+			{
+				const int high = std::max(hexValue(uri[i + 1]), 0);
+				const int low = std::max(hexValue(uri[i + 2]), 0);
+				result += static_cast<char>((high << 4) | low);
+				i += 2;
+			}
+			else
+			{
+				result += uri[i];
+			}
+		}
+		return result;
+	}
+}
+
+uint64_t MeshCache::hashSource(const std::string &gltfPath, uint64_t importSettings)
+{
+	MappedFile file;
+	if (!file.open(gltfPath))
+	{
+		return UncachedSource;
+	}
+	// the JSON is hashed as it is, a binary glTF's buffer chunk only by the file's size and timestamp like
+	// any other buffer, hashing it would cost more than the load
+	std::string_view contents(reinterpret_cast<const char *>(file.data().data()), file.data().size());
+	uint32_t jsonLength = 0;
+	if (contents.size() >= 20 && contents.starts_with("glTF"))
+	{
+		std::memcpy(&jsonLength, contents.data() + 12, sizeof(jsonLength));
+		contents = contents.substr(20, std::min<size_t>(jsonLength, contents.size() - 20));
+	}
+	std::error_code ec;
+	const uint64_t fileSize = file.data().size();
+	const int64_t fileTime = std::filesystem::last_write_time(gltfPath, ec).time_since_epoch().count();
+	if (ec)
+	{
+		return UncachedSource;
+	}
+	uint64_t hash = fnv1a(contents.data(), contents.size());
+	hash = fnv1a(&fileSize, sizeof(fileSize), hash);
+	hash = fnv1a(&fileTime, sizeof(fileTime), hash);
+	hash = fnv1a(&importSettings, sizeof(importSettings), hash);
+
+	// external buffers and images are keyed on size and timestamp too. Their URIs are picked out of the raw
+	// text, parsing the whole document would give back much of the time a warm start saves, and decoded the
+	// way tinygltf does so they name the same files. One that can't be stat'ed keeps the model uncached
+	constexpr std::string_view UriKey = "\"uri\"";
+	constexpr std::string_view Whitespace = " \t\r\n";
+	const std::filesystem::path baseDir = std::filesystem::path(gltfPath).parent_path();
+	std::string escaped;
+	for (size_t pos = contents.find(UriKey); pos != std::string_view::npos; pos = contents.find(UriKey, pos))
+	{
+		pos += UriKey.size();
+		const size_t colon = contents.find_first_not_of(Whitespace, pos);
+		if (colon == std::string_view::npos || contents[colon] != ':')
+		{
+			continue;
+		}
+		const size_t open = contents.find_first_not_of(Whitespace, colon + 1);
+		if (open == std::string_view::npos || contents[open] != '"')
+		{
+			continue;
+		}
+		size_t close = open + 1;
+		while (close < contents.size() && contents[close] != '"')
+		{
+			close += contents[close] == '\\' ? 2 : 1;
+		}
+		if (close >= contents.size() || !unescapeJson(contents.substr(open + 1, close - open - 1), escaped))
+		{
+			return UncachedSource;
+		}
+		pos = close + 1;
+		if (escaped.starts_with("data:"))
+		{
+			continue;
+		}
+
+		const std::string uri = decodeUri(escaped);
+		const std::filesystem::path refPath = baseDir / std::u8string(uri.begin(), uri.end());
+		const uint64_t size = std::filesystem::file_size(refPath, ec);
+		if (ec)
+		{
+			return UncachedSource;
+		}
+		const int64_t time = std::filesystem::last_write_time(refPath, ec).time_since_epoch().count();
+		if (ec)
+		{
+			return UncachedSource;
+		}
+		hash = fnv1a(uri.data(), uri.size(), hash);
+		hash = fnv1a(&size, sizeof(size), hash);
+		hash = fnv1a(&time, sizeof(time), hash);
+	}
+	return hash != UncachedSource ? hash : 1;
+}
+
+std::string MeshCache::cachePath(const std::string &gltfPath)
+{
+	// the path hash keeps same-named models from different folders apart
+	const std::string stem = std::filesystem::path(gltfPath).stem().string();
+	return std::format("cache/{}-{:016x}.meshcache", stem, fnv1a(gltfPath.data(), gltfPath.size()));
+}
+
+bool MeshCache::Writer::write(const std::string &filePath, uint64_t sourceHash) const
+{
+	FileHeader header{ .version = Version, .sectionCount = static_cast<uint32_t>(sections.size()), .sourceHash = sourceHash };
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+
+	// lay the sections out after the header and table
+	std::vector<SectionEntry> table;
+	uint64_t offset = alignUp(sizeof(FileHeader) + sizeof(SectionEntry) * sections.size(), SectionAlignment);
+	for (const PendingSection &section : sections)
+	{
+		table.push_back(SectionEntry{ .id = static_cast<uint32_t>(section.id), .offset = offset, .size = section.data.size() });
+		offset = alignUp(offset + section.data.size(), SectionAlignment);
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), ec);
+
+	// written to a temporary file first so a crash never leaves a truncated cache behind
+	const std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			std::cerr << "Unable to write mesh cache: " << filePath << std::endl;
+			return false;
+		}
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char *>(table.data()), sizeof(SectionEntry) * table.size());
+
+		constexpr char padding[SectionAlignment]{};
+		for (size_t i = 0; i < sections.size(); ++i)
+		{
+			const uint64_t position = static_cast<uint64_t>(out.tellp());
+			out.write(padding, static_cast<std::streamsize>(table[i].offset - position));
+			out.write(reinterpret_cast<const char *>(sections[i].data.data()), static_cast<std::streamsize>(sections[i].data.size()));
+		}
+		if (!out.good())
+		{
+			std::cerr << "Error writing mesh cache: " << filePath << std::endl;
+			return false;
+		}
+	}
+	std::filesystem::rename(tempPath, filePath, ec);
+	return !ec;
+}
+
+bool MeshCache::Reader::open(const std::string &filePath, uint64_t sourceHash)
+{
+	close();
+	if (!file.open(filePath))
+	{
+		return false;
+	}
+
+	const std::span<const std::byte> data = file.data();
+	const FileHeader *header = reinterpret_cast<const FileHeader *>(data.data());
+	if (data.size() < sizeof(FileHeader) || std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 ||
+		header->version != Version || sourceHash == UncachedSource || header->sourceHash != sourceHash ||
+		data.size() < sizeof(FileHeader) + sizeof(SectionEntry) * header->sectionCount)
+	{
+		close();
+		return false;
+	}
+
+	entries = { reinterpret_cast<const SectionEntry *>(data.data() + sizeof(FileHeader)), header->sectionCount };
+	for (const SectionEntry &entry : entries)
+	{
+		if (entry.offset + entry.size > data.size())
+		{
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void MeshCache::Reader::close()
+{
+	entries = {};
+	file.close();
+}
+
+std::span<const std::byte> MeshCache::Reader::section(Section id) const
+{
+	for (const SectionEntry &entry : entries)
+	{
+		if (entry.id == static_cast<uint32_t>(id))
+		{
+			return file.data().subspan(entry.offset, entry.size);
+		}
+	}
+	return {};
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Baked, versioned binary cache of an imported model. The file is a header followed by a
+// section table and 64 byte aligned sections, it is memory mapped on load so its contents
+// can be copied straight into staging memory without any parsing.
+namespace MeshCache
+{
+	// bump whenever the layout of any section changes
+	constexpr uint32_t Version = 7;
+	constexpr uint64_t SectionAlignment = 64;
+
+	enum class Section : uint32_t
+	{
+		Vertices = 1, // Renderer::Vertex[]
+		Indices, // uint32_t[], sub-meshes with 65536 or more vertices
+		Meshes, // MeshRecord[]
+		SubMeshes, // SubMeshRecord[]
+		Textures, // TextureRecord[]
+		TextureData, // RGBA8 mip chains, tightly packed
+		CompactVertices, // Renderer::CompactVertex[]
+		Indices16, // uint16_t[], sub-meshes with fewer than 65536 vertices
+		Meshlets, // Renderer::Meshlet[]
+		MeshletData, // uint32_t[], global vertex indices followed by packed 8 bit meshlet local triangles
+		Nodes, // NodeRecord[], scene nodes in pre-order
+		Materials, // Renderer::Material[], texture indices are image indices
+		Lods, // LodRecord[], referenced by SubMeshRecord::lodStart
+	};
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version = 0;
+		uint32_t sectionCount = 0;
+		uint64_t sourceHash = 0;
+	};
+
+	struct SectionEntry
+	{
+		uint32_t id = 0;
+		uint32_t reserved = 0;
+		uint64_t offset = 0; // from the start of the file
+		uint64_t size = 0;
+	};
+
+	// section records are fixed width so the layout doesn't depend on the platform
+	struct MeshRecord
+	{
+		uint32_t firstSubMesh = 0;
+		uint32_t subMeshCount = 0;
+	};
+
+	struct SubMeshRecord
+	{
+		uint64_t vertexStart = 0;
+		uint64_t vertexCount = 0;
+		uint64_t indexStart = 0;
+		uint64_t indexCount = 0;
+		float boundsMin[3]{};
+		float boundsMax[3]{};
+		uint32_t indexType = 0; // VkIndexType, selects the Indices or Indices16 section
+		uint32_t meshletStart = 0;
+		uint32_t meshletCount = 0;
+		uint32_t materialIndex = 0;
+		uint32_t lodStart = 0;
+		uint32_t lodCount = 0;
+	};
+
+	struct LodRecord
+	{
+		uint64_t indexStart = 0; // in the same index section as the sub-mesh
+		uint64_t indexCount = 0;
+		float error = 0;
+		uint32_t padding = 0;
+	};
+
+	struct NodeRecord
+	{
+		uint32_t parent = UINT32_MAX;
+		int32_t meshIndex = -1;
+		float localTransform[16]{}; // column major
+	};
+
+	// all zero for an image the bake couldn't convert, loaded as an empty slot
+	struct TextureRecord
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+		uint32_t padding = 0;
+		uint64_t dataOffset = 0; // into the TextureData section
+		uint64_t dataSize = 0;
+	};
+
+	// returned by hashSource when the glTF or a file it references can't be read, never opens a cache
+	constexpr uint64_t UncachedSource = 0;
+
+	// hash of the glTF's JSON combined with the size and timestamp of the file and of every file it references,
+	// importSettings covers options that change the baked data
+	uint64_t hashSource(const std::string &gltfPath, uint64_t importSettings);
+	// where the baked cache for a given source file lives
+	std::string cachePath(const std::string &gltfPath);
+
+	class Writer
+	{
+		struct PendingSection
+		{
+			Section id;
+			std::span<const std::byte> data;
+		};
+		std::vector<PendingSection> sections;
+
+	public:
+		// data is borrowed and must stay valid until write()
+		void add(Section id, std::span<const std::byte> data) { sections.push_back({ id, data }); }
+		template<typename T>
+		void add(Section id, std::span<const T> items) { add(id, std::as_bytes(items)); }
+
+		bool write(const std::string &filePath, uint64_t sourceHash) const;
+	};
+
+	class Reader
+	{
+		MappedFile file;
+		std::span<const SectionEntry> entries;
+
+	public:
+		// fails if the file is missing, truncated, from another version or built from a different source
+		bool open(const std::string &filePath, uint64_t sourceHash);
+		void close();
+
+		std::span<const std::byte> section(Section id) const;
+		template<typename T>
+		std::span<const T> array(Section id) const
+		{
+			const std::span<const std::byte> bytes = section(id);
+			return { reinterpret_cast<const T *>(bytes.data()), bytes.size() / sizeof(T) };
+		}
+	};
+}
@@ -0,0 +1,725 @@
+#include "mesh_optimizer.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+	constexpr uint32_t ForsythCacheSize = 32;
+
+	glm::vec3 loadPosition(const float *positions, size_t positionStride, uint32_t v)
+	{
+		const float *p = reinterpret_cast<const float *>(reinterpret_cast<const unsigned char *>(positions) + positionStride * v);
+		return glm::vec3(p[0], p[1], p[2]);
+	}
+
+	float forsythVertexScore(int cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			return -1.0f; // no triangles left to use this vertex
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// the last triangle's vertices get a fixed score so we don't favour reusing them too much
+			if (cachePosition < 3)
+			{
+				score = 0.75f;
+			}
+			else
+			{
+				score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (ForsythCacheSize - 3), 1.5f);
+			}
+		}
+
+		// boost vertices with few triangles left so they get finished off
+		return score + 2.0f * std::pow(static_cast<float>(remainingTriangles), -0.5f);
+	}
+
+	// FIFO cache misses per triangle for indices[first, last)
+	struct FifoCache
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t size;
+
+		FifoCache(size_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+		uint32_t triangleMisses(const uint32_t *triangle)
+		{
+			uint32_t misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (time - timestamps[triangle[k]] > size)
+				{
+					timestamps[triangle[k]] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+	};
+
+	// sum of squared distances to a set of planes, symmetric so only the upper triangle of the 4x4 matrix is kept
+	struct Quadric
+	{
+		double xx = 0, xy = 0, xz = 0, xw = 0;
+		double yy = 0, yz = 0, yw = 0;
+		double zz = 0, zw = 0;
+		double ww = 0;
+		double weight = 0;
+
+		void addPlane(const glm::dvec3 &n, double d, double planeWeight)
+		{
+			xx += planeWeight * n.x * n.x; xy += planeWeight * n.x * n.y; xz += planeWeight * n.x * n.z; xw += planeWeight * n.x * d;
+			yy += planeWeight * n.y * n.y; yz += planeWeight * n.y * n.z; yw += planeWeight * n.y * d;
+			zz += planeWeight * n.z * n.z; zw += planeWeight * n.z * d;
+			ww += planeWeight * d * d;
+			weight += planeWeight;
+		}
+
+		void add(const Quadric &other)
+		{
+			xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+			yy += other.yy; yz += other.yz; yw += other.yw;
+			zz += other.zz; zw += other.zw;
+			ww += other.ww;
+			weight += other.weight;
+		}
+
+		// weighted mean squared distance of p to the planes
+		double error(const glm::dvec3 &p) const
+		{
+			const double sum = xx * p.x * p.x + 2 * xy * p.x * p.y + 2 * xz * p.x * p.z + 2 * xw * p.x +
+				yy * p.y * p.y + 2 * yz * p.y * p.z + 2 * yw * p.y +
+				zz * p.z * p.z + 2 * zw * p.z + ww;
+			return weight > 0 ? std::max(0.0, sum / weight) : 0.0;
+		}
+	};
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+	{
+		return CacheStats{};
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	uint32_t misses = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		misses += cache.triangleMisses(&indices[t * 3]);
+	}
+	return CacheStats
+	{
+		.acmr = static_cast<float>(misses) / triangleCount,
+		.atvr = static_cast<float>(misses) / vertexCount
+	};
+}
+
+void MeshOptimizer::optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// vertex -> triangle adjacency, each vertex's live triangles are kept at the front of its list
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t index : indices)
+	{
+		adjacencyOffsets[index + 1]++;
+	}
+	std::vector<uint32_t> remaining(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		remaining[v] = adjacencyOffsets[v + 1];
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	}
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	std::array<uint32_t, ForsythCacheSize + 3> cache{};
+	std::array<uint32_t, ForsythCacheSize + 3> newCache{};
+	uint32_t cacheCount = 0;
+
+	size_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+	size_t scanCursor = 0;
+	while (output.size() < indices.size())
+	{
+		if (bestTriangle == SIZE_MAX)
+		{
+			// nothing in the cache has triangles left, continue with the next unused one
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = scanCursor;
+		}
+
+		const uint32_t *triangle = &indices[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		// drop the triangle from its vertices' live lists
+		for (int k = 0; k < 3; ++k)
+		{
+			const uint32_t v = triangle[k];
+			uint32_t *list = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < remaining[v]; ++i)
+			{
+				if (list[i] == bestTriangle)
+				{
+					std::swap(list[i], list[remaining[v] - 1]);
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// triangle vertices move to the front of the LRU cache
+		uint32_t newCount = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			newCache[newCount++] = triangle[k];
+		}
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			const uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache[newCount++] = v;
+			}
+		}
+
+		// rescore everything that moved, vertices pushed out of the cache included
+		for (uint32_t i = 0; i < newCount; ++i)
+		{
+			const uint32_t v = newCache[i];
+			cachePosition[v] = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+			vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+		}
+		for (uint32_t i = 0; i < newCount; ++i)
+		{
+			const uint32_t v = newCache[i];
+			for (uint32_t j = 0; j < remaining[v]; ++j)
+			{
+				const uint32_t t = adjacency[adjacencyOffsets[v] + j];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			}
+		}
+
+		cacheCount = std::min(newCount, ForsythCacheSize);
+		std::copy_n(newCache.begin(), cacheCount, cache.begin());
+
+		// next triangle is the best one touching the cache
+		bestTriangle = SIZE_MAX;
+		float bestScore = -1.0f;
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			const uint32_t v = cache[i];
+			for (uint32_t j = 0; j < remaining[v]; ++j)
+			{
+				const uint32_t t = adjacency[adjacencyOffsets[v] + j];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::span<uint32_t> indices, const float *positions, size_t positionStride, size_t vertexCount, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	auto position = [&](uint32_t v) { return loadPosition(positions, positionStride, v); };
+
+	// hard boundaries where the cache was effectively flushed (all three vertices missed)
+	std::vector<uint32_t> misses(triangleCount);
+	{
+		FifoCache cache(vertexCount, 16);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			misses[t] = cache.triangleMisses(&indices[t * 3]);
+		}
+	}
+	std::vector<size_t> hardBoundaries;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (t == 0 || misses[t] == 3)
+		{
+			hardBoundaries.push_back(t);
+		}
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// soft boundaries wherever the running ACMR is still within threshold of the hard cluster's
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+	{
+		const size_t start = hardBoundaries[c];
+		const size_t end = hardBoundaries[c + 1];
+		uint32_t clusterMisses = 0;
+		for (size_t t = start; t < end; ++t)
+		{
+			clusterMisses += misses[t];
+		}
+		const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / (end - start);
+
+		clusters.push_back(start);
+		uint32_t runningMisses = 0;
+		size_t runningCount = 0;
+		for (size_t t = start; t < end; ++t)
+		{
+			runningMisses += misses[t];
+			runningCount++;
+			if (t + 1 < end && static_cast<float>(runningMisses) / runningCount <= clusterThreshold)
+			{
+				clusters.push_back(t + 1);
+				runningMisses = 0;
+				runningCount = 0;
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// mesh centroid, area weighted
+	glm::vec3 meshCentroid(0);
+	float meshArea = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), c = position(indices[t * 3 + 2]);
+		const float area = glm::length(glm::cross(b - a, c - a));
+		meshCentroid += (a + b + c) * (area / 3.0f);
+		meshArea += area;
+	}
+	meshCentroid = meshArea > 0 ? meshCentroid / meshArea : glm::vec3(0);
+
+	// clusters facing away from the centre draw first, they are most likely to occlude the rest
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		glm::vec3 centroid(0);
+		glm::vec3 normal(0);
+		float area = 0;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			const glm::vec3 a = position(indices[t * 3]), b = position(indices[t * 3 + 1]), p = position(indices[t * 3 + 2]);
+			const glm::vec3 faceNormal = glm::cross(b - a, p - a); // length is twice the area
+			const float faceArea = glm::length(faceNormal);
+			centroid += (a + b + p) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+		centroid = area > 0 ? centroid / area : centroid;
+		const float normalLength = glm::length(normal);
+		normal = normalLength > 0 ? normal / normalLength : normal;
+		sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (size_t c : order)
+	{
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	std::copy(output.begin(), output.end(), indices.begin());
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::span<uint32_t> indices, size_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+	uint32_t next = 0;
+	for (uint32_t &index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+
+	// unreferenced vertices keep their relative order at the end
+	for (uint32_t &entry : remap)
+	{
+		if (entry == UINT32_MAX)
+		{
+			entry = next++;
+		}
+	}
+	return remap;
+}
+
+MeshOptimizer::MeshletData MeshOptimizer::buildMeshlets(std::span<const uint32_t> indices, size_t vertexCount)
+{
+	MeshletData data;
+	std::vector<uint8_t> localIndex(vertexCount, UINT8_MAX); // position within the open meshlet
+	Meshlet current{};
+
+	auto finish = [&]()
+	{
+		if (current.triangleCount == 0)
+		{
+			return;
+		}
+		for (uint32_t i = 0; i < current.vertexCount; ++i)
+		{
+			localIndex[data.vertices[current.vertexOffset + i]] = UINT8_MAX;
+		}
+		data.meshlets.push_back(current);
+		current = Meshlet{ .vertexOffset = static_cast<uint32_t>(data.vertices.size()), .triangleOffset = static_cast<uint32_t>(data.triangles.size()) };
+	};
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		const uint32_t *triangle = &indices[t];
+		uint32_t newVertices = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			newVertices += localIndex[triangle[k]] == UINT8_MAX ? 1 : 0;
+		}
+		if (current.vertexCount + newVertices > MaxMeshletVertices || current.triangleCount + 1 > MaxMeshletTriangles)
+		{
+			finish();
+		}
+
+		uint32_t packed = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint8_t &local = localIndex[triangle[k]];
+			if (local == UINT8_MAX)
+			{
+				local = static_cast<uint8_t>(current.vertexCount++);
+				data.vertices.push_back(triangle[k]);
+			}
+			packed |= static_cast<uint32_t>(local) << (k * 8);
+		}
+		data.triangles.push_back(packed);
+		current.triangleCount++;
+	}
+	finish();
+	return data;
+}
+
+MeshOptimizer::MeshletBounds MeshOptimizer::computeMeshletBounds(const MeshletData &data, const Meshlet &meshlet, const float *positions, size_t positionStride, bool allowCone)
+{
+	MeshletBounds bounds;
+	if (meshlet.triangleCount == 0)
+	{
+		return bounds;
+	}
+
+	// sphere around the AABB centre, loose but cheap and stable
+	const uint32_t *vertices = &data.vertices[meshlet.vertexOffset];
+	glm::vec3 minPos = loadPosition(positions, positionStride, vertices[0]);
+	glm::vec3 maxPos = minPos;
+	for (uint32_t i = 1; i < meshlet.vertexCount; ++i)
+	{
+		const glm::vec3 p = loadPosition(positions, positionStride, vertices[i]);
+		minPos = glm::min(minPos, p);
+		maxPos = glm::max(maxPos, p);
+	}
+	const glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		radius = std::max(radius, glm::length(loadPosition(positions, positionStride, vertices[i]) - center));
+	}
+	for (int c = 0; c < 3; ++c)
+	{
+		bounds.center[c] = center[c];
+		bounds.coneApex[c] = center[c];
+	}
+	bounds.radius = radius;
+	if (!allowCone)
+	{
+		return bounds;
+	}
+
+	// normal cone over the triangle face normals
+	std::vector<glm::vec3> corners(meshlet.triangleCount);
+	std::vector<glm::vec3> normals(meshlet.triangleCount);
+	glm::vec3 axis(0);
+	uint32_t validNormals = 0;
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const uint32_t packed = data.triangles[meshlet.triangleOffset + t];
+		const glm::vec3 a = loadPosition(positions, positionStride, vertices[packed & 0xff]);
+		const glm::vec3 b = loadPosition(positions, positionStride, vertices[(packed >> 8) & 0xff]);
+		const glm::vec3 p = loadPosition(positions, positionStride, vertices[(packed >> 16) & 0xff]);
+		const glm::vec3 normal = glm::cross(b - a, p - a);
+		const float length = glm::length(normal);
+		corners[t] = a;
+		normals[t] = length > 0 ? normal / length : glm::vec3(0);
+		axis += normals[t];
+		validNormals += length > 0 ? 1 : 0;
+	}
+	const float axisLength = glm::length(axis);
+	if (validNormals == 0 || axisLength == 0)
+	{
+		return bounds;
+	}
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3 &normal : normals)
+	{
+		if (normal != glm::vec3(0))
+		{
+			minDot = std::min(minDot, glm::dot(normal, axis));
+		}
+	}
+	if (minDot <= 0.1f)
+	{
+		return bounds; // normals spread over more than ~85 degrees, the cone would never cull
+	}
+
+	// move the apex back along the axis until every triangle plane is in front of it
+	float maxT = 0;
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		if (normals[t] == glm::vec3(0))
+		{
+			continue;
+		}
+		const float dc = glm::dot(center - corners[t], normals[t]);
+		const float dn = glm::dot(axis, normals[t]);
+		maxT = std::max(maxT, dc / dn);
+	}
+	const glm::vec3 apex = center - axis * maxT;
+	for (int c = 0; c < 3; ++c)
+	{
+		bounds.coneApex[c] = apex[c];
+		bounds.coneAxis[c] = axis[c];
+	}
+	bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	return bounds;
+}
+
+std::vector<uint32_t> MeshOptimizer::simplify(std::span<const uint32_t> indices, const float *positions, size_t positionStride, size_t vertexCount,
+	size_t targetIndexCount, float maxError, float &resultError)
+{
+	std::vector<uint32_t> result(indices.begin(), indices.end());
+	resultError = 0;
+	std::vector<glm::dvec3> points(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		points[v] = glm::dvec3(loadPosition(positions, positionStride, v));
+	}
+
+	// every vertex starts out with the planes of the triangles around it, weighted by area
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t + 2 < result.size(); t += 3)
+	{
+		const glm::dvec3 &p0 = points[result[t]];
+		const glm::dvec3 normal = glm::cross(points[result[t + 1]] - p0, points[result[t + 2]] - p0);
+		const double length = glm::length(normal);
+		if (length == 0)
+		{
+			continue;
+		}
+		const glm::dvec3 n = normal / length;
+		for (int k = 0; k < 3; ++k)
+		{
+			quadrics[result[t + k]].addPlane(n, -glm::dot(n, p0), length * 0.5);
+		}
+	}
+
+	// an edge that isn't shared by exactly two triangles is a border, a seam or non-manifold
+	std::vector<uint64_t> edges;
+	edges.reserve(result.size());
+	for (size_t t = 0; t + 2 < result.size(); t += 3)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const uint32_t a = result[t + k];
+			const uint32_t b = result[t + (k + 1) % 3];
+			edges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::vector<bool> locked(vertexCount, false);
+	for (size_t begin = 0; begin < edges.size();)
+	{
+		size_t end = begin + 1;
+		while (end < edges.size() && edges[end] == edges[begin])
+		{
+			++end;
+		}
+		if (end - begin != 2)
+		{
+			locked[edges[begin] >> 32] = true;
+			locked[edges[begin] & UINT32_MAX] = true;
+		}
+		begin = end;
+	}
+
+	struct Collapse
+	{
+		uint32_t from = 0;
+		uint32_t to = 0;
+		double cost = 0;
+	};
+	const double maxCost = static_cast<double>(maxError) * maxError;
+	double largestCost = 0;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	while (result.size() > targetIndexCount)
+	{
+		// both directions of every edge, cheapest first
+		collapses.clear();
+		for (size_t t = 0; t + 2 < result.size(); t += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				const uint32_t a = result[t + k];
+				const uint32_t b = result[t + (k + 1) % 3];
+				if (!locked[a])
+				{
+					collapses.push_back({ a, b, quadrics[a].error(points[b]) });
+				}
+				if (!locked[b])
+				{
+					collapses.push_back({ b, a, quadrics[b].error(points[a]) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &l, const Collapse &r) { return l.cost < r.cost; });
+
+		// triangles around each vertex, for the flip test
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : result)
+		{
+			adjacencyOffsets[index + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(result.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		// independent collapses only, a vertex moves or receives at most once per pass so the costs stay exact
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+		const size_t excessTriangles = (result.size() - targetIndexCount) / 3;
+		size_t removedTriangles = 0;
+		for (const Collapse &collapse : collapses)
+		{
+			if (collapse.cost > maxCost || removedTriangles >= excessTriangles)
+			{
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			// reject collapses that would turn a remaining triangle over
+			bool flips = false;
+			size_t removed = 0;
+			for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1] && !flips; ++i)
+			{
+				const uint32_t *triangle = &result[adjacency[i] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					removed++;
+					continue;
+				}
+				glm::dvec3 moved[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					moved[k] = points[triangle[k] == collapse.from ? collapse.to : triangle[k]];
+				}
+				const glm::dvec3 before = glm::cross(points[triangle[1]] - points[triangle[0]], points[triangle[2]] - points[triangle[0]]);
+				const glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				flips = glm::dot(before, after) <= 0;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			touched[collapse.from] = true;
+			touched[collapse.to] = true;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			largestCost = std::max(largestCost, collapse.cost);
+			removedTriangles += removed;
+		}
+		if (removedTriangles == 0)
+		{
+			break;
+		}
+
+		// apply the pass and drop the triangles that collapsed
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < result.size(); t += 3)
+		{
+			const uint32_t a = remap[result[t]];
+			const uint32_t b = remap[result[t + 1]];
+			const uint32_t c = remap[result[t + 2]];
+			if (a != b && b != c && a != c)
+			{
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+	}
+
+	resultError = static_cast<float>(std::sqrt(largestCost));
+	return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Import-time index/vertex reordering for better post-transform cache use and less overdraw, and simplification for LODs.
+// All functions operate on a single sub-mesh with indices local to its vertex range.
+namespace MeshOptimizer
+{
+	struct CacheStats
+	{
+		float acmr = 0; // average cache misses per triangle, 0.5 is ideal and 3 the worst
+		float atvr = 0; // average transformed vertices per vertex, 1 is ideal
+	};
+
+	// simulates a FIFO post-transform cache of the given size
+	CacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// reorders triangles for vertex cache locality (Forsyth, linear-speed vertex cache optimisation)
+	void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+	// reorders clusters of triangles so outward facing ones draw first, keeping the cache
+	// efficiency within threshold (e.g. 1.05) of the vertex cache optimized order (Sander et al. 2007)
+	void optimizeOverdraw(std::span<uint32_t> indices, const float *positions, size_t positionStride, size_t vertexCount, float threshold);
+
+	// renumbers vertices in first-use order and rewrites the indices, returns the old -> new remap table
+	std::vector<uint32_t> optimizeVertexFetch(std::span<uint32_t> indices, size_t vertexCount);
+
+	constexpr size_t MaxMeshletVertices = 64;
+	constexpr size_t MaxMeshletTriangles = 124;
+
+	struct Meshlet
+	{
+		uint32_t vertexOffset = 0; // into MeshletData::vertices
+		uint32_t triangleOffset = 0; // into MeshletData::triangles
+		uint32_t vertexCount = 0;
+		uint32_t triangleCount = 0;
+	};
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> vertices; // sub-mesh local vertex indices
+		std::vector<uint32_t> triangles; // three meshlet local 8 bit indices per entry
+	};
+
+	struct MeshletBounds
+	{
+		float center[3]{};
+		float radius = 0;
+		float coneApex[3]{};
+		float coneAxis[3]{};
+		float coneCutoff = 2.0f; // a camera is behind every triangle if dot(normalize(apex - camera), axis) >= cutoff, > 1 never culls
+	};
+
+	// quadric error edge collapse (Garland and Heckbert 1997) down towards targetIndexCount, collapsing vertices onto
+	// their neighbours so the result indexes the same vertex range. Vertices on open or non-manifold edges stay put,
+	// which keeps borders and uv seams intact. Stops early once a collapse would move the surface further than maxError,
+	// resultError is the largest distance any collapse moved it, in the units of the positions
+	std::vector<uint32_t> simplify(std::span<const uint32_t> indices, const float *positions, size_t positionStride, size_t vertexCount,
+		size_t targetIndexCount, float maxError, float &resultError);
+
+	// splits triangles into meshlets greedily in index order, best run after optimizeVertexCache
+	MeshletData buildMeshlets(std::span<const uint32_t> indices, size_t vertexCount);
+
+	// bounding sphere and backface cone, pass allowCone = false for double sided geometry
+	MeshletBounds computeMeshletBounds(const MeshletData &data, const Meshlet &meshlet, const float *positions, size_t positionStride, bool allowCone);
+}
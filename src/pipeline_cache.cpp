@@ -0,0 +1,101 @@
+#include "pipeline_cache.h"
+#include "utils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	constexpr char Magic[8] = { 'V', 'K', 'P', 'C', 'A', 'C', 'H', 'E' };
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version = 0;
+		uint32_t vendorID = 0;
+		uint32_t deviceID = 0;
+		uint32_t driverVersion = 0;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE]{};
+		uint64_t dataSize = 0;
+		uint64_t dataHash = 0; // fnv1a of the blob, catches truncated or corrupt files
+	};
+
+	bool matchesDevice(const FileHeader &header, const VkPhysicalDeviceProperties &properties)
+	{
+		return header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+			header.driverVersion == properties.driverVersion &&
+			std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+}
+
+std::vector<char> PipelineCache::load(const std::string &filePath, const VkPhysicalDeviceProperties &properties)
+{
+	std::vector<char> data = readBinaryFile(filePath);
+	FileHeader header;
+	if (data.size() < sizeof(FileHeader))
+	{
+		return {};
+	}
+	std::memcpy(&header, data.data(), sizeof(FileHeader));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || !matchesDevice(header, properties) ||
+		header.dataSize != data.size() - sizeof(FileHeader) || fnv1a(data.data() + sizeof(FileHeader), header.dataSize) != header.dataHash)
+	{
+		std::cout << "Discarding pipeline cache from another device, driver or version: " << filePath << std::endl;
+		return {};
+	}
+
+	// the driver's own header has to agree as well, some drivers reject mismatches less gracefully than others
+	VkPipelineCacheHeaderVersionOne blobHeader;
+	if (header.dataSize < sizeof(blobHeader))
+	{
+		return {};
+	}
+	std::memcpy(&blobHeader, data.data() + sizeof(FileHeader), sizeof(blobHeader));
+	if (blobHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || blobHeader.vendorID != properties.vendorID ||
+		blobHeader.deviceID != properties.deviceID || std::memcmp(blobHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		return {};
+	}
+	data.erase(data.begin(), data.begin() + sizeof(FileHeader));
+	return data;
+}
+
+bool PipelineCache::store(const std::string &filePath, const VkPhysicalDeviceProperties &properties, std::span<const char> data)
+{
+	FileHeader header
+	{
+		.version = Version,
+		.vendorID = properties.vendorID,
+		.deviceID = properties.deviceID,
+		.driverVersion = properties.driverVersion,
+		.dataSize = data.size(),
+		.dataHash = fnv1a(data.data(), data.size())
+	};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), ec);
+
+	// written to a temporary file first so a crash never leaves a truncated cache behind
+	const std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			std::cerr << "Unable to write pipeline cache: " << filePath << std::endl;
+			return false;
+		}
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		out.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!out.good())
+		{
+			std::cerr << "Error writing pipeline cache: " << filePath << std::endl;
+			return false;
+		}
+	}
+	std::filesystem::rename(tempPath, filePath, ec);
+	return !ec;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// On-disk VkPipelineCache data. The driver blob is wrapped in a header naming the device and
+// driver that produced it, anything written by a different GPU or driver version is discarded.
+namespace PipelineCache
+{
+	// bump whenever the file layout changes
+	constexpr uint32_t Version = 1;
+	constexpr const char *FilePath = "cache/pipelines.bin";
+
+	// driver blob to seed vkCreatePipelineCache with, empty if missing or written by another device or driver
+	std::vector<char> load(const std::string &filePath, const VkPhysicalDeviceProperties &properties);
+	bool store(const std::string &filePath, const VkPhysicalDeviceProperties &properties, std::span<const char> data);
+}
@@ -0,0 +1,554 @@
+#include "render_graph.h"
+#include "gpu_memory.h"
+#include "gpu_profiler.h"
+
+#include <Volk/volk.h>
+#include <vma/vk_mem_alloc.h>
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+static double megabytes(VkDeviceSize bytes)
+{
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::use(Resource resource, Usage usage)
+{
+	graph.passes[pass].accesses.push_back({ .resource = resource, .usage = usage });
+	return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sideEffects()
+{
+	graph.passes[pass].sideEffects = true;
+	return *this;
+}
+
+RenderGraph::UsageInfo RenderGraph::usageInfo(Usage usage)
+{
+	switch (usage)
+	{
+	case Usage::ColorAttachment:
+		return {
+			.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			.writeAccess = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+		};
+	case Usage::DepthAttachment:
+		return {
+			.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.writeAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.layout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL
+		};
+	case Usage::ComputeSampled:
+		return {
+			.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+		};
+	case Usage::ComputeRead:
+		return {
+			.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+			.layout = VK_IMAGE_LAYOUT_GENERAL
+		};
+	case Usage::ComputeWrite:
+		return {
+			.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.writeAccess = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.layout = VK_IMAGE_LAYOUT_GENERAL
+		};
+	case Usage::TransferSource:
+		return {
+			.stages = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.access = VK_ACCESS_2_TRANSFER_READ_BIT,
+			.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		};
+	case Usage::Present:
+	default:
+		// nothing waits for it, the barrier only flushes and transitions
+		return { .layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+	}
+}
+
+VkImageAspectFlags RenderGraph::aspectOf(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+void RenderGraph::initialize(VkDevice device, GpuMemory &memory, std::function<void(std::function<void()>)> deferDeletion)
+{
+	this->device = device;
+	this->memory = &memory;
+	this->deferDeletion = std::move(deferDeletion);
+}
+
+void RenderGraph::shutdown()
+{
+	destroyTransients(false);
+	reset();
+}
+
+void RenderGraph::reset()
+{
+	images.clear();
+	passes.clear();
+	barriers.clear();
+	finalBarriers.clear();
+	compiled = false;
+}
+
+RenderGraph::Resource RenderGraph::importImage(const char *name, const ImportedImage &image)
+{
+	images.push_back({ .name = name, .imported = true, .import = image });
+	return static_cast<Resource>(images.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::createImage(const char *name, const ImageDesc &desc)
+{
+	images.push_back({ .name = name, .desc = desc });
+	return static_cast<Resource>(images.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char *name, PassCallback callback)
+{
+	passes.push_back({ .name = name, .callback = std::move(callback) });
+	return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+void RenderGraph::cullPasses()
+{
+	// backwards from what leaves the frame, imported images and side effects, a pass only lives when
+	// something after it still reads an image it writes
+	std::vector<bool> read(images.size(), false);
+	for (size_t i = passes.size(); i-- > 0;)
+	{
+		Pass &pass = passes[i];
+		pass.live = pass.sideEffects;
+		for (const Access &access : pass.accesses)
+		{
+			pass.live = pass.live || (usageInfo(access.usage).writeAccess && (images[access.resource].imported || read[access.resource]));
+		}
+		if (!pass.live)
+		{
+			continue;
+		}
+		// a write satisfies the reads after it, unless the pass also reads what came before, like an attachment load
+		for (const Access &access : pass.accesses)
+		{
+			const UsageInfo use = usageInfo(access.usage);
+			read[access.resource] = (use.access & ~use.writeAccess) != 0;
+		}
+	}
+}
+
+VkImage RenderGraph::handle(const Image &image) const
+{
+	return image.imported ? image.import.image : transients[image.transient].image;
+}
+
+void RenderGraph::recordAccess(Image &image, const UsageInfo &use, std::vector<VkImageMemoryBarrier2> &out)
+{
+	State &state = image.state;
+	const bool write = use.writeAccess != 0;
+	const bool layoutChange = use.layout != state.layout;
+
+	// transitions and writes wait for every access since the last write, reads only for a write they can't see yet,
+	// a read after a read needs nothing
+	bool needed = layoutChange;
+	VkPipelineStageFlags2 srcStages = VK_PIPELINE_STAGE_2_NONE;
+	if (layoutChange || write)
+	{
+		srcStages = state.writeStages | state.readStages;
+		needed = needed || srcStages != VK_PIPELINE_STAGE_2_NONE;
+	}
+	else if (state.writeStages != VK_PIPELINE_STAGE_2_NONE && (use.stages & ~state.visibleStages) != 0)
+	{
+		srcStages = state.writeStages;
+		needed = true;
+	}
+
+	if (needed)
+	{
+		out.push_back(VkImageMemoryBarrier2
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcStageMask = srcStages,
+			.srcAccessMask = state.writeAccess,
+			.dstStageMask = use.stages,
+			.dstAccessMask = use.access,
+			.oldLayout = state.layout,
+			.newLayout = use.layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = handle(image),
+			.subresourceRange
+			{
+				.aspectMask = image.imported ? image.import.aspect : transients[image.transient].aspect,
+				.levelCount = VK_REMAINING_MIP_LEVELS,
+				.layerCount = VK_REMAINING_ARRAY_LAYERS
+			}
+		});
+	}
+
+	if (write)
+	{
+		state = { .layout = use.layout, .writeStages = use.stages, .writeAccess = use.writeAccess };
+	}
+	else if (layoutChange)
+	{
+		// the transition is a write of its own, only the stages it waited for see it
+		state = { .layout = use.layout, .writeStages = use.stages, .readStages = use.stages, .visibleStages = use.stages };
+	}
+	else
+	{
+		state.readStages |= use.stages;
+		state.visibleStages |= needed ? use.stages : VK_PIPELINE_STAGE_2_NONE;
+	}
+}
+
+bool RenderGraph::allocateTransients()
+{
+	// the transients live passes use, in declaration order, against what is allocated
+	std::vector<uint32_t> used;
+	for (uint32_t i = 0; i < images.size(); ++i)
+	{
+		if (!images[i].imported && images[i].firstUse != UINT32_MAX)
+		{
+			used.push_back(i);
+		}
+	}
+	bool unchanged = used.size() == transients.size();
+	for (size_t i = 0; unchanged && i < used.size(); ++i)
+	{
+		const Image &image = images[used[i]];
+		const Transient &transient = transients[i];
+		unchanged = image.name == transient.name && image.desc == transient.desc &&
+			image.firstUse == transient.firstUse && image.lastUse == transient.lastUse;
+	}
+	if (unchanged)
+	{
+		for (uint32_t i = 0; i < used.size(); ++i)
+		{
+			images[used[i]].transient = i;
+		}
+		return true;
+	}
+
+	// the frames in flight may still render into the old ones
+	destroyTransients(true);
+	for (uint32_t i = 0; i < used.size(); ++i)
+	{
+		Image &image = images[used[i]];
+		image.transient = i;
+		Transient &transient = transients.emplace_back(Transient
+		{
+			.name = image.name,
+			.desc = image.desc,
+			.firstUse = image.firstUse,
+			.lastUse = image.lastUse,
+			.aspect = aspectOf(image.desc.format)
+		});
+		VkImageCreateInfo imageInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = image.desc.format,
+			.extent{.width = image.desc.extent.width, .height = image.desc.extent.height, .depth = 1 },
+			.mipLevels = image.desc.mipLevels,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = image.desc.usage,
+			.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+		};
+		if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS)
+		{
+			std::cerr << "Unable to create the " << image.name << " render target" << std::endl;
+			destroyTransients(false);
+			return false;
+		}
+		vkGetImageMemoryRequirements(device, transient.image, &transient.requirements);
+	}
+
+	// largest first, each goes into the first allocation it fits whose other occupants are never live at the
+	// same time, the allocation grows to the largest of them
+	std::vector<uint32_t> order(transients.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return transients[a].requirements.size > transients[b].requirements.size; });
+	std::vector<std::vector<uint32_t>> occupants;
+	for (uint32_t index : order)
+	{
+		Transient &transient = transients[index];
+		uint32_t binIndex = 0;
+		for (; binIndex < bins.size(); ++binIndex)
+		{
+			const bool compatible = (bins[binIndex].requirements.memoryTypeBits & transient.requirements.memoryTypeBits) != 0;
+			const bool disjoint = std::none_of(occupants[binIndex].begin(), occupants[binIndex].end(), [&](uint32_t other)
+			{
+				return transients[other].firstUse <= transient.lastUse && transient.firstUse <= transients[other].lastUse;
+			});
+			if (compatible && disjoint)
+			{
+				break;
+			}
+		}
+		if (binIndex == bins.size())
+		{
+			bins.push_back({ .requirements = transient.requirements });
+			occupants.emplace_back();
+		}
+		Bin &bin = bins[binIndex];
+		bin.requirements.size = std::max(bin.requirements.size, transient.requirements.size);
+		bin.requirements.alignment = std::max(bin.requirements.alignment, transient.requirements.alignment);
+		bin.requirements.memoryTypeBits &= transient.requirements.memoryTypeBits;
+		occupants[binIndex].push_back(index);
+		transient.bin = binIndex;
+	}
+
+	VkDeviceSize requestedBytes = 0;
+	VkDeviceSize allocatedBytes = 0;
+	for (const Transient &transient : transients)
+	{
+		requestedBytes += transient.requirements.size;
+	}
+	for (Bin &bin : bins)
+	{
+		// automatic usage needs the resource itself, several images share this one
+		VmaAllocationCreateInfo allocInfo{ .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+		if (!memory->allocateMemory(GpuMemory::RenderTargets, bin.requirements, allocInfo, bin.allocation))
+		{
+			destroyTransients(false);
+			return false;
+		}
+		allocatedBytes += bin.requirements.size;
+	}
+
+	for (Transient &transient : transients)
+	{
+		if (vmaBindImageMemory(memory->handle(), bins[transient.bin].allocation, transient.image) != VK_SUCCESS)
+		{
+			std::cerr << "Unable to bind the " << transient.name << " render target" << std::endl;
+			destroyTransients(false);
+			return false;
+		}
+		VkImageViewCreateInfo viewInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.image = transient.image,
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = transient.desc.format,
+			.subresourceRange{.aspectMask = transient.aspect, .levelCount = transient.desc.mipLevels, .layerCount = 1}
+		};
+		bool created = vkCreateImageView(device, &viewInfo, nullptr, &transient.view) == VK_SUCCESS;
+		for (uint32_t level = 0; created && transient.desc.mipLevels > 1 && level < transient.desc.mipLevels; ++level)
+		{
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+			created = vkCreateImageView(device, &viewInfo, nullptr, &transient.levelViews.emplace_back()) == VK_SUCCESS;
+		}
+		if (!created)
+		{
+			std::cerr << "Unable to create the " << transient.name << " render target views" << std::endl;
+			destroyTransients(false);
+			return false;
+		}
+	}
+
+	std::cout << "Render graph: " << transients.size() << " transient images in " << bins.size() << " allocations, "
+		<< megabytes(allocatedBytes) << " MB instead of " << megabytes(requestedBytes) << " MB" << std::endl;
+	return true;
+}
+
+void RenderGraph::destroyTransients(bool deferred)
+{
+	if (transients.empty() && bins.empty())
+	{
+		return;
+	}
+	std::function<void()> destroy = [device = device, memory = memory, transients = std::move(transients), bins = std::move(bins)]()
+	{
+		for (const Transient &transient : transients)
+		{
+			for (VkImageView levelView : transient.levelViews)
+			{
+				vkDestroyImageView(device, levelView, nullptr);
+			}
+			vkDestroyImageView(device, transient.view, nullptr);
+			vkDestroyImage(device, transient.image, nullptr);
+		}
+		for (const Bin &bin : bins)
+		{
+			memory->freeMemory(bin.allocation);
+		}
+	};
+	transients.clear();
+	bins.clear();
+	if (deferred && deferDeletion)
+	{
+		deferDeletion(std::move(destroy));
+	}
+	else
+	{
+		destroy();
+	}
+}
+
+bool RenderGraph::compile()
+{
+	cullPasses();
+
+	uint32_t livePass = 0;
+	for (const Pass &pass : passes)
+	{
+		if (!pass.live)
+		{
+			continue;
+		}
+		for (const Access &access : pass.accesses)
+		{
+			Image &image = images[access.resource];
+			image.firstUse = std::min(image.firstUse, livePass);
+			image.lastUse = livePass;
+		}
+		++livePass;
+	}
+
+	// without render targets only the imported images are transitioned, and the frame draws nothing
+	const bool allocated = allocateTransients();
+	if (!allocated)
+	{
+		for (Pass &pass : passes)
+		{
+			pass.live = false;
+		}
+	}
+
+	for (Image &image : images)
+	{
+		if (image.imported)
+		{
+			image.state = { .layout = image.import.initialLayout, .writeStages = image.import.readyStages };
+		}
+	}
+
+	livePass = 0;
+	for (Pass &pass : passes)
+	{
+		if (!pass.live)
+		{
+			continue;
+		}
+		pass.firstBarrier = static_cast<uint32_t>(barriers.size());
+		for (const Access &access : pass.accesses)
+		{
+			Image &image = images[access.resource];
+			if (image.imported)
+			{
+				recordAccess(image, usageInfo(access.usage), barriers);
+				continue;
+			}
+
+			// the first use waits for whatever last used the memory, an earlier occupant or the previous frame
+			Bin &bin = bins[transients[image.transient].bin];
+			if (image.firstUse == livePass && image.state.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+			{
+				image.state = { .writeStages = bin.stages, .writeAccess = bin.writeAccess };
+			}
+			recordAccess(image, usageInfo(access.usage), barriers);
+			bin.stages = image.state.writeStages | image.state.readStages;
+			bin.writeAccess = image.state.writeAccess;
+		}
+		pass.barrierCount = static_cast<uint32_t>(barriers.size()) - pass.firstBarrier;
+		++livePass;
+	}
+
+	for (Image &image : images)
+	{
+		if (image.imported)
+		{
+			// the final layout is all that matters, whatever follows the frame waits on a semaphore
+			recordAccess(image, { .layout = usageInfo(image.import.finalUsage).layout }, finalBarriers);
+		}
+	}
+	compiled = true;
+	return allocated;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, GpuProfiler &profiler)
+{
+	if (!compiled)
+	{
+		return;
+	}
+	for (const Pass &pass : passes)
+	{
+		if (!pass.live)
+		{
+			continue;
+		}
+		profiler.beginScope(commandBuffer, pass.name.c_str());
+		if (pass.barrierCount > 0)
+		{
+			VkDependencyInfo dependencyInfo
+			{
+				.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+				.imageMemoryBarrierCount = pass.barrierCount,
+				.pImageMemoryBarriers = barriers.data() + pass.firstBarrier
+			};
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		}
+		pass.callback(commandBuffer);
+		profiler.endScope(commandBuffer);
+	}
+	if (!finalBarriers.empty())
+	{
+		VkDependencyInfo dependencyInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = static_cast<uint32_t>(finalBarriers.size()),
+			.pImageMemoryBarriers = finalBarriers.data()
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	}
+}
+
+VkImageView RenderGraph::view(Resource resource) const
+{
+	if (resource >= images.size())
+	{
+		return nullptr;
+	}
+	const Image &image = images[resource];
+	if (image.imported)
+	{
+		return image.import.view;
+	}
+	return image.transient < transients.size() ? transients[image.transient].view : nullptr;
+}
+
+VkImageView RenderGraph::levelView(Resource resource, uint32_t level) const
+{
+	if (resource >= images.size() || images[resource].imported || images[resource].transient >= transients.size())
+	{
+		return view(resource);
+	}
+	const Transient &transient = transients[images[resource].transient];
+	return level < transient.levelViews.size() ? transient.levelViews[level] : transient.view;
+}
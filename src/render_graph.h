@@ -0,0 +1,190 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+class GpuMemory;
+class GpuProfiler;
+struct VmaAllocation_T;
+typedef struct VmaAllocation_T *VmaAllocation;
+
+// The passes of a frame over the images they declare. The graph is rebuilt every frame: passes are added
+// in submission order along with how they use each image, compile() drops the passes nothing visible
+// consumes and tracks every image's layout and last accesses, and execute() records a single merged
+// barrier batch in front of each pass that needs one. Imported images, like the swapchain image, start
+// each frame from a given layout and finish in their final one. Transient images belong to the graph and
+// are only recreated when their descriptions or lifetimes change, those whose lifetimes within the frame
+// don't overlap share one allocation, so render target memory follows the peak of live targets rather
+// than their number. Every frame in flight uses the same transients, frames are ordered on one queue.
+class RenderGraph
+{
+public:
+	using Resource = uint32_t;
+	constexpr static Resource NoResource{ UINT32_MAX };
+
+	enum class Usage : uint32_t
+	{
+		ColorAttachment, // read and written, loads count as reads
+		DepthAttachment,
+		ComputeSampled, // shader read only layout
+		ComputeRead, // general layout, sampled or storage reads
+		ComputeWrite, // general layout, storage writes and reads
+		TransferSource,
+		Present, // final usage only
+		UsageCount
+	};
+
+	struct ImageDesc
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{ 0, 0 };
+		uint32_t mipLevels = 1; // a view per level is created next to the full one when there is more than one
+		VkImageUsageFlags usage = 0;
+
+		bool operator==(const ImageDesc &other) const
+		{
+			return format == other.format && extent.width == other.extent.width && extent.height == other.extent.height &&
+				mipLevels == other.mipLevels && usage == other.usage;
+		}
+	};
+
+	struct ImportedImage
+	{
+		VkImage image = nullptr;
+		VkImageView view = nullptr;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // contents are discarded when undefined
+		VkPipelineStageFlags2 readyStages = VK_PIPELINE_STAGE_2_NONE; // the stages a semaphore wait made it available to
+		Usage finalUsage = Usage::Present;
+	};
+
+	using PassCallback = std::function<void(VkCommandBuffer commandBuffer)>;
+
+	class PassBuilder
+	{
+		RenderGraph &graph;
+		uint32_t pass;
+
+	public:
+		PassBuilder(RenderGraph &graph, uint32_t pass) : graph(graph), pass(pass) {}
+		PassBuilder &use(Resource resource, Usage usage);
+		// kept even when nothing reads what it writes, for passes that produce buffers the graph doesn't track
+		PassBuilder &sideEffects();
+	};
+
+private:
+	struct UsageInfo
+	{
+		VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 access = VK_ACCESS_2_NONE;
+		VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE; // the write part of access
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	// what the barriers in front of the next access have to wait for
+	struct State
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE; // of the last write or layout transition
+		VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE; // reads since then
+		VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE; // reads that already waited for it
+	};
+
+	struct Access
+	{
+		Resource resource = NoResource;
+		Usage usage = Usage::ColorAttachment;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		PassCallback callback;
+		std::vector<Access> accesses;
+		bool sideEffects = false;
+		bool live = false;
+		uint32_t firstBarrier = 0;
+		uint32_t barrierCount = 0;
+	};
+
+	// per frame, transient ones point into transients once compiled
+	struct Image
+	{
+		std::string name;
+		bool imported = false;
+		ImportedImage import;
+		ImageDesc desc;
+		uint32_t transient = UINT32_MAX;
+		uint32_t firstUse = UINT32_MAX; // live pass indices
+		uint32_t lastUse = 0;
+		State state;
+	};
+
+	// kept across frames
+	struct Transient
+	{
+		std::string name;
+		ImageDesc desc;
+		uint32_t firstUse = 0;
+		uint32_t lastUse = 0;
+		VkImage image = nullptr;
+		VkImageView view = nullptr;
+		std::vector<VkImageView> levelViews;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		VkMemoryRequirements requirements{};
+		uint32_t bin = 0;
+	};
+
+	// one allocation shared by transients that are never live at the same time, the stages and access are
+	// those of its latest occupant, what the next one's first barrier has to wait for
+	struct Bin
+	{
+		VmaAllocation allocation = nullptr;
+		VkMemoryRequirements requirements{};
+		VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+	};
+
+	VkDevice device = nullptr;
+	GpuMemory *memory = nullptr;
+	std::function<void(std::function<void()>)> deferDeletion; // until the frames in flight are done with it
+
+	std::vector<Image> images;
+	std::vector<Pass> passes;
+	std::vector<VkImageMemoryBarrier2> barriers;
+	std::vector<VkImageMemoryBarrier2> finalBarriers;
+	std::vector<Transient> transients;
+	std::vector<Bin> bins;
+	bool compiled = false;
+
+	static UsageInfo usageInfo(Usage usage);
+	static VkImageAspectFlags aspectOf(VkFormat format);
+	void cullPasses();
+	bool allocateTransients();
+	void destroyTransients(bool deferred);
+	VkImage handle(const Image &image) const;
+	void recordAccess(Image &image, const UsageInfo &use, std::vector<VkImageMemoryBarrier2> &out);
+
+public:
+	void initialize(VkDevice device, GpuMemory &memory, std::function<void(std::function<void()>)> deferDeletion);
+	void shutdown();
+
+	// starts declaring a new frame, the resources of the last one are no longer valid
+	void reset();
+	Resource importImage(const char *name, const ImportedImage &image);
+	Resource createImage(const char *name, const ImageDesc &desc);
+	PassBuilder addPass(const char *name, PassCallback callback);
+
+	// culls, allocates transients when they changed and works out the barriers, false if allocating failed
+	bool compile();
+	// records the live passes, each inside a profiler scope of its name
+	void execute(VkCommandBuffer commandBuffer, GpuProfiler &profiler);
+
+	// valid from compile() until the next reset(), null for an image no live pass uses
+	VkImageView view(Resource resource) const;
+	VkImageView levelView(Resource resource, uint32_t level) const;
+};
@@ -0,0 +1,72 @@
+#include "scene.h"
+
+#include <algorithm>
+
+void Scene::clear()
+{
+	parents.clear();
+	subtreeEnds.clear();
+	meshIndices.clear();
+	localTransforms.clear();
+	worldTransforms.clear();
+	dirty.clear();
+	dirtyBegin = UINT32_MAX;
+	dirtyEnd = 0;
+}
+
+uint32_t Scene::addNode(uint32_t parent, const glm::mat4 &localTransform, int32_t meshIndex)
+{
+	const uint32_t node = static_cast<uint32_t>(parents.size());
+	parents.push_back(parent);
+	subtreeEnds.push_back(node + 1);
+	meshIndices.push_back(meshIndex);
+	localTransforms.push_back(localTransform);
+	worldTransforms.push_back(localTransform);
+	dirty.push_back(1);
+
+	// every ancestor's subtree now extends up to this node
+	for (uint32_t ancestor = parent; ancestor != NoParent; ancestor = parents[ancestor])
+	{
+		subtreeEnds[ancestor] = node + 1;
+	}
+
+	dirtyBegin = std::min(dirtyBegin, node);
+	dirtyEnd = node + 1;
+	return node;
+}
+
+void Scene::setLocalTransform(uint32_t node, const glm::mat4 &localTransform)
+{
+	localTransforms[node] = localTransform;
+	dirty[node] = 1;
+	dirtyBegin = std::min(dirtyBegin, node);
+	dirtyEnd = std::max(dirtyEnd, subtreeEnds[node]);
+}
+
+std::pair<uint32_t, uint32_t> Scene::update()
+{
+	if (dirtyBegin >= dirtyEnd)
+	{
+		return { 0, 0 };
+	}
+
+	// parents come first, so a dirty flag reaches the whole subtree within the same pass
+	for (uint32_t i = dirtyBegin; i < dirtyEnd; ++i)
+	{
+		const uint32_t parent = parents[i];
+		if (parent != NoParent && dirty[parent])
+		{
+			dirty[i] = 1;
+		}
+		if (dirty[i])
+		{
+			worldTransforms[i] = parent == NoParent ? localTransforms[i] : worldTransforms[parent] * localTransforms[i];
+		}
+	}
+	std::fill(dirty.begin() + dirtyBegin, dirty.begin() + dirtyEnd, 0);
+
+	const std::pair<uint32_t, uint32_t> updated{ dirtyBegin, dirtyEnd };
+	dirtyBegin = UINT32_MAX;
+	dirtyEnd = 0;
+	return updated;
+}
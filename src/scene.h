@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Flattened transform hierarchy. Nodes are stored in pre-order as structure-of-arrays, so a
+// parent always precedes its children and every subtree is one contiguous range. World matrices
+// are recomputed in a single linear pass over the dirty range only.
+class Scene
+{
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> subtreeEnds; // one past the last descendant
+	std::vector<int32_t> meshIndices;
+	std::vector<glm::mat4> localTransforms;
+	std::vector<glm::mat4> worldTransforms;
+	std::vector<uint8_t> dirty;
+	uint32_t dirtyBegin = UINT32_MAX;
+	uint32_t dirtyEnd = 0;
+
+public:
+	constexpr static uint32_t NoParent{ UINT32_MAX };
+
+	void clear();
+
+	// nodes must be added in pre-order, i.e. the parent and the full subtrees of earlier siblings first
+	uint32_t addNode(uint32_t parent, const glm::mat4 &localTransform, int32_t meshIndex);
+
+	size_t size() const { return parents.size(); }
+	uint32_t parent(uint32_t node) const { return parents[node]; }
+	int32_t meshIndex(uint32_t node) const { return meshIndices[node]; }
+	const glm::mat4 &localTransform(uint32_t node) const { return localTransforms[node]; }
+	std::span<const glm::mat4> worlds() const { return worldTransforms; }
+
+	// marks the node and its subtree for the next update
+	void setLocalTransform(uint32_t node, const glm::mat4 &localTransform);
+
+	// recomputes dirty world matrices, returns the [begin, end) node range that was rewritten
+	std::pair<uint32_t, uint32_t> update();
+};
@@ -0,0 +1,146 @@
+#include "shader_cache.h"
+#include "utils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <format>
+#include <iostream>
+
+namespace
+{
+	constexpr char Magic[8] = { 'V', 'K', 'S', 'P', 'I', 'R', 'V', '0' };
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version = 0;
+		uint32_t dependencyCount = 0;
+		uint64_t compileKey = 0;
+		uint64_t codeWords = 0;
+	};
+
+	// followed by pathLength bytes of path
+	struct DependencyRecord
+	{
+		uint64_t hash = 0;
+		uint32_t pathLength = 0;
+		uint32_t padding = 0;
+	};
+}
+
+std::string ShaderCache::variantName(const std::string &shaderName, const std::vector<std::string> &defines)
+{
+	std::string name = shaderName;
+	for (const std::string &define : defines)
+	{
+		name += "." + define;
+	}
+	return name;
+}
+
+std::string ShaderCache::cachePath(const std::string &variantName, uint64_t compileKey)
+{
+	return std::format("cache/shaders/{}-{:016x}.spv", variantName, compileKey);
+}
+
+bool ShaderCache::load(const std::string &filePath, uint64_t compileKey, std::vector<uint32_t> &spirv)
+{
+	const std::vector<char> data = readBinaryFile(filePath);
+	FileHeader header;
+	if (data.size() < sizeof(FileHeader))
+	{
+		return false;
+	}
+	std::memcpy(&header, data.data(), sizeof(FileHeader));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version || header.compileKey != compileKey)
+	{
+		return false;
+	}
+
+	// includes are re-read and hashed, which is far cheaper than preprocessing the shader
+	size_t offset = sizeof(FileHeader);
+	for (uint32_t i = 0; i < header.dependencyCount; ++i)
+	{
+		DependencyRecord record;
+		if (offset + sizeof(DependencyRecord) > data.size())
+		{
+			return false;
+		}
+		std::memcpy(&record, data.data() + offset, sizeof(DependencyRecord));
+		offset += sizeof(DependencyRecord);
+		if (offset + record.pathLength > data.size())
+		{
+			return false;
+		}
+		const std::string path(data.data() + offset, record.pathLength);
+		offset += record.pathLength;
+
+		const std::string contents = readTextFile(path);
+		if (contents.empty() || fnv1a(contents.data(), contents.size()) != record.hash)
+		{
+			return false;
+		}
+	}
+
+	if (header.codeWords == 0 || offset + header.codeWords * sizeof(uint32_t) != data.size())
+	{
+		return false;
+	}
+	spirv.resize(header.codeWords);
+	std::memcpy(spirv.data(), data.data() + offset, header.codeWords * sizeof(uint32_t));
+	return true;
+}
+
+bool ShaderCache::store(const std::string &filePath, uint64_t compileKey, const std::vector<Dependency> &dependencies, const std::vector<uint32_t> &spirv)
+{
+	FileHeader header
+	{
+		.version = Version,
+		.dependencyCount = static_cast<uint32_t>(dependencies.size()),
+		.compileKey = compileKey,
+		.codeWords = spirv.size()
+	};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), ec);
+
+	// written to a temporary file first so a crash never leaves a truncated entry behind
+	const std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			std::cerr << "Unable to write shader cache: " << filePath << std::endl;
+			return false;
+		}
+		out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		for (const Dependency &dependency : dependencies)
+		{
+			const DependencyRecord record{ .hash = dependency.hash, .pathLength = static_cast<uint32_t>(dependency.path.size()) };
+			out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+			out.write(dependency.path.data(), static_cast<std::streamsize>(dependency.path.size()));
+		}
+		out.write(reinterpret_cast<const char *>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+		if (!out.good())
+		{
+			std::cerr << "Error writing shader cache: " << filePath << std::endl;
+			return false;
+		}
+	}
+	std::filesystem::rename(tempPath, filePath, ec);
+	return !ec;
+}
+
+bool ShaderCache::readSpirv(const std::string &filePath, std::vector<uint32_t> &spirv)
+{
+	const std::vector<char> data = readBinaryFile(filePath);
+	if (data.empty() || data.size() % sizeof(uint32_t) != 0)
+	{
+		return false;
+	}
+	spirv.resize(data.size() / sizeof(uint32_t));
+	std::memcpy(spirv.data(), data.data(), data.size());
+	return true;
+}
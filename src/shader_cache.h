@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk cache of compiled SPIR-V. An entry is keyed on the shader source and its compile
+// options, and lists every included file with a hash of its contents so an edited include
+// invalidates it without running the preprocessor. A warm cache never touches shaderc.
+namespace ShaderCache
+{
+	// bump whenever the file layout or the compiler setup behind the key changes
+	constexpr uint32_t Version = 1;
+
+	struct Dependency
+	{
+		std::string path;
+		uint64_t hash = 0; // fnv1a of the file contents
+	};
+
+	// shader file name plus one suffix per define, shared with the build time precompile step
+	std::string variantName(const std::string &shaderName, const std::vector<std::string> &defines);
+	std::string cachePath(const std::string &variantName, uint64_t compileKey);
+
+	// fails on a missing or stale entry, or when any dependency changed since it was stored
+	bool load(const std::string &filePath, uint64_t compileKey, std::vector<uint32_t> &spirv);
+	bool store(const std::string &filePath, uint64_t compileKey, const std::vector<Dependency> &dependencies, const std::vector<uint32_t> &spirv);
+
+	// plain .spv file as written by glslc
+	bool readSpirv(const std::string &filePath, std::vector<uint32_t> &spirv);
+}
@@ -0,0 +1,62 @@
+// frustum tests in the space of the matrix the planes are extracted from
+
+void frustumPlanes(mat4 mvp, out vec4 planes[6])
+{
+    mat4 m = transpose(mvp);
+    planes[0] = m[3] + m[0];
+    planes[1] = m[3] - m[0];
+    planes[2] = m[3] + m[1];
+    planes[3] = m[3] - m[1];
+    planes[4] = m[2]; // depth is [0, 1]
+    planes[5] = m[3] - m[2];
+}
+
+bool sphereVisible(vec4 planes[6], vec3 center, float radius)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius * length(planes[i].xyz))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool aabbVisible(vec4 planes[6], vec3 boundsMin, vec3 boundsMax)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        // the corner furthest along the plane normal
+        vec3 corner = mix(boundsMin, boundsMax, step(vec3(0), planes[i].xyz));
+        if (dot(planes[i].xyz, corner) + planes[i].w < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// screen rectangle (min uv, max uv) and nearest depth of a box, false when part of it lies in front of
+// the near plane, where the projection can't bound it and the box has to count as visible
+bool projectBox(mat4 mvp, vec3 boundsMin, vec3 boundsMax, out vec4 rect, out float nearestDepth)
+{
+    rect = vec4(1.0, 1.0, 0.0, 0.0);
+    nearestDepth = 1.0;
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = mix(boundsMin, boundsMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = mvp * vec4(corner, 1.0);
+        if (clip.z < 0.0)
+        {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        rect.xy = min(rect.xy, uv);
+        rect.zw = max(rect.zw, uv);
+        nearestDepth = min(nearestDepth, ndc.z);
+    }
+    rect = clamp(rect, 0.0, 1.0);
+    return true;
+}
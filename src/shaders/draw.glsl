@@ -0,0 +1,36 @@
+// per draw metadata, indexed by gl_InstanceIndex or the instance stream in the vertex shader
+// requires GL_EXT_buffer_reference and GL_EXT_scalar_block_layout
+
+#define INDEX_TYPE_UINT16 0
+#define INDEX_TYPE_UINT32 1
+
+struct DrawData
+{
+    vec3 boundsMin;
+    uint indexCount;
+    vec3 boundsMax;
+    uint firstIndex;
+    int vertexOffset;
+    uint indexType;
+    uint transformIndex;
+    uint materialIndex;
+    uint lodStart; // into the LOD table, lodCount coarser levels follow the full detail range
+    uint lodCount;
+};
+
+layout(buffer_reference, scalar) readonly buffer DrawDataPtr
+{
+    DrawData draws[];
+};
+
+// instanced CPU draws, the draw index of each instance, grouped by the batch drawing them
+layout(buffer_reference, scalar) readonly buffer InstancePtr
+{
+    uint drawIndices[];
+};
+
+// scene node world matrices, indexed by DrawData.transformIndex
+layout(buffer_reference, scalar) readonly buffer TransformPtr
+{
+    mat4 transforms[];
+};
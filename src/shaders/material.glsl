@@ -0,0 +1,17 @@
+// material table and bindless textures shared by the geometry stages and the fragment shader
+// requires GL_EXT_buffer_reference and GL_EXT_scalar_block_layout
+
+#define NO_TEXTURE 0xffffffffu
+
+struct Material
+{
+    vec4 baseColorFactor;
+    uint baseColorTexture; // slot in the bindless texture array, NO_TEXTURE for none
+    float alphaCutoff; // 0 for opaque materials
+    uint padding[2];
+};
+
+layout(buffer_reference, scalar) readonly buffer MaterialPtr
+{
+    Material materials[];
+};
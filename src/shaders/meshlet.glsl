@@ -0,0 +1,62 @@
+// meshlet data and push constants shared by meshlet.task and meshlet.mesh
+// requires GL_EXT_buffer_reference, GL_EXT_scalar_block_layout and 64 bit integers
+
+#define TASK_GROUP_SIZE 32
+
+struct Meshlet
+{
+    vec3 center;
+    float radius;
+    vec3 coneApex;
+    float coneCutoff; // > 1 disables cone culling
+    vec3 coneAxis;
+    uint subMeshIndex;
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+
+layout(buffer_reference, scalar) readonly buffer MeshletPtr
+{
+    Meshlet meshlets[];
+};
+
+layout(buffer_reference, scalar) readonly buffer IndexPtr
+{
+    uint indices[];
+};
+
+// up to TASK_GROUP_SIZE meshlets of one draw, culled by a single task workgroup
+struct TaskGroup
+{
+    uint drawIndex;
+    uint meshletStart;
+    uint meshletCount;
+};
+
+layout(buffer_reference, scalar) readonly buffer TaskGroupPtr
+{
+    TaskGroup groups[];
+};
+
+layout(push_constant, scalar) uniform MeshletConstants
+{
+    uint64_t vertexAddress;
+    uint64_t meshletAddress;
+    uint64_t meshletDataAddress; // meshlet vertex indices followed by packed triangles
+    uint64_t drawDataAddress;
+    uint64_t transformAddress;
+    uint64_t taskGroupAddress;
+    uint64_t materialAddress;
+    mat4 viewProj;
+    vec3 cameraPosition; // world space
+    uint groupBase;
+} meshletConsts;
+
+// surviving meshlets of one task workgroup
+struct TaskPayload
+{
+    uint drawIndex;
+    uint meshletIndices[TASK_GROUP_SIZE];
+};
@@ -1,11 +1,34 @@
 #version 460
 
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define NO_TEXTURE 0xffffffffu // matches material.glsl
+
+// bindless textures, the slot comes from the draw's material
+layout(set = 0, binding = 0) uniform sampler textureSampler;
+layout(set = 0, binding = 1) uniform texture2D textures[];
+
+layout(location = 0) in vec2 inUv;
+layout(location = 1) flat in vec4 inBaseColor;
+layout(location = 2) flat in uint inTexture;
+layout(location = 3) flat in float inAlphaCutoff;
+
 // output to the first color attachment (swapchain)
-layout(location = 0) in vec3 inColor;
 layout(location = 0) out vec4 fragColor;
 
 void main()
 {
+	// neighbouring fragments can belong to different draws, so the index isn't dynamically uniform
+	vec4 color = inBaseColor;
+	if (inTexture != NO_TEXTURE)
+	{
+		color *= texture(sampler2D(textures[nonuniformEXT(inTexture)], textureSampler), inUv);
+	}
+	if (color.a < inAlphaCutoff)
+	{
+		discard;
+	}
+
 	float brightness = 1.0 - gl_FragCoord.z;
-	fragColor = vec4(inColor * brightness, 1.0);
-}
\ No newline at end of file
+	fragColor = vec4(color.rgb * brightness, 1.0);
+}
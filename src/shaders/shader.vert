@@ -8,32 +8,41 @@
 #define M_PI 3.1415926535897932384626433832795
 #define M_2PI M_PI * 2
 
-layout (location = 0) out vec3 outColor;
+layout (location = 0) out vec2 outUv;
+layout (location = 1) flat out vec4 outBaseColor;
+layout (location = 2) flat out uint outTexture;
+layout (location = 3) flat out float outAlphaCutoff;
 
-struct Vertex
-{
-    vec3 position;
-    vec2 uv;
-};
-
-layout(buffer_reference, scalar) readonly buffer VertexPtr
-{
-    Vertex vertices[];
-};
+#include "vertex.glsl"
+#include "draw.glsl"
+#include "material.glsl"
 
 layout(push_constant, scalar) uniform DrawConstants
 {
     uint64_t vertexAddress;
+    uint64_t drawDataAddress;
+    uint64_t transformAddress;
+    uint64_t materialAddress;
+    uint64_t instanceAddress;
     float globalTime;
     float padding;
-    mat4 mvp;
+    mat4 viewProj;
 } drawConsts;
 
 void main()
 {
     VertexPtr vBuffer = VertexPtr(drawConsts.vertexAddress);
-    vec3 pos = vBuffer.vertices[gl_VertexIndex].position;
-    gl_Position = drawConsts.mvp * vec4(pos, 1.0);
-
-    outColor = vec3(1, 1, 1);
+    // instanced batches go through the instance stream, every other draw passes its index as firstInstance
+    uint drawIndex = drawConsts.instanceAddress != 0 ? InstancePtr(drawConsts.instanceAddress).drawIndices[gl_InstanceIndex] : gl_InstanceIndex;
+    DrawData draw = DrawDataPtr(drawConsts.drawDataAddress).draws[drawIndex];
+    vec3 pos = vertexPosition(vBuffer, gl_VertexIndex, vec4(draw.boundsMin, 0), vec4(draw.boundsMax - draw.boundsMin, 0));
+    mat4 world = TransformPtr(drawConsts.transformAddress).transforms[draw.transformIndex];
+    gl_Position = drawConsts.viewProj * world * vec4(pos, 1.0);
+
+    // the material is constant per draw, handed over flat so the fragment shader needs no push constants
+    Material material = MaterialPtr(drawConsts.materialAddress).materials[draw.materialIndex];
+    outUv = vertexUv(vBuffer, gl_VertexIndex);
+    outBaseColor = material.baseColorFactor;
+    outTexture = material.baseColorTexture;
+    outAlphaCutoff = material.alphaCutoff;
 }
\ No newline at end of file
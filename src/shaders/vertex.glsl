@@ -0,0 +1,43 @@
+// vertex layout shared by the vertex and mesh shaders
+// requires GL_EXT_buffer_reference and GL_EXT_scalar_block_layout
+
+#ifdef COMPACT_VERTEX
+// unorm16 xyz (w unused) relative to the sub-mesh bounds, half float uv
+struct Vertex
+{
+    uint positionXY;
+    uint positionZW;
+    uint uv;
+};
+#else
+struct Vertex
+{
+    vec3 position;
+    vec2 uv;
+};
+#endif
+
+layout(buffer_reference, scalar) readonly buffer VertexPtr
+{
+    Vertex vertices[];
+};
+
+vec3 vertexPosition(VertexPtr vBuffer, uint index, vec4 boundsMin, vec4 boundsExtent)
+{
+#ifdef COMPACT_VERTEX
+    Vertex v = vBuffer.vertices[index];
+    vec3 normalized = vec3(unpackUnorm2x16(v.positionXY), unpackUnorm2x16(v.positionZW).x);
+    return boundsMin.xyz + normalized * boundsExtent.xyz;
+#else
+    return vBuffer.vertices[index].position;
+#endif
+}
+
+vec2 vertexUv(VertexPtr vBuffer, uint index)
+{
+#ifdef COMPACT_VERTEX
+    return unpackHalf2x16(vBuffer.vertices[index].uv);
+#else
+    return vBuffer.vertices[index].uv;
+#endif
+}
@@ -0,0 +1,229 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+void TextureStreamer::initialize(std::vector<Source> sources)
+{
+	shutdown();
+	textures.clear();
+	committedBytes = 0;
+	for (const Source &source : sources)
+	{
+		Texture texture{ .source = source };
+		while (texture.tailMip + 1 < source.mipLevels && (std::max(source.width, source.height) >> texture.tailMip) > ResidentTailSize)
+		{
+			++texture.tailMip;
+		}
+		texture.residentMip = texture.wantedMip = texture.tailMip;
+		committedBytes += residentSize(texture, texture.tailMip);
+		textures.push_back(texture);
+	}
+	if (!textures.empty())
+	{
+		loader = std::jthread([this](std::stop_token stopToken) { loaderLoop(stopToken); });
+	}
+}
+
+void TextureStreamer::shutdown()
+{
+	loader = std::jthread();
+	requests.clear();
+	completed.clear();
+	loadsInFlight = 0;
+}
+
+size_t TextureStreamer::levelOffset(uint32_t width, uint32_t height, uint32_t level)
+{
+	size_t offset = 0;
+	for (uint32_t i = 0; i < level; ++i)
+	{
+		offset += static_cast<size_t>(std::max(1u, width >> i)) * std::max(1u, height >> i) * 4;
+	}
+	return offset;
+}
+
+size_t TextureStreamer::residentSize(const Texture &texture, uint32_t firstMip)
+{
+	const Source &source = texture.source;
+	return levelOffset(source.width, source.height, source.mipLevels) - levelOffset(source.width, source.height, firstMip);
+}
+
+void TextureStreamer::loaderLoop(std::stop_token stopToken)
+{
+	while (true)
+	{
+		Request next;
+		{
+			std::unique_lock lock(mutex);
+			if (!wake.wait(lock, stopToken, [this]() { return !requests.empty(); }))
+			{
+				return;
+			}
+			next = requests.front();
+			requests.pop_front();
+		}
+
+		// copying the levels is what faults their pages of the mapping in, the I/O this thread keeps off the frame
+		const Source &source = textures[next.texture].source;
+		const size_t offset = std::min(levelOffset(source.width, source.height, next.firstMip), source.mipChain.size());
+		Load load{ .texture = next.texture, .firstMip = next.firstMip, .levels{ source.mipChain.begin() + offset, source.mipChain.end() } };
+
+		std::lock_guard lock(mutex);
+		completed.push_back(std::move(load));
+	}
+}
+
+void TextureStreamer::request(uint32_t texture, uint32_t firstMip)
+{
+	textures[texture].loadingMip = firstMip;
+	++loadsInFlight;
+	{
+		std::lock_guard lock(mutex);
+		requests.push_back(Request{ .texture = texture, .firstMip = firstMip });
+	}
+	wake.notify_one();
+}
+
+void TextureStreamer::beginUpdate()
+{
+	++updateIndex;
+	for (Texture &texture : textures)
+	{
+		texture.wantedMip = texture.tailMip;
+	}
+}
+
+void TextureStreamer::want(uint32_t texture, float screenTexels)
+{
+	if (texture >= textures.size() || screenTexels <= 0)
+	{
+		return;
+	}
+
+	// the smallest level still at least as large as what it covers, never past the tail
+	Texture &target = textures[texture];
+	const float largest = static_cast<float>(std::max(target.source.width, target.source.height));
+	const float level = std::floor(std::log2(largest / screenTexels));
+	const uint32_t mip = std::min(target.tailMip, static_cast<uint32_t>(std::max(level, 0.0f)));
+	target.wantedMip = std::min(target.wantedMip, mip);
+	if (mip < target.tailMip)
+	{
+		target.lastWanted = updateIndex;
+	}
+}
+
+void TextureStreamer::endUpdate(size_t budgetBytes)
+{
+	// the most missing detail goes first, ties to whatever was wanted most recently
+	std::vector<uint32_t> upgrades;
+	std::vector<uint32_t> evictable;
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		const Texture &texture = textures[i];
+		if (texture.loadingMip != NoLoad)
+		{
+			continue;
+		}
+		if (texture.wantedMip < texture.residentMip)
+		{
+			upgrades.push_back(i);
+		}
+		else if (texture.wantedMip > texture.residentMip)
+		{
+			evictable.push_back(i);
+		}
+	}
+	std::sort(upgrades.begin(), upgrades.end(), [this](uint32_t a, uint32_t b)
+	{
+		const uint32_t missingA = textures[a].residentMip - textures[a].wantedMip;
+		const uint32_t missingB = textures[b].residentMip - textures[b].wantedMip;
+		return missingA != missingB ? missingA > missingB : textures[a].lastWanted > textures[b].lastWanted;
+	});
+	// detail nothing asks for is only given up under pressure, least recently wanted first
+	std::sort(evictable.begin(), evictable.end(), [this](uint32_t a, uint32_t b) { return textures[a].lastWanted < textures[b].lastWanted; });
+
+	size_t nextEviction = 0;
+	auto evictUntil = [&](size_t targetBytes)
+	{
+		while (committedBytes > targetBytes && nextEviction < evictable.size() && loadsInFlight < MaxLoadsInFlight)
+		{
+			const uint32_t victim = evictable[nextEviction++];
+			Texture &texture = textures[victim];
+			committedBytes -= residentSize(texture, texture.residentMip) - residentSize(texture, texture.wantedMip);
+			request(victim, texture.wantedMip);
+			++evictionCount;
+		}
+	};
+
+	for (const uint32_t upgrade : upgrades)
+	{
+		Texture &texture = textures[upgrade];
+		const size_t extra = residentSize(texture, texture.wantedMip) - residentSize(texture, texture.residentMip);
+		if (extra > budgetBytes)
+		{
+			continue;
+		}
+		evictUntil(budgetBytes - extra);
+		if (committedBytes + extra > budgetBytes || loadsInFlight >= MaxLoadsInFlight)
+		{
+			break; // the rest waits for a later update
+		}
+		committedBytes += extra;
+		request(upgrade, texture.wantedMip);
+	}
+
+	// a budget that shrank is honoured even when nothing new is wanted
+	evictUntil(budgetBytes);
+}
+
+std::vector<TextureStreamer::Load> TextureStreamer::takeCompleted()
+{
+	std::lock_guard lock(mutex);
+	return std::exchange(completed, {});
+}
+
+void TextureStreamer::markResident(uint32_t texture, uint32_t firstMip)
+{
+	Texture &target = textures[texture];
+	if (firstMip < target.residentMip)
+	{
+		++loadCount;
+		streamedBytes += residentSize(target, firstMip);
+	}
+	target.residentMip = firstMip;
+	target.loadingMip = NoLoad;
+	--loadsInFlight;
+}
+
+void TextureStreamer::cancel(uint32_t texture)
+{
+	// back to what is actually resident, the budget gets the difference back
+	Texture &target = textures[texture];
+	committedBytes = committedBytes - residentSize(target, target.loadingMip) + residentSize(target, target.residentMip);
+	target.loadingMip = NoLoad;
+	--loadsInFlight;
+}
+
+size_t TextureStreamer::fullBytes() const
+{
+	size_t total = 0;
+	for (const Texture &texture : textures)
+	{
+		total += residentSize(texture, 0);
+	}
+	return total;
+}
+
+void TextureStreamer::printStats() const
+{
+	if (textures.empty())
+	{
+		return;
+	}
+	constexpr double MB = 1024.0 * 1024.0;
+	std::cout << "Texture streaming: " << loadCount << " loads (" << streamedBytes / MB << " MB), " << evictionCount << " evictions, "
+		<< committedBytes / MB << " of " << fullBytes() / MB << " MB resident" << std::endl;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// Keeps the detailed mips of baked textures out of video memory until the screen needs them.
+// Every texture starts with only the tail of its chain resident, the renderer reports how many
+// texels each one would cover on screen and the streamer picks the levels to load or drop so the
+// resident total stays under a budget, taking detail from the least recently wanted textures first.
+// Levels are copied out of the cache mapping on a background thread, so page faults and copies stay
+// off the frame, and the renderer turns each finished load into a new image.
+class TextureStreamer
+{
+public:
+	constexpr static uint32_t ResidentTailSize{ 128 }; // largest level every texture keeps resident
+	constexpr static uint32_t NoLoad{ UINT32_MAX };
+	constexpr static uint32_t MaxLoadsInFlight{ 4 }; // each one holds a copy of its levels until it is staged
+
+	// RGBA8 mip chain, largest level first, borrowed for as long as the streamer runs
+	struct Source
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+		std::span<const unsigned char> mipChain;
+	};
+
+	// levels firstMip and below, ready to be staged
+	struct Load
+	{
+		uint32_t texture = 0;
+		uint32_t firstMip = 0;
+		std::vector<unsigned char> levels;
+	};
+
+private:
+	struct Texture
+	{
+		Source source;
+		uint32_t tailMip = 0; // the level every texture keeps
+		uint32_t residentMip = 0;
+		uint32_t wantedMip = 0; // this update's, the tail when nothing on screen uses it
+		uint32_t loadingMip = NoLoad;
+		uint64_t lastWanted = 0; // update the texture last needed more than its tail
+	};
+
+	struct Request
+	{
+		uint32_t texture = 0;
+		uint32_t firstMip = 0;
+	};
+
+	std::vector<Texture> textures;
+	uint64_t updateIndex = 0;
+	size_t committedBytes = 0; // resident levels, with loads in flight counted at their target
+	uint32_t loadsInFlight = 0;
+
+	std::mutex mutex;
+	std::condition_variable_any wake;
+	std::deque<Request> requests;
+	std::vector<Load> completed;
+	std::jthread loader;
+
+	uint64_t loadCount = 0;
+	uint64_t evictionCount = 0;
+	size_t streamedBytes = 0;
+
+	void loaderLoop(std::stop_token stopToken);
+	void request(uint32_t texture, uint32_t firstMip);
+	static size_t residentSize(const Texture &texture, uint32_t firstMip);
+
+public:
+	~TextureStreamer() { shutdown(); }
+
+	// starts the loader, each texture's image should be created up front from its tail
+	void initialize(std::vector<Source> sources);
+	void shutdown();
+	bool isActive() const { return !textures.empty(); }
+
+	static size_t levelOffset(uint32_t width, uint32_t height, uint32_t level);
+	uint32_t tailMip(uint32_t texture) const { return textures[texture].tailMip; }
+	uint32_t residentMip(uint32_t texture) const { return textures[texture].residentMip; }
+	const Source &source(uint32_t texture) const { return textures[texture].source; }
+
+	// an estimation pass: begin, want() for every texture a visible draw uses, then end with the budget
+	void beginUpdate();
+	void want(uint32_t texture, float screenTexels);
+	void endUpdate(size_t budgetBytes);
+
+	// finished loads, each one ends with markResident() once its image is swapped in, or cancel() if that failed
+	std::vector<Load> takeCompleted();
+	void markResident(uint32_t texture, uint32_t firstMip);
+	void cancel(uint32_t texture);
+
+	size_t residentBytes() const { return committedBytes; }
+	size_t fullBytes() const;
+	void printStats() const;
+};
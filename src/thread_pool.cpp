@@ -0,0 +1,90 @@
+#include "thread_pool.h"
+#include "cpu_trace.h"
+
+#include <atomic>
+#include <latch>
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		// hardware_concurrency() is 0 when unknown, clamped before the subtraction so it can't wrap
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+	}
+	workers.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	workers.clear(); // jthread joins
+}
+
+void ThreadPool::workerLoop()
+{
+	CPU_THREAD_NAME("worker");
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+	{
+		std::scoped_lock lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	condition.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &fn)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// every participant pulls indices until none are left, so uneven jobs balance themselves
+	std::atomic<size_t> next{ 0 };
+	auto drain = [&]()
+	{
+		for (size_t i = next++; i < count; i = next++)
+		{
+			fn(i);
+		}
+	};
+
+	const size_t helperCount = std::min<size_t>(workers.size(), count - 1);
+	std::latch done(static_cast<std::ptrdiff_t>(helperCount));
+	for (size_t i = 0; i < helperCount; ++i)
+	{
+		enqueue([&]()
+		{
+			drain();
+			done.count_down();
+		});
+	}
+	drain();
+	done.wait();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs from a shared queue.
+class ThreadPool
+{
+	std::vector<std::jthread> workers;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::function<void()>> jobs;
+	bool stopping = false;
+
+	void workerLoop();
+
+public:
+	// 0 uses one worker per hardware thread, minus the calling thread
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+	void enqueue(std::function<void()> job);
+
+	// runs fn(i) for i in [0, count) across the workers and the calling thread, returns once all are done
+	void parallelFor(size_t count, const std::function<void(size_t)> &fn);
+};
@@ -0,0 +1,543 @@
+#include "upload.h"
+#include "gpu_memory.h"
+
+#include <Volk/volk.h>
+#include <vma/vk_mem_alloc.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static bool hasHostVisibleDeviceMemory(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceProperties props{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+	{
+		return true; // unified memory
+	}
+
+	// ReBAR exposes the whole VRAM heap as host visible, not just the 256MB window
+	VkPhysicalDeviceMemoryProperties memProps{};
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+	uint32_t vramHeap = UINT32_MAX;
+	for (uint32_t i = 0; i < memProps.memoryHeapCount; ++i)
+	{
+		const VkMemoryHeap &heap = memProps.memoryHeaps[i];
+		if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT && (vramHeap == UINT32_MAX || heap.size > memProps.memoryHeaps[vramHeap].size))
+		{
+			vramHeap = i;
+		}
+	}
+	for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
+	{
+		const VkMemoryType &type = memProps.memoryTypes[i];
+		constexpr VkMemoryPropertyFlags rebarFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		if (type.heapIndex == vramHeap && (type.propertyFlags & rebarFlags) == rebarFlags)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UploadEngine::initialize(VkPhysicalDevice physicalDevice, VkDevice device, GpuMemory &memory,
+	VkQueue queue, uint32_t queueFamIdx, uint32_t dstQueueFamIdx)
+{
+	this->device = device;
+	this->memory = &memory;
+	allocator = memory.handle();
+	this->queue = queue;
+	this->queueFamIdx = queueFamIdx;
+	this->dstQueueFamIdx = dstQueueFamIdx;
+
+	// upload command buffers are short lived and freed individually once retired
+	VkCommandPoolCreateInfo poolInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = queueFamIdx
+	};
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to create the upload command pool" << std::endl;
+		return false;
+	}
+
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = submittedValue
+	};
+	VkSemaphoreCreateInfo semaphoreInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &semaphoreTypeInfo
+	};
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to create the upload timeline semaphore" << std::endl;
+		return false;
+	}
+
+	// persistent, mapped staging ring reused for every upload
+	VkBufferCreateInfo stagingInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = StagingRingSize,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	VmaAllocationCreateInfo stagingAllocInfo
+	{
+		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+		.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST
+	};
+	VmaAllocationInfo stagingResult{};
+	if (!memory.createBuffer(GpuMemory::Staging, stagingInfo, stagingAllocInfo, stagingBuffer, stagingAllocation, &stagingResult))
+	{
+		std::cerr << "Unable to allocate the staging ring" << std::endl;
+		return false;
+	}
+	stagingData = static_cast<unsigned char *>(stagingResult.pMappedData);
+
+	directWrites = hasHostVisibleDeviceMemory(physicalDevice);
+	if (directWrites)
+	{
+		std::cout << "Host visible device memory available, geometry is written directly" << std::endl;
+	}
+	return true;
+}
+
+void UploadEngine::shutdown()
+{
+	if (!device)
+	{
+		return;
+	}
+	wait(submittedValue);
+	retire();
+
+	if (stagingBuffer)
+	{
+		memory->destroyBuffer(stagingBuffer, stagingAllocation);
+		stagingBuffer = nullptr;
+		stagingData = nullptr;
+	}
+	if (timelineSemaphore)
+	{
+		vkDestroySemaphore(device, timelineSemaphore, nullptr);
+		timelineSemaphore = nullptr;
+	}
+	if (commandPool)
+	{
+		vkDestroyCommandPool(device, commandPool, nullptr);
+		commandPool = nullptr;
+	}
+}
+
+uint64_t UploadEngine::completedValue() const
+{
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(device, timelineSemaphore, &value);
+	return value;
+}
+
+bool UploadEngine::hasPendingWork() const
+{
+	return !imagePreBarriers.empty() || !bufferCopies.empty() || !imageCopies.empty() ||
+		!bufferReleases.empty() || !imageReleases.empty();
+}
+
+void UploadEngine::beginStats()
+{
+	if (!statsActive)
+	{
+		statsActive = true;
+		statsStart = std::chrono::steady_clock::now();
+		statsBytes = 0;
+		statsDirectBytes = 0;
+		statsPeakStaging = 0;
+	}
+}
+
+void UploadEngine::reclaimStaging(uint64_t completed)
+{
+	// batches signal in submission order, so the ring frees from the front
+	while (!inFlight.empty() && inFlight.front().value <= completed)
+	{
+		const InFlightBatch &batch = inFlight.front();
+		vkFreeCommandBuffers(device, commandPool, 1, &batch.commandBuffer);
+		stagingTail = batch.stagingHead;
+		inFlight.pop_front();
+	}
+
+	// nothing outstanding at all, the whole ring is free
+	if (inFlight.empty() && !hasPendingWork())
+	{
+		stagingTail = stagingHead;
+	}
+}
+
+UploadEngine::StagingAllocation UploadEngine::allocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+{
+	if (size > StagingRingSize)
+	{
+		std::cerr << "Staging request larger than the staging ring" << std::endl;
+		return StagingAllocation{};
+	}
+	beginStats();
+	statsBytes += size;
+
+	while (true)
+	{
+		uint64_t offset = (stagingHead + alignment - 1) / alignment * alignment;
+		if (offset % StagingRingSize + size > StagingRingSize)
+		{
+			// doesn't fit before the end of the ring, wrap around to the start
+			offset = (offset / StagingRingSize + 1) * StagingRingSize;
+		}
+
+		if (offset + size - stagingTail <= StagingRingSize)
+		{
+			stagingHead = offset + size;
+			statsPeakStaging = std::max(statsPeakStaging, stagingHead - stagingTail);
+			const VkDeviceSize ringOffset = offset % StagingRingSize;
+			return StagingAllocation{ .buffer = stagingBuffer, .offset = ringOffset, .data = stagingData + ringOffset };
+		}
+
+		// ring is full, flush what we have and wait for the oldest batch to free its space
+		if (hasPendingWork())
+		{
+			submit();
+		}
+		if (inFlight.empty())
+		{
+			stagingTail = stagingHead;
+			continue;
+		}
+		wait(inFlight.front().value);
+		reclaimStaging(completedValue());
+	}
+}
+
+void UploadEngine::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size)
+{
+	const unsigned char *src = static_cast<const unsigned char *>(data);
+	for (VkDeviceSize copied = 0; copied < size;)
+	{
+		const VkDeviceSize chunkSize = std::min(size - copied, StagingRingSize / 2);
+		const StagingAllocation staging = allocateStaging(chunkSize, 16);
+		std::memcpy(staging.data, src + copied, chunkSize);
+		copyBuffer(staging.buffer, dst, VkBufferCopy{ .srcOffset = staging.offset, .dstOffset = dstOffset + copied, .size = chunkSize });
+		copied += chunkSize;
+	}
+}
+
+void UploadEngine::noteDirectWrite(VkDeviceSize size)
+{
+	beginStats();
+	statsDirectBytes += size;
+}
+
+void UploadEngine::prepareImage(VkImage image, const VkImageSubresourceRange &range)
+{
+	imagePreBarriers.push_back(VkImageMemoryBarrier2
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+		.srcAccessMask = 0,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = range
+	});
+}
+
+void UploadEngine::copyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy &region)
+{
+	bufferCopies.push_back(BufferCopy{ .src = src, .dst = dst, .region = region });
+}
+
+void UploadEngine::copyBufferToImage(VkBuffer src, VkImage dst, const VkBufferImageCopy &region)
+{
+	imageCopies.push_back(ImageCopy{ .src = src, .dst = dst, .region = region });
+}
+
+void UploadEngine::releaseBuffer(VkBuffer buffer, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, bool concurrent)
+{
+	// the consumer's wait on this batch's timeline value already makes the copies visible on another queue
+	if (concurrent && isDedicated())
+	{
+		return;
+	}
+
+	VkBufferMemoryBarrier2 barrier
+	{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = dstStage,
+		.dstAccessMask = dstAccess,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = buffer,
+		.offset = 0,
+		.size = VK_WHOLE_SIZE
+	};
+
+	if (isDedicated())
+	{
+		// release half of the ownership transfer, the destination scope is ignored on this queue
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = queueFamIdx;
+		barrier.dstQueueFamilyIndex = dstQueueFamIdx;
+
+		// acquire half, recorded on the graphics queue with a matching family pair
+		VkBufferMemoryBarrier2 acquire = barrier;
+		acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		acquire.srcAccessMask = 0;
+		acquire.dstStageMask = dstStage;
+		acquire.dstAccessMask = dstAccess;
+		batchBufferAcquires.push_back(acquire);
+	}
+	bufferReleases.push_back(barrier);
+}
+
+void UploadEngine::releaseImage(VkImage image, const VkImageSubresourceRange &range, VkImageLayout finalLayout,
+	VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+	VkImageMemoryBarrier2 barrier
+	{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = dstStage,
+		.dstAccessMask = dstAccess,
+		.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.newLayout = finalLayout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = range
+	};
+
+	if (isDedicated())
+	{
+		// layout transition happens between release and acquire, both must agree on it
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = queueFamIdx;
+		barrier.dstQueueFamilyIndex = dstQueueFamIdx;
+
+		VkImageMemoryBarrier2 acquire = barrier;
+		acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		acquire.srcAccessMask = 0;
+		acquire.dstStageMask = dstStage;
+		acquire.dstAccessMask = dstAccess;
+		batchImageAcquires.push_back(acquire);
+	}
+	imageReleases.push_back(barrier);
+}
+
+void UploadEngine::discardAcquire(VkImage image)
+{
+	auto matches = [image](const VkImageMemoryBarrier2 &acquire) { return acquire.image == image; };
+	std::erase_if(imageAcquires, matches);
+	std::erase_if(batchImageAcquires, matches);
+}
+
+uint64_t UploadEngine::submit()
+{
+	retire();
+	if (!hasPendingWork())
+	{
+		return submittedValue;
+	}
+
+	VkCommandBufferAllocateInfo cmdAllocInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = commandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+	VkCommandBuffer commandBuffer = nullptr;
+	if (vkAllocateCommandBuffers(device, &cmdAllocInfo, &commandBuffer) != VK_SUCCESS)
+	{
+		std::cerr << "Unable to allocate upload command buffer" << std::endl;
+		return submittedValue;
+	}
+
+	VkCommandBufferBeginInfo beginInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	// all destination images go to TRANSFER_DST in one barrier batch
+	if (!imagePreBarriers.empty())
+	{
+		VkDependencyInfo depInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = static_cast<uint32_t>(imagePreBarriers.size()),
+			.pImageMemoryBarriers = imagePreBarriers.data()
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &depInfo);
+	}
+
+	// group copies sharing a source and destination into a single command
+	std::stable_sort(bufferCopies.begin(), bufferCopies.end(), [](const BufferCopy &a, const BufferCopy &b)
+	{
+		return a.src != b.src ? a.src < b.src : a.dst < b.dst;
+	});
+	std::vector<VkBufferCopy> bufferRegions;
+	for (size_t i = 0; i < bufferCopies.size();)
+	{
+		const BufferCopy &first = bufferCopies[i];
+		bufferRegions.clear();
+		for (; i < bufferCopies.size() && bufferCopies[i].src == first.src && bufferCopies[i].dst == first.dst; ++i)
+		{
+			bufferRegions.push_back(bufferCopies[i].region);
+		}
+		vkCmdCopyBuffer(commandBuffer, first.src, first.dst, static_cast<uint32_t>(bufferRegions.size()), bufferRegions.data());
+	}
+
+	std::stable_sort(imageCopies.begin(), imageCopies.end(), [](const ImageCopy &a, const ImageCopy &b)
+	{
+		return a.src != b.src ? a.src < b.src : a.dst < b.dst;
+	});
+	std::vector<VkBufferImageCopy> imageRegions;
+	for (size_t i = 0; i < imageCopies.size();)
+	{
+		const ImageCopy &first = imageCopies[i];
+		imageRegions.clear();
+		for (; i < imageCopies.size() && imageCopies[i].src == first.src && imageCopies[i].dst == first.dst; ++i)
+		{
+			imageRegions.push_back(imageCopies[i].region);
+		}
+		vkCmdCopyBufferToImage(commandBuffer, first.src, first.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+	}
+
+	// release everything to the graphics queue in one batch
+	if (!bufferReleases.empty() || !imageReleases.empty())
+	{
+		VkDependencyInfo depInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferReleases.size()),
+			.pBufferMemoryBarriers = bufferReleases.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(imageReleases.size()),
+			.pImageMemoryBarriers = imageReleases.data()
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &depInfo);
+	}
+	vkEndCommandBuffer(commandBuffer);
+
+	// staging memory may not be host coherent
+	vmaFlushAllocation(allocator, stagingAllocation, 0, VK_WHOLE_SIZE);
+
+	const uint64_t signalValue = submittedValue + 1;
+	VkSemaphoreSubmitInfo signalInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+		.semaphore = timelineSemaphore,
+		.value = signalValue,
+		.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+	};
+	VkCommandBufferSubmitInfo cmdSubmitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+		.commandBuffer = commandBuffer
+	};
+	VkSubmitInfo2 submitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+		.commandBufferInfoCount = 1,
+		.pCommandBufferInfos = &cmdSubmitInfo,
+		.signalSemaphoreInfoCount = 1,
+		.pSignalSemaphoreInfos = &signalInfo
+	};
+	if (vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		// the releases never ran, acquiring without them would be invalid
+		std::cerr << "Unable to submit upload batch" << std::endl;
+		vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+	}
+	else
+	{
+		submittedValue = signalValue;
+		inFlight.push_back(InFlightBatch{ .commandBuffer = commandBuffer, .value = signalValue, .stagingHead = stagingHead });
+		bufferAcquires.insert(bufferAcquires.end(), batchBufferAcquires.begin(), batchBufferAcquires.end());
+		imageAcquires.insert(imageAcquires.end(), batchImageAcquires.begin(), batchImageAcquires.end());
+	}
+
+	imagePreBarriers.clear();
+	bufferCopies.clear();
+	imageCopies.clear();
+	bufferReleases.clear();
+	imageReleases.clear();
+	batchBufferAcquires.clear();
+	batchImageAcquires.clear();
+	return submittedValue;
+}
+
+uint64_t UploadEngine::recordAcquires(VkCommandBuffer commandBuffer)
+{
+	if (!bufferAcquires.empty() || !imageAcquires.empty())
+	{
+		VkDependencyInfo depInfo
+		{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferAcquires.size()),
+			.pBufferMemoryBarriers = bufferAcquires.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(imageAcquires.size()),
+			.pImageMemoryBarriers = imageAcquires.data()
+		};
+		vkCmdPipelineBarrier2(commandBuffer, &depInfo);
+		bufferAcquires.clear();
+		imageAcquires.clear();
+	}
+
+	// waiting on an already signalled timeline value is free, so every graphics submit
+	// simply waits on the latest batch instead of tracking which frame consumed what
+	return submittedValue;
+}
+
+void UploadEngine::retire()
+{
+	if (!inFlight.empty())
+	{
+		reclaimStaging(completedValue());
+	}
+
+	if (statsActive && inFlight.empty() && !hasPendingWork())
+	{
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+		const double totalMB = (statsBytes + statsDirectBytes) / (1024.0 * 1024.0);
+		std::cout << "Upload complete: " << totalMB << " MB (" << statsDirectBytes / (1024.0 * 1024.0) << " MB direct) in "
+			<< seconds * 1000.0 << " ms, " << (seconds > 0 ? totalMB / seconds : 0.0) << " MB/s, peak staging "
+			<< statsPeakStaging / (1024.0 * 1024.0) << " MB" << std::endl;
+		statsActive = false;
+	}
+}
+
+void UploadEngine::wait(uint64_t value) const
+{
+	VkSemaphoreWaitInfo waitInfo
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &timelineSemaphore,
+		.pValues = &value
+	};
+	vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <chrono>
+
+class GpuMemory;
+struct VmaAllocator_T;
+typedef struct VmaAllocator_T *VmaAllocator;
+struct VmaAllocation_T;
+typedef struct VmaAllocation_T *VmaAllocation;
+
+// Batches buffer and image copies into a single submission on the transfer queue.
+// Completion is signalled on a timeline semaphore rather than idling the queue, and
+// when the transfer family differs from the graphics family the resources are released
+// here and acquired on the graphics queue through recordAcquires().
+// Source data goes through a persistently mapped staging ring that is reused across uploads.
+class UploadEngine
+{
+	constexpr static VkDeviceSize StagingRingSize{ 64ull * 1024 * 1024 };
+
+	struct BufferCopy
+	{
+		VkBuffer src = nullptr;
+		VkBuffer dst = nullptr;
+		VkBufferCopy region{};
+	};
+
+	struct ImageCopy
+	{
+		VkBuffer src = nullptr;
+		VkImage dst = nullptr;
+		VkBufferImageCopy region{};
+	};
+
+	struct InFlightBatch
+	{
+		VkCommandBuffer commandBuffer = nullptr;
+		uint64_t value = 0;
+		uint64_t stagingHead = 0; // ring position freed once this batch completes
+	};
+
+	VkDevice device = nullptr;
+	GpuMemory *memory = nullptr;
+	VmaAllocator allocator = nullptr;
+	VkQueue queue = nullptr;
+	uint32_t queueFamIdx = UINT32_MAX;
+	uint32_t dstQueueFamIdx = UINT32_MAX;
+	VkCommandPool commandPool = nullptr;
+	VkSemaphore timelineSemaphore = nullptr;
+	uint64_t submittedValue = 0;
+	std::deque<InFlightBatch> inFlight;
+	bool directWrites = false;
+
+	// staging ring, head/tail are monotonic byte counters wrapped by the ring size
+	VkBuffer stagingBuffer = nullptr;
+	VmaAllocation stagingAllocation = nullptr;
+	unsigned char *stagingData = nullptr;
+	uint64_t stagingHead = 0;
+	uint64_t stagingTail = 0;
+
+	// throughput stats, reported once all outstanding uploads complete
+	bool statsActive = false;
+	std::chrono::steady_clock::time_point statsStart;
+	uint64_t statsBytes = 0;
+	uint64_t statsDirectBytes = 0;
+	uint64_t statsPeakStaging = 0;
+
+	// work recorded for the next submission
+	std::vector<VkImageMemoryBarrier2> imagePreBarriers;
+	std::vector<BufferCopy> bufferCopies;
+	std::vector<ImageCopy> imageCopies;
+	std::vector<VkBufferMemoryBarrier2> bufferReleases;
+	std::vector<VkImageMemoryBarrier2> imageReleases;
+	// acquire halves of this batch's releases, only queued for the graphics queue once the batch is submitted
+	std::vector<VkBufferMemoryBarrier2> batchBufferAcquires;
+	std::vector<VkImageMemoryBarrier2> batchImageAcquires;
+
+	// ownership acquires of submitted batches waiting to be recorded on the graphics queue
+	std::vector<VkBufferMemoryBarrier2> bufferAcquires;
+	std::vector<VkImageMemoryBarrier2> imageAcquires;
+
+	void beginStats();
+	void reclaimStaging(uint64_t completed);
+
+public:
+	struct StagingAllocation
+	{
+		VkBuffer buffer = nullptr;
+		VkDeviceSize offset = 0;
+		void *data = nullptr;
+	};
+
+	bool initialize(VkPhysicalDevice physicalDevice, VkDevice device, GpuMemory &memory,
+		VkQueue queue, uint32_t queueFamIdx, uint32_t dstQueueFamIdx);
+	void shutdown();
+
+	bool isDedicated() const { return queueFamIdx != dstQueueFamIdx; }
+	VkSemaphore semaphore() const { return timelineSemaphore; }
+	uint64_t lastSubmittedValue() const { return submittedValue; }
+	uint64_t completedValue() const;
+	bool hasPendingWork() const;
+
+	// true on ReBAR / unified memory, where device-local memory can be written by the host directly
+	bool prefersDirectWrites() const { return directWrites; }
+	VkDeviceSize stagingCapacity() const { return StagingRingSize; }
+
+	// reserves ring space for the current batch, submitting and waiting on older batches if the ring is full
+	StagingAllocation allocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+	// copies data through the staging ring in ring-sized chunks
+	void uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+	// accounts for bytes written straight into mapped device memory
+	void noteDirectWrite(VkDeviceSize size);
+
+	// image must be in UNDEFINED layout, transitions the given range to TRANSFER_DST
+	void prepareImage(VkImage image, const VkImageSubresourceRange &range);
+	void copyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy &region);
+	void copyBufferToImage(VkBuffer src, VkImage dst, const VkBufferImageCopy &region);
+
+	// hand the resource over to the graphics queue once all of its copies are recorded, concurrent buffers are
+	// shared by every family so they need no ownership transfer
+	void releaseBuffer(VkBuffer buffer, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess, bool concurrent = false);
+	void releaseImage(VkImage image, const VkImageSubresourceRange &range, VkImageLayout finalLayout,
+		VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess);
+	// forgets the pending acquire of an image destroyed before the graphics queue took it, once its batch completed
+	void discardAcquire(VkImage image);
+
+	// submits everything recorded so far, returns the timeline value signalled on completion
+	uint64_t submit();
+
+	// records pending ownership acquires, returns the latest submitted timeline value for the graphics submit to
+	// wait on, also when nothing was acquired since concurrent buffers and same-family uploads need the wait too
+	uint64_t recordAcquires(VkCommandBuffer commandBuffer);
+
+	// frees command buffers of batches that have completed
+	void retire();
+	void wait(uint64_t value) const;
+};
@@ -3,6 +3,8 @@
 #include <SDL3/SDL.h>
 #include <fstream>
 #include <sstream>
+#include <cstring>
+#include <algorithm>
 
 void showError(SDL_Window *window, const std::string &errorMessasge)
 {
@@ -21,3 +23,140 @@ std::string readTextFile(const std::string &filePath)
 	}
 	return std::string();
 }
+
+std::vector<char> readBinaryFile(const std::string &filePath)
+{
+	std::ifstream infile(filePath, std::ios::binary);
+	if (!infile.is_open())
+	{
+		return {};
+	}
+	return { std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>() };
+}
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash)
+{
+	constexpr uint64_t FnvPrime = 1099511628211ull;
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * FnvPrime;
+	}
+	return hash;
+}
+
+// expands 1-4 channel, 8 or 16 bit pixels to RGBA8
+void expandToRGBA(unsigned char *dst, const unsigned char *src, size_t pixelCount, int components, int bitsPerChannel)
+{
+	if (components == 4 && bitsPerChannel == 8)
+	{
+		std::memcpy(dst, src, pixelCount * 4);
+		return;
+	}
+
+	const int bytesPerChannel = bitsPerChannel / 8;
+	const int highByte = bytesPerChannel - 1; // 16 bit data is little endian, keep the most significant byte
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		const unsigned char *pixel = src + i * components * bytesPerChannel;
+		auto channel = [&](int c) { return pixel[c * bytesPerChannel + highByte]; };
+		unsigned char *out = dst + i * 4;
+		switch (components)
+		{
+		case 1: // grey
+			out[0] = out[1] = out[2] = channel(0);
+			out[3] = 255;
+			break;
+		case 2: // grey + alpha
+			out[0] = out[1] = out[2] = channel(0);
+			out[3] = channel(1);
+			break;
+		case 3:
+			out[0] = channel(0);
+			out[1] = channel(1);
+			out[2] = channel(2);
+			out[3] = 255;
+			break;
+		default:
+			out[0] = channel(0);
+			out[1] = channel(1);
+			out[2] = channel(2);
+			out[3] = channel(3);
+			break;
+		}
+	}
+}
+
+std::vector<unsigned char> buildMipChainRGBA8(std::span<const unsigned char> pixels, uint32_t width, uint32_t height, uint32_t &mipLevels)
+{
+	mipLevels = 1;
+	size_t totalSize = 0;
+	for (uint32_t w = width, h = height; ; w = std::max(1u, w / 2), h = std::max(1u, h / 2), ++mipLevels)
+	{
+		totalSize += static_cast<size_t>(w) * h * 4;
+		if (w == 1 && h == 1)
+		{
+			break;
+		}
+	}
+
+	std::vector<unsigned char> chain(totalSize);
+	std::memcpy(chain.data(), pixels.data(), static_cast<size_t>(width) * height * 4);
+
+	// 2x2 box filter, odd edges clamp to the last texel
+	size_t srcOffset = 0;
+	size_t dstOffset = static_cast<size_t>(width) * height * 4;
+	uint32_t srcWidth = width;
+	uint32_t srcHeight = height;
+	for (uint32_t level = 1; level < mipLevels; ++level)
+	{
+		const uint32_t dstWidth = std::max(1u, srcWidth / 2);
+		const uint32_t dstHeight = std::max(1u, srcHeight / 2);
+		const unsigned char *src = chain.data() + srcOffset;
+		unsigned char *dst = chain.data() + dstOffset;
+		for (uint32_t y = 0; y < dstHeight; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, srcHeight - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, srcWidth - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const uint32_t sum = src[(y0 * srcWidth + x0) * 4 + c] + src[(y0 * srcWidth + x1) * 4 + c] +
+						src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c];
+					dst[(y * dstWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+				}
+			}
+		}
+		srcOffset = dstOffset;
+		dstOffset += static_cast<size_t>(dstWidth) * dstHeight * 4;
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+	return chain;
+}
+
+Percentiles computePercentiles(std::vector<double> values)
+{
+	if (values.empty())
+	{
+		return {};
+	}
+	std::sort(values.begin(), values.end());
+	double total = 0;
+	for (double value : values)
+	{
+		total += value;
+	}
+	auto rank = [&values](double p) { return values[static_cast<size_t>(p * static_cast<double>(values.size() - 1))]; };
+	return Percentiles
+	{
+		.average = total / static_cast<double>(values.size()),
+		.p50 = rank(0.5),
+		.p95 = rank(0.95),
+		.p99 = rank(0.99),
+		.max = values.back()
+	};
+}
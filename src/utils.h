@@ -1,4 +1,27 @@
 #pragma once
 #include <string>
+#include <span>
+#include <vector>
+#include <cstdint>
 
 std::string readTextFile(const std::string &filePath);
+std::vector<char> readBinaryFile(const std::string &filePath);
+
+// 64 bit FNV-1a, pass a previous result as hash to chain several inputs
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+struct Percentiles
+{
+	double average = 0;
+	double p50 = 0;
+	double p95 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+// nearest-rank percentiles, all zero for an empty set
+Percentiles computePercentiles(std::vector<double> values);
+
+// expands 1-4 channel, 8 or 16 bit pixels to RGBA8
+void expandToRGBA(unsigned char *dst, const unsigned char *src, size_t pixelCount, int components, int bitsPerChannel);
+// returns levels 0..N of an RGBA8 image packed back to back
+std::vector<unsigned char> buildMipChainRGBA8(std::span<const unsigned char> pixels, uint32_t width, uint32_t height, uint32_t &mipLevels);